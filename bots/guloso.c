@@ -0,0 +1,114 @@
+/*************************************************************************************
+ * @file guloso.c
+ *
+ * @brief Bot de exemplo: anda pelo menor caminho ate a comida mais proxima, evitando as
+ * celulas com fantasmas e as vizinhas a elas. A semente da partida decide a ordem em
+ * que as direcoes sao tentadas, e com isso o desempate entre caminhos de mesmo tamanho.
+ *
+ * Compilacao:
+ *     gcc -shared -fPIC -O2 bots/guloso.c -o bots/guloso.so
+ *
+*************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../pacman_bot.h"
+
+#define MAX_CELULAS 4000
+
+static const char direcoes[4] = { 'w', 'a', 's', 'd' };
+static const int deslocamentos[4][2] = { { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 } };
+
+typedef struct
+{
+    int fila[MAX_CELULAS];
+    signed char primeiro_passo[MAX_CELULAS];
+} tEstadoGuloso;
+
+/**
+ * @brief Verifica se a celula eh livre e nao esta ao alcance de um fantasma.
+ */
+static int celulaSegura(const tVisaoBot* visao, int x, int y) {
+    int i;
+
+    if (x < 0 || x >= visao->colunas || y < 0 || y >= visao->linhas) return 0;
+    if (visao->mapa[y * visao->largura + x] == '#') return 0;
+
+    for (i = 0; i < visao->qtd_fantasmas; i++) {
+        if (abs(visao->fantasmas_x[i] - x) + abs(visao->fantasmas_y[i] - y) <= 1) return 0;
+    }
+
+    return 1;
+}
+
+static void* inicia(const tVisaoBot* visao) {
+    (void)visao;
+
+    return malloc(sizeof(tEstadoGuloso));
+}
+
+static char decide(void* estado, const tVisaoBot* visao) {
+    tEstadoGuloso* guloso = estado;
+    int* fila = guloso->fila;
+    signed char* primeiro_passo = guloso->primeiro_passo;
+    int inicio = 0, fim = 0;
+    int i, k;
+
+    if (visao->linhas * visao->colunas > MAX_CELULAS) return 'w';
+
+    memset(primeiro_passo, -1, MAX_CELULAS);
+
+    // Busca em largura guardando em cada celula o primeiro passo que leva a ela
+    for (i = 0; i < 4; i++) {
+        k = (i + visao->semente) % 4;
+        int nx = visao->pacman_x + deslocamentos[k][0];
+        int ny = visao->pacman_y + deslocamentos[k][1];
+        int celula = ny * visao->colunas + nx;
+
+        if (!celulaSegura(visao, nx, ny) || primeiro_passo[celula] >= 0) continue;
+
+        primeiro_passo[celula] = k;
+        fila[fim++] = celula;
+    }
+
+    while (inicio < fim) {
+        int celula = fila[inicio++];
+        int x = celula % visao->colunas;
+        int y = celula / visao->colunas;
+
+        if (visao->indice_comidas[y * visao->largura + x] >= 0) {
+            return direcoes[(int)primeiro_passo[celula]];
+        }
+
+        for (k = 0; k < 4; k++) {
+            int nx = x + deslocamentos[k][0];
+            int ny = y + deslocamentos[k][1];
+            int vizinha = ny * visao->colunas + nx;
+
+            if (!celulaSegura(visao, nx, ny) || primeiro_passo[vizinha] >= 0) continue;
+
+            primeiro_passo[vizinha] = primeiro_passo[celula];
+            fila[fim++] = vizinha;
+        }
+    }
+
+    // Nenhuma comida alcancavel com seguranca: qualquer passo seguro serve
+    return fim > 0 ? direcoes[(int)primeiro_passo[fila[0]]] : 'w';
+}
+
+static void encerra(void* estado) {
+    free(estado);
+}
+
+static const tPacmanBot bot = {
+    PACMAN_BOT_VERSAO,
+    "guloso",
+    inicia,
+    decide,
+    encerra,
+};
+
+const tPacmanBot* pacman_bot(void) {
+    return &bot;
+}
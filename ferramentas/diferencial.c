@@ -0,0 +1,731 @@
+/*************************************************************************************
+ * @file diferencial.c
+ *
+ * @brief Teste diferencial do motor do jogo. Sorteia mapas, opcoes e sequencias de
+ * jogadas, joga cada partida com o motor de referencia (compilado de
+ * 'ferramentas/referencia.c', o caminho de cada jogada congelado de um commit fixo) e
+ * com o executavel novo, e exige que a tela seja identica. Os mapas se alternam entre
+ * as tres classes de tamanho do passo dos fantasmas, e parte deles eh um enxame, com
+ * fantasmas em boa parte das celulas livres.
+ *
+ * A vazao eh medida a parte, contra a versao anterior do jogo: os movimentos por
+ * segundo do novo e do anterior sao lidos dentro do motor pelo segmento de
+ * '--metricas' (apenas o tempo das jogadas, sem iniciar o processo, ler a entrada ou
+ * imprimir a tela), nas mesmas partidas. O teste falha se o novo ficar mais lento que
+ * o anterior alem do limite. O anterior pode ser um executavel ou a vazao dele, em
+ * movimentos por segundo, guardada de uma execucao anterior; sem ele, a vazao do novo
+ * so eh mostrada.
+ *
+ * Uso: diferencial <referencia> <novo> [partidas] [semente] [limite_%] [anterior] [-- opcoes]
+ *
+ * As opcoes depois de '--' sao passadas ao novo e ao anterior em todas as partidas,
+ * alem das sorteadas, e nao podem mudar a tela. As partidas que divergirem ficam
+ * guardadas em 'falha_<n>/', com o mapa, as jogadas e as opcoes usadas.
+ *
+*************************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define MAX_LINHAS 40
+#define MAX_COLUNAS 100
+#define MAX_CAMINHO 4096
+#define MAX_OPCOES 32
+#define QTD_JOGADAS 400
+#define MAX_FALHAS 4
+#define QTD_CLASSES 3
+#define CHANCE_ENXAME 25
+#define VERSAO_METRICAS 2
+
+typedef struct
+{
+    char* dados;
+    size_t tamanho;
+} tConteudo;
+
+typedef struct
+{
+    char* executavel;
+    double segundos;
+    long movimentos;
+} tMotor;
+
+/**
+ * Mesmo formato do segmento de metricas do jogo ('--metricas'), na VERSAO_METRICAS.
+ */
+typedef struct
+{
+    uint64_t movimento;
+    int64_t pontos;
+    int64_t comidas_restantes;
+    int64_t movs_restantes;
+    char direcoes[4];
+    int64_t comidas_pegas[4];
+    int64_t colisoes_parede[4];
+    int64_t colisoes_apenas_parede[4];
+    int64_t qtd_realizado[4];
+    double movimentos_por_segundo;
+    uint64_t latencia_ns;
+    uint64_t tempo_jogadas_ns;
+    int32_t encerrado;
+} tValoresMetricas;
+
+typedef struct
+{
+    uint32_t versao;
+    uint32_t sequencia;
+    tValoresMetricas valores;
+} tMetricas;
+
+/**
+ * Opcoes sorteadas para uma partida. 'opcoes' vai para o novo e o anterior; a
+ * referencia so recebe '--perseguicao', que faz parte do caminho de cada jogada.
+ */
+typedef struct
+{
+    char* opcoes[MAX_OPCOES + 1];
+    int qtd;
+    int perseguicao;
+} tOpcoesSorteadas;
+
+/**
+ * @brief Sorteia um numero em [minimo, maximo] com um gerador proprio, para que a
+ * mesma semente gere as mesmas partidas em qualquer sistema.
+ *
+ * @param estado Estado do gerador
+ * @param minimo Menor valor
+ * @param maximo Maior valor
+ * @return int Numero sorteado
+ */
+int sorteia(unsigned long long* estado, int minimo, int maximo);
+
+/**
+ * @brief Sorteia um mapa valido: borda de paredes, um Pacman, ate quatro fantasmas,
+ * comidas, paredes internas e, as vezes, um par de portais. Em CHANCE_ENXAME% dos
+ * mapas, cada celula livre que sobrar ainda pode virar um fantasma. Fantasmas
+ * encaixados entre paredes na direcao em que andam viram espaco vazio, como o jogo
+ * exige. As dimensoes seguem a classe de tamanho: 0 para ate 14 x 14 celulas (classe
+ * pequena do jogo), 1 para ate 30 colunas (media) e 2 para mais colunas (grande).
+ *
+ * @param estado Estado do gerador
+ * @param caminho Arquivo do mapa a ser criado
+ * @param classe Classe de tamanho do mapa
+ * @return int 1 se o mapa foi criado, 0 caso contrario
+ */
+int geraMapa(unsigned long long* estado, char* caminho, int classe);
+
+/**
+ * @brief Sorteia as jogadas da partida, uma por linha.
+ *
+ * @param estado Estado do gerador
+ * @param caminho Arquivo de jogadas a ser criado
+ * @return int 1 se o arquivo foi criado, 0 caso contrario
+ */
+int geraJogadas(unsigned long long* estado, char* caminho);
+
+/**
+ * @brief Sorteia '--perseguicao' e as opcoes que nao mudam a tela, e acrescenta as
+ * opcoes fixas.
+ *
+ * @param estado Estado do gerador
+ * @param fixas Opcoes passadas depois de '--', terminadas em NULL
+ * @param sorteadas Opcoes da partida
+ */
+void sorteiaOpcoes(unsigned long long* estado, char** fixas, tOpcoesSorteadas* sorteadas);
+
+/**
+ * @brief Joga uma partida com o motor de referencia, com as jogadas na entrada e a
+ * tela redirecionada para um arquivo.
+ *
+ * @param referencia Executavel da referencia
+ * @param perseguicao 1 se a partida usa '--perseguicao'
+ * @param dir Diretorio do mapa
+ * @param jogadas Arquivo de jogadas
+ * @param tela Arquivo onde a tela eh gravada
+ * @return int 1 se a partida terminou normalmente, 0 caso contrario
+ */
+int jogaReferencia(char* referencia, int perseguicao, char* dir, char* jogadas, char* tela);
+
+/**
+ * @brief Joga uma partida com o jogo, passando '--metricas', e acumula os movimentos e
+ * o tempo das jogadas publicados no segmento. O jogo cria o segmento com exclusividade
+ * antes de ler a primeira jogada, entao as jogadas so sao enviadas, por um pipe, depois
+ * que o segmento foi aberto aqui; assim ele continua mapeado quando o jogo o remove ao
+ * sair.
+ *
+ * @param motor Executavel e tempo acumulado
+ * @param opcoes Opcoes passadas ao executavel, terminadas em NULL
+ * @param dir Diretorio do mapa
+ * @param jogadas Arquivo de jogadas
+ * @param tela Arquivo onde a tela eh gravada
+ * @return int 1 se a partida terminou normalmente e as metricas foram lidas, 0 caso
+ * contrario
+ */
+int jogaMotor(tMotor* motor, char** opcoes, char* dir, char* jogadas, char* tela);
+
+/**
+ * @brief Movimentos por segundo acumulados de um executavel.
+ *
+ * @param motor Executavel e tempo acumulado
+ * @return double Movimentos por segundo, ou 0 se nenhum tempo foi medido
+ */
+double vazao(const tMotor* motor);
+
+/**
+ * @brief Le um arquivo inteiro para a memoria.
+ *
+ * @param caminho Caminho do arquivo
+ * @return tConteudo Conteudo lido; 'dados' eh NULL se o arquivo nao existe
+ */
+tConteudo leArquivo(char* caminho);
+
+/**
+ * @brief Compara dois arquivos byte a byte.
+ *
+ * @param a Caminho do primeiro arquivo
+ * @param b Caminho do segundo arquivo
+ * @return int 1 se sao identicos, 0 caso contrario
+ */
+int comparaArquivos(char* a, char* b);
+
+/**
+ * @brief Apaga a pasta 'saida/' de uma partida anterior, para que cada partida comece
+ * sem os arquivos (como o mapa de calor) da anterior.
+ *
+ * @param dir Diretorio da partida
+ */
+void limpaSaida(char* dir);
+
+/**
+ * @brief Copia um arquivo.
+ *
+ * @param origem Arquivo de origem
+ * @param destino Arquivo de destino
+ */
+void copiaArquivo(char* origem, char* destino);
+
+
+/****************************************** MAIN ********************************************/
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printf("ERRO: Uso: %s <referencia> <novo> [partidas] [semente] [limite_%%] [anterior] [-- opcoes]\n", argv[0]);
+        return 1;
+    }
+
+    char* referencia = argv[1];
+    tMotor novo = { argv[2], 0, 0 };
+    tMotor anterior = { NULL, 0, 0 };
+    double vazao_anterior = 0;
+    int partidas = 200;
+    unsigned long long semente = 1;
+    double limite = 10;
+    char* opcoes[MAX_OPCOES + 1];
+    int qtd_opcoes = 0;
+    int arg, posicional = 0;
+
+    for (arg = 3; arg < argc; arg++) {
+        if (strcmp(argv[arg], "--") == 0) {
+            for (arg++; arg < argc && qtd_opcoes < MAX_OPCOES; arg++) {
+                opcoes[qtd_opcoes++] = argv[arg];
+            }
+            break;
+        }
+
+        if (posicional == 0) partidas = atoi(argv[arg]);
+        if (posicional == 1) semente = strtoull(argv[arg], NULL, 10);
+        if (posicional == 2) limite = atof(argv[arg]);
+        if (posicional == 3) {
+            // Um numero eh a vazao guardada do anterior; qualquer outra coisa, o executavel
+            char* fim;
+            vazao_anterior = strtod(argv[arg], &fim);
+            if (*fim != '\0' || fim == argv[arg]) {
+                anterior.executavel = argv[arg];
+                vazao_anterior = 0;
+            }
+        }
+        posicional++;
+    }
+    opcoes[qtd_opcoes] = NULL;
+
+    // Um jogo que sai antes de ler todas as jogadas nao pode derrubar o teste
+    signal(SIGPIPE, SIG_IGN);
+
+    char base[] = "/tmp/pacman_diferencial_XXXXXX";
+    if (mkdtemp(base) == NULL) {
+        printf("ERRO: Nao foi possivel criar o diretorio temporario\n");
+        return 1;
+    }
+
+    char dir_ref[MAX_CAMINHO], dir_novo[MAX_CAMINHO], dir_anterior[MAX_CAMINHO];
+    char jogadas[MAX_CAMINHO], tela_ref[MAX_CAMINHO], tela_novo[MAX_CAMINHO], tela_anterior[MAX_CAMINHO];
+    char mapa_ref[MAX_CAMINHO], mapa_novo[MAX_CAMINHO], mapa_anterior[MAX_CAMINHO];
+
+    snprintf(dir_ref, MAX_CAMINHO, "%s/referencia", base);
+    snprintf(dir_novo, MAX_CAMINHO, "%s/novo", base);
+    snprintf(dir_anterior, MAX_CAMINHO, "%s/anterior", base);
+    snprintf(jogadas, MAX_CAMINHO, "%s/jogadas.txt", base);
+    snprintf(tela_ref, MAX_CAMINHO, "%s/tela_referencia.txt", base);
+    snprintf(tela_novo, MAX_CAMINHO, "%s/tela_novo.txt", base);
+    snprintf(tela_anterior, MAX_CAMINHO, "%s/tela_anterior.txt", base);
+    snprintf(mapa_ref, MAX_CAMINHO, "%s/referencia/mapa.txt", base);
+    snprintf(mapa_novo, MAX_CAMINHO, "%s/novo/mapa.txt", base);
+    snprintf(mapa_anterior, MAX_CAMINHO, "%s/anterior/mapa.txt", base);
+
+    mkdir(dir_ref, 0777);
+    mkdir(dir_novo, 0777);
+    mkdir(dir_anterior, 0777);
+
+    unsigned long long estado = semente * 6364136223846793005ULL + 1442695040888963407ULL;
+    int falhas = 0;
+    int i;
+
+    for (i = 0; i < partidas && falhas < MAX_FALHAS; i++) {
+        tOpcoesSorteadas sorteadas;
+        sorteiaOpcoes(&estado, opcoes, &sorteadas);
+
+        if (!geraMapa(&estado, mapa_ref, i % QTD_CLASSES) || !geraJogadas(&estado, jogadas)) {
+            printf("ERRO: Nao foi possivel gerar a partida %d\n", i);
+            return 1;
+        }
+        copiaArquivo(mapa_ref, mapa_novo);
+        copiaArquivo(mapa_ref, mapa_anterior);
+        limpaSaida(dir_ref);
+        limpaSaida(dir_novo);
+        limpaSaida(dir_anterior);
+
+        int ok = jogaReferencia(referencia, sorteadas.perseguicao, dir_ref, jogadas, tela_ref);
+        int anterior_ok = 1;
+
+        // O novo e o anterior se alternam no primeiro lugar, para nao favorecer nenhum
+        if (anterior.executavel != NULL && i % 2 == 1) {
+            anterior_ok = jogaMotor(&anterior, sorteadas.opcoes, dir_anterior, jogadas, tela_anterior);
+        }
+        ok = jogaMotor(&novo, sorteadas.opcoes, dir_novo, jogadas, tela_novo) && ok;
+        if (anterior.executavel != NULL && i % 2 == 0) {
+            anterior_ok = jogaMotor(&anterior, sorteadas.opcoes, dir_anterior, jogadas, tela_anterior);
+        }
+
+        // Sem a partida do anterior, a comparacao da vazao nao valeria
+        if (!anterior_ok) {
+            printf("ERRO: O anterior '%s' falhou na partida %d\n", anterior.executavel, i);
+            return 1;
+        }
+
+        int iguais = ok && comparaArquivos(tela_ref, tela_novo);
+
+        if (!iguais) {
+            char falha[32], destino[64];
+
+            falhas++;
+            snprintf(falha, sizeof(falha), "falha_%d", falhas);
+            mkdir(falha, 0777);
+            snprintf(destino, sizeof(destino), "%s/mapa.txt", falha);
+            copiaArquivo(mapa_ref, destino);
+            snprintf(destino, sizeof(destino), "%s/jogadas.txt", falha);
+            copiaArquivo(jogadas, destino);
+
+            snprintf(destino, sizeof(destino), "%s/opcoes.txt", falha);
+            FILE* opcoesFile = fopen(destino, "w");
+            if (opcoesFile != NULL) {
+                int k;
+                for (k = 0; k < sorteadas.qtd; k++) {
+                    fprintf(opcoesFile, "%s%s", k ? " " : "", sorteadas.opcoes[k]);
+                }
+                fputc('\n', opcoesFile);
+                fclose(opcoesFile);
+            }
+
+            printf("Partida %d divergiu (%s); guardada em '%s'\n", i, ok ? "telas diferentes" : "execucao falhou", falha);
+        }
+    }
+
+    double taxa_novo = vazao(&novo);
+    if (anterior.executavel != NULL) vazao_anterior = vazao(&anterior);
+
+    printf("Partidas: %d, divergencias: %d\n", i, falhas);
+    printf("Novo:     %ld movimentos em %.3f s de jogadas (%.0f movimentos/s)\n", novo.movimentos, novo.segundos, taxa_novo);
+
+    int regrediu = 0;
+    if (anterior.executavel != NULL) {
+        printf("Anterior: %ld movimentos em %.3f s de jogadas (%.0f movimentos/s)\n", anterior.movimentos, anterior.segundos,
+               vazao_anterior);
+    } else if (vazao_anterior > 0) {
+        printf("Anterior: %.0f movimentos/s (guardado)\n", vazao_anterior);
+    } else {
+        printf("Sem o anterior, a vazao nao foi comparada\n");
+    }
+
+    if (vazao_anterior > 0 && taxa_novo < vazao_anterior * (1 - limite / 100)) {
+        printf("ERRO: O novo ficou %.1f%% mais lento que o anterior (limite de %.1f%%)\n",
+               100 * (1 - taxa_novo / vazao_anterior), limite);
+        regrediu = 1;
+    }
+
+    char comando[MAX_CAMINHO + 16];
+    snprintf(comando, sizeof(comando), "rm -rf '%s'", base);
+    if (system(comando) != 0) {
+        printf("Aviso: o diretorio temporario '%s' nao foi removido\n", base);
+    }
+
+    return falhas > 0 || regrediu;
+}
+
+
+/////////////////////////////////// FUNCOES DO SORTEIO /////////////////////////////////
+int sorteia(unsigned long long* estado, int minimo, int maximo) {
+    // Gerador congruencial linear de 64 bits; os bits altos sao os de melhor qualidade
+    *estado = *estado * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return minimo + (int)((*estado >> 33) % (unsigned long long)(maximo - minimo + 1));
+}
+
+int geraMapa(unsigned long long* estado, char* caminho, int classe) {
+    static char mapa[MAX_LINHAS][MAX_COLUNAS];
+    static int livres[MAX_LINHAS * MAX_COLUNAS][2];
+    int linhas, colunas;
+
+    if (classe == 0) {
+        linhas = sorteia(estado, 3, 14);
+        colunas = sorteia(estado, 3, 14);
+    } else if (classe == 1) {
+        linhas = sorteia(estado, 3, MAX_LINHAS);
+        colunas = sorteia(estado, 15, 30);
+    } else {
+        linhas = sorteia(estado, 3, MAX_LINHAS);
+        colunas = sorteia(estado, 31, MAX_COLUNAS);
+    }
+
+    int densidade = sorteia(estado, 0, 99);
+    int qtd_livres = 0;
+    int i, j, k;
+
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            mapa[i][j] = '#';
+
+            if (i == 0 || j == 0 || i == linhas - 1 || j == colunas - 1) continue;
+
+            int r = sorteia(estado, 0, 99);
+            if (r < densidade / 2) mapa[i][j] = '#';
+            else if (r < densidade / 2 + 30) mapa[i][j] = '*';
+            else mapa[i][j] = ' ';
+
+            livres[qtd_livres][0] = i;
+            livres[qtd_livres][1] = j;
+            qtd_livres++;
+        }
+    }
+
+    // Embaralha as celulas internas e coloca os personagens nas primeiras
+    for (k = qtd_livres - 1; k > 0; k--) {
+        int outra = sorteia(estado, 0, k);
+        int y = livres[k][0], x = livres[k][1];
+
+        livres[k][0] = livres[outra][0];
+        livres[k][1] = livres[outra][1];
+        livres[outra][0] = y;
+        livres[outra][1] = x;
+    }
+
+    char personagens[8];
+    int qtd_personagens = 0;
+    const char* tipos = "BPIC";
+
+    personagens[qtd_personagens++] = '>';
+    for (k = 0; k < 4; k++) {
+        if (sorteia(estado, 0, 1)) personagens[qtd_personagens++] = tipos[k];
+    }
+    if (sorteia(estado, 0, 9) < 6) {
+        personagens[qtd_personagens++] = '@';
+        personagens[qtd_personagens++] = '@';
+    }
+
+    for (k = 0; k < qtd_personagens && k < qtd_livres; k++) {
+        mapa[livres[k][0]][livres[k][1]] = personagens[k];
+    }
+
+    // Enxame: as celulas restantes que nao sao parede podem virar fantasmas
+    if (sorteia(estado, 0, 99) < CHANCE_ENXAME) {
+        int chance = sorteia(estado, 5, 60);
+
+        for (; k < qtd_livres; k++) {
+            char* celula = &mapa[livres[k][0]][livres[k][1]];
+
+            if (*celula != '#' && sorteia(estado, 0, 99) < chance) {
+                *celula = tipos[sorteia(estado, 0, 3)];
+            }
+        }
+    }
+
+    // B e C andam na horizontal, P e I na vertical
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            char c = mapa[i][j], antes, depois;
+
+            if (c != 'B' && c != 'P' && c != 'I' && c != 'C') continue;
+
+            if (c == 'B' || c == 'C') {
+                antes = mapa[i][j - 1];
+                depois = mapa[i][j + 1];
+            } else {
+                antes = mapa[i - 1][j];
+                depois = mapa[i + 1][j];
+            }
+
+            if ((antes == '#' || antes == '@') && (depois == '#' || depois == '@')) mapa[i][j] = ' ';
+        }
+    }
+
+    FILE* mapaFile = fopen(caminho, "w");
+    if (mapaFile == NULL) return 0;
+
+    fprintf(mapaFile, "%d %d %d\n", linhas, colunas, sorteia(estado, 1, 300));
+    for (i = 0; i < linhas; i++) {
+        fwrite(mapa[i], 1, colunas, mapaFile);
+        fputc('\n', mapaFile);
+    }
+
+    fclose(mapaFile);
+    return 1;
+}
+
+int geraJogadas(unsigned long long* estado, char* caminho) {
+    const char* direcoes = "wasd";
+    int i;
+
+    FILE* jogadasFile = fopen(caminho, "w");
+    if (jogadasFile == NULL) return 0;
+
+    for (i = 0; i < QTD_JOGADAS; i++) {
+        fputc(direcoes[sorteia(estado, 0, 3)], jogadasFile);
+        fputc('\n', jogadasFile);
+    }
+
+    fclose(jogadasFile);
+    return 1;
+}
+
+void sorteiaOpcoes(unsigned long long* estado, char** fixas, tOpcoesSorteadas* sorteadas) {
+    // Opcoes que so gravam arquivos ou mudam como a jogada eh calculada, nunca a tela
+    char* simples[] = { "--antecipa", "--registra-sessao", "--mapa-de-calor", "--grava", "--trilha-binaria" };
+    int i;
+
+    sorteadas->qtd = 0;
+    sorteadas->perseguicao = sorteia(estado, 0, 2) == 0;
+
+    if (sorteadas->perseguicao) sorteadas->opcoes[sorteadas->qtd++] = "--perseguicao";
+
+    for (i = 0; i < (int)(sizeof(simples) / sizeof(simples[0])); i++) {
+        if (sorteia(estado, 0, 2) == 0) sorteadas->opcoes[sorteadas->qtd++] = simples[i];
+    }
+
+    for (i = 0; fixas[i] != NULL && sorteadas->qtd < MAX_OPCOES; i++) {
+        sorteadas->opcoes[sorteadas->qtd++] = fixas[i];
+    }
+    sorteadas->opcoes[sorteadas->qtd] = NULL;
+}
+
+
+/////////////////////////////////// FUNCOES DA EXECUCAO ////////////////////////////////
+int jogaReferencia(char* referencia, int perseguicao, char* dir, char* jogadas, char* tela) {
+    char* args[4];
+    int status, qtd = 0;
+
+    args[qtd++] = referencia;
+    if (perseguicao) args[qtd++] = "--perseguicao";
+    args[qtd++] = dir;
+    args[qtd] = NULL;
+
+    pid_t pid = fork();
+    if (pid < 0) return 0;
+
+    if (pid == 0) {
+        int entrada = open(jogadas, O_RDONLY);
+        int saida = open(tela, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+        if (entrada < 0 || saida < 0) _exit(127);
+
+        dup2(entrada, STDIN_FILENO);
+        dup2(saida, STDOUT_FILENO);
+        execv(referencia, args);
+        _exit(127);
+    }
+
+    return waitpid(pid, &status, 0) >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int jogaMotor(tMotor* motor, char** opcoes, char* dir, char* jogadas, char* tela) {
+    char* args[MAX_OPCOES + 5];
+    char nome_metricas[64];
+    int canal[2];
+    int status, i, qtd = 0;
+
+    snprintf(nome_metricas, sizeof(nome_metricas), "/pacman_diferencial_%d", (int)getpid());
+
+    // Um segmento esquecido por uma execucao interrompida faria o jogo recusar o nome
+    shm_unlink(nome_metricas);
+
+    args[qtd++] = motor->executavel;
+    args[qtd++] = "--metricas";
+    args[qtd++] = nome_metricas;
+    for (i = 0; opcoes[i] != NULL; i++) {
+        args[qtd++] = opcoes[i];
+    }
+    args[qtd++] = dir;
+    args[qtd] = NULL;
+
+    tConteudo conteudo = leArquivo(jogadas);
+    if (conteudo.dados == NULL || pipe(canal) != 0) {
+        free(conteudo.dados);
+        return 0;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(canal[0]);
+        close(canal[1]);
+        free(conteudo.dados);
+        return 0;
+    }
+
+    if (pid == 0) {
+        int saida = open(tela, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+
+        if (saida < 0) _exit(127);
+
+        close(canal[1]);
+        dup2(canal[0], STDIN_FILENO);
+        dup2(saida, STDOUT_FILENO);
+        execv(motor->executavel, args);
+        _exit(127);
+    }
+
+    close(canal[0]);
+
+    // Espera o jogo criar o segmento; se ele sair antes disso, a partida falhou
+    struct timespec espera = { 0, 1000000L };
+    int fd = -1, saiu = 0;
+    while ((fd = shm_open(nome_metricas, O_RDONLY, 0)) < 0) {
+        if (waitpid(pid, &status, WNOHANG) != 0) {
+            saiu = 1;
+            break;
+        }
+        nanosleep(&espera, NULL);
+    }
+
+    tMetricas* metricas = MAP_FAILED;
+    if (fd >= 0) {
+        metricas = mmap(NULL, sizeof(tMetricas), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+    }
+
+    // As jogadas cabem no buffer do pipe. Se o jogo sair antes de le-las, a escrita
+    // falha sem derrubar o teste, e o resultado vem do status
+    ssize_t escritos = write(canal[1], conteudo.dados, conteudo.tamanho);
+    (void)escritos;
+    close(canal[1]);
+    free(conteudo.dados);
+
+    int terminou = saiu || waitpid(pid, &status, 0) >= 0;
+    int medido = 0;
+
+    // O jogo ja terminou, entao a ultima publicacao pode ser lida sem o seqlock
+    if (metricas != MAP_FAILED) {
+        if (metricas->versao == VERSAO_METRICAS) {
+            motor->movimentos += metricas->valores.movimento;
+            motor->segundos += metricas->valores.tempo_jogadas_ns / 1e9;
+            medido = 1;
+        }
+        munmap(metricas, sizeof(tMetricas));
+    }
+
+    return terminou && medido && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+double vazao(const tMotor* motor) {
+    return motor->segundos > 0 ? motor->movimentos / motor->segundos : 0;
+}
+
+
+////////////////////////////////// FUNCOES DE COMPARACAO ///////////////////////////////
+tConteudo leArquivo(char* caminho) {
+    tConteudo conteudo = { NULL, 0 };
+    FILE* arquivo = fopen(caminho, "rb");
+
+    if (arquivo == NULL) return conteudo;
+
+    fseek(arquivo, 0, SEEK_END);
+    conteudo.tamanho = ftell(arquivo);
+    fseek(arquivo, 0, SEEK_SET);
+
+    conteudo.dados = malloc(conteudo.tamanho + 1);
+    if (conteudo.dados == NULL || fread(conteudo.dados, 1, conteudo.tamanho, arquivo) != conteudo.tamanho) {
+        printf("ERRO: Nao foi possivel ler '%s'\n", caminho);
+        exit(1);
+    }
+    conteudo.dados[conteudo.tamanho] = '\0';
+
+    fclose(arquivo);
+    return conteudo;
+}
+
+int comparaArquivos(char* a, char* b) {
+    tConteudo conteudo_a = leArquivo(a);
+    tConteudo conteudo_b = leArquivo(b);
+    int iguais = conteudo_a.dados != NULL && conteudo_b.dados != NULL && conteudo_a.tamanho == conteudo_b.tamanho &&
+                 memcmp(conteudo_a.dados, conteudo_b.dados, conteudo_a.tamanho) == 0;
+
+    free(conteudo_a.dados);
+    free(conteudo_b.dados);
+
+    return iguais;
+}
+
+void limpaSaida(char* dir) {
+    char saida[MAX_CAMINHO];
+    struct dirent* entrada;
+
+    snprintf(saida, MAX_CAMINHO, "%s/saida", dir);
+
+    DIR* saidaDir = opendir(saida);
+    if (saidaDir == NULL) return;
+
+    while ((entrada = readdir(saidaDir)) != NULL) {
+        char arquivo[MAX_CAMINHO + 256];
+
+        if (entrada->d_name[0] == '.') continue;
+
+        snprintf(arquivo, sizeof(arquivo), "%s/%s", saida, entrada->d_name);
+        unlink(arquivo);
+    }
+
+    closedir(saidaDir);
+    rmdir(saida);
+}
+
+void copiaArquivo(char* origem, char* destino) {
+    tConteudo conteudo = leArquivo(origem);
+    FILE* destinoFile = fopen(destino, "wb");
+
+    if (conteudo.dados == NULL || destinoFile == NULL) {
+        printf("ERRO: Nao foi possivel copiar '%s' para '%s'\n", origem, destino);
+        exit(1);
+    }
+
+    fwrite(conteudo.dados, 1, conteudo.tamanho, destinoFile);
+    fclose(destinoFile);
+    free(conteudo.dados);
+}
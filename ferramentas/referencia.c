@@ -0,0 +1,1160 @@
+/*************************************************************************************
+ * @file referencia.c
+ *
+ * @brief Motor de referencia do teste diferencial ('ferramentas/diferencial.c'): so o
+ * caminho de cada jogada, congelado do main.c do commit d50e5f5. Os tipos, as macros,
+ * os prototipos e as funcoes foram copiados daquele commit sem nenhuma alteracao: a
+ * leitura do mapa (leMapa), a criacao dos objetos, realizaJogo com o movimento dos
+ * fantasmas e do Pacman, as colisoes, as comidas, os portais e atualizaMapa. Os trechos
+ * em '#ifdef MAPA_EMBUTIDO' ficaram como estavam e nao sao compilados aqui. So o MAIN e
+ * imprimeEstado foram escritos para este arquivo: eles leem as jogadas e imprimem a tela
+ * como o jogo sem opcoes (ou apenas com '--perseguicao').
+ *
+ * Este arquivo nunca deve ser editado a mao. Se o comportamento do jogo mudar de
+ * proposito, as funcoes devem ser copiadas de novo de um commit fixo, e o commit
+ * indicado aqui deve ser trocado.
+ *
+ * Uso: referencia [--perseguicao] <diretorio>
+ *
+*************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#define MAX_DIR_SIZE 1001
+#define MAX_LINHAS 40
+#define MAX_COLUNAS 100
+#define QTD_FANTASMAS (38 * 98 - 1)
+#define QTD_COMIDAS (38 * 98 - 1)
+#define QTD_MOVIMENTOS 4
+#define QTD_PORTAIS 2
+#define CICLO_PERSEGUICAO 27
+#define TEMPO_DISPERSAO 7
+#define RAIO_CLYDE 8
+
+#define CLASSE_PEQUENA 0
+#define CLASSE_MEDIA 1
+#define CLASSE_GRANDE 2
+#define LARGURA_PEQUENA 16
+#define LARGURA_MEDIA 32
+#define LARGURA_GRANDE 128
+
+#define W 0
+#define A 1
+#define S 2
+#define D 3
+
+typedef struct
+{
+    int linhas;
+    int colunas;
+    int lim_movs;
+    char mapa[MAX_LINHAS][MAX_COLUNAS];
+    int trilha[MAX_LINHAS][MAX_COLUNAS];
+} tMapa;
+
+typedef struct
+{
+    int x;
+    int y;
+    int pontos;
+    int movs_restantes;
+    int mov_atual;
+    char direcao;
+    int colidiu_com_parede;
+    int colidiu_com_fantasma;
+    int colidiu_com_comida;
+    int colidiu_com_portal;
+} tPacman;
+
+/**
+ * Os fantasmas sao guardados como estrutura de vetores: cada campo fica em um vetor
+ * proprio, e a direcao eh codificada como deslocamento (dx, dy). Assim o passo de
+ * movimento percorre vetores contiguos sem desvios, e o compilador pode vetoriza-lo.
+ * A grade 'bloqueio' marca com 1 as paredes e portais, que fazem o fantasma voltar. Ela
+ * tem uma borda extra, tambem bloqueada, e eh acessada com BLOQUEIO(fantasmas, x, y).
+ * Sua largura depende da classe de tamanho do mapa, escolhida ao carrega-lo: 16 colunas
+ * nos mapas pequenos, em que a grade inteira cabe em 256 bytes, 32 nos medios e 128 nos
+ * grandes. Cada classe tem o seu passo de fantasmas, com a largura fixa.
+ * No modo de perseguicao, 'campo' guarda a distancia de cada celula ate o Pacman pelo
+ * caminho dos fantasmas, e so eh recalculado quando o Pacman ou os portais mudam.
+ */
+typedef struct
+{
+    int qtd;
+    int x[QTD_FANTASMAS];
+    int y[QTD_FANTASMAS];
+    int dx[QTD_FANTASMAS];
+    int dy[QTD_FANTASMAS];
+    char tipo[QTD_FANTASMAS];
+    int classe;
+    int largura_bloqueio;
+    uint8_t bloqueio[(MAX_LINHAS + 2) * LARGURA_GRANDE];
+
+    int campo[MAX_LINHAS][MAX_COLUNAS];
+    int campo_valido;
+    int campo_x;
+    int campo_y;
+    int campo_portais;
+} tFantasmas;
+
+#define BLOQUEIO(fantasmas, x, y) ((fantasmas)->bloqueio[((y) + 1) * (fantasmas)->largura_bloqueio + (x) + 1])
+
+typedef struct
+{
+    int x;
+    int y;
+    int foi_comida;
+    int alcancavel;
+} tComida;
+
+typedef struct
+{
+    char direcao;
+    int comidas_pegas;
+    int colisoes_parede;
+    int colisoes_apenas_parede;
+    int qtd_realizado;
+} tEstatisticaMovimento;
+
+typedef struct
+{
+    int x;
+    int y;
+} tPortal;
+
+typedef struct
+{
+    int encerra_impossivel;
+    int mapa_de_calor;
+    int desfazer;
+    int gravar;
+    int perseguicao;
+    int bot;
+    int threads;
+    int registrar_sessao;
+    int antecipar;
+    int janela_linhas;
+    int janela_colunas;
+    int minimapa;
+    int trilha_binaria;
+    int multijogador;
+} tOpcoes;
+
+typedef struct
+{
+    tMapa mapa;
+    tPacman pacman;
+    tFantasmas fantasmas;
+    tComida comidas[QTD_COMIDAS];
+    int indice_comidas[MAX_LINHAS][MAX_COLUNAS];
+    tPortal portais[2];
+    tEstatisticaMovimento estatistica_movs[QTD_MOVIMENTOS];
+
+    int qtd_inicial_comidas;
+    int comidas_restantes;
+    int trocaram_posicao;
+
+    int comidas_inalcancaveis;
+    int impossivel;
+    int movs_necessarios;
+
+    tOpcoes opcoes;
+    char dir[MAX_DIR_SIZE];
+    // Acrescentado ao nome dos arquivos de resumo, estatisticas e ranking
+    char sufixo_saida[20];
+} tJogo;
+
+
+/////////////////////////////////// FUNCOES DO MAPA //////////////////////////////////
+/**
+ * @brief Le o mapa de um diretorio sem encerrar o programa em caso de erro.
+ *
+ * @param dir Diretorio do arquivo de texto
+ * @param mapa Struct do mapa lido
+ * @param erro Mensagem de erro, preenchida quando a leitura falha
+ * @return int 1 se o mapa foi lido, 0 caso contrario
+ */
+int leMapa(char* dir, tMapa* mapa, char* erro);
+
+/**
+ * @brief Atualiza o mapa com as posicoes dos personagens e comidas.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void atualizaMapa(tJogo* jogo);
+
+/**
+ * @brief Cria a trilha do pacman no mapa. Por onde o pacman passa, a trilha eh
+ * marcada com seu respectivo numero de movimento naquele momento.
+ *
+ * @param jogo Struct do jogo, que recebe a trilha criada
+ */
+void criaTrilha(tJogo* jogo);
+
+/**
+ * @brief Imprime o mapa no arquivo de saida.
+ *
+ * @param mapa Struct do mapa a ser impresso
+ * @param saidaFile Arquivo de saida
+ */
+void fprintMapa(tMapa mapa, FILE* saidaFile);
+
+
+////////////////////////////////// FUNCOES DO PACMAN /////////////////////////////////
+/**
+ * @brief Cria o Pacman na posicao inicial.
+ *
+ * @param jogo Struct do jogo
+ * @return tPacman Struct do Pacman criado
+ */
+tPacman criaPacman(const tJogo* jogo);
+
+/**
+ * @brief Move o Pacman de acordo com sua direcao.
+ *
+ * @param jogo Struct do jogo
+ * @return tPacman Struct do Pacman movido
+ */
+tPacman movePacman(const tJogo* jogo);
+
+/**
+ * @brief Verifica a colisao do Pacman com os objetos do mapa.
+ *
+ * @param jogo Struct do jogo
+ * @return tPacman Struct do Pacman com as colisoes verificadas
+ */
+tPacman verificaColisaoPacman(const tJogo* jogo);
+
+/**
+ * @brief Verifica se existe um Pacman na posicao indicada.
+ *
+ * @param x Posicao x
+ * @param y Posicao y
+ * @param pacman Struct do Pacman
+ * @return int 1 se existe um Pacman na posicao indicada, 0 caso contrario
+ */
+int temPacmanNaPosicao(int x, int y, tPacman pacman);
+
+
+///////////////////////////////// FUNCOES DOS FANTASMAS //////////////////////////////
+/**
+ * @brief Cria os fantasmas do jogo.
+ *
+ * @param jogo Struct do jogo, que recebe o vetor de fantasmas
+ */
+void criaFantasmas(tJogo* jogo);
+
+/**
+ * @brief Move os fantasmas de acordo com suas direcoes.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void moveFantasmas(tJogo* jogo);
+
+/**
+ * @brief Escolhe a classe de tamanho do mapa e a largura da grade de bloqueio, e marca
+ * a grade inteira como bloqueada.
+ *
+ * @param fantasmas Struct dos fantasmas
+ * @param linhas Quantidade de linhas do mapa
+ * @param colunas Quantidade de colunas do mapa
+ */
+void preparaBloqueio(tFantasmas* fantasmas, int linhas, int colunas);
+
+/**
+ * @brief Avanca uma rodada de todos os fantasmas, sem desvios condicionais. Quando a
+ * proxima celula eh parede ou portal, o fantasma inverte a direcao e recua. Chama o
+ * passo especializado para a classe de tamanho do mapa.
+ *
+ * @param classe Classe de tamanho do mapa
+ * @param qtd Quantidade de fantasmas
+ * @param x Vetor de posicoes x
+ * @param y Vetor de posicoes y
+ * @param dx Vetor de deslocamentos horizontais
+ * @param dy Vetor de deslocamentos verticais
+ * @param bloqueio Grade de bloqueio com borda, linha a linha, com a largura da classe
+ */
+void passoFantasmas(int classe, int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,
+                    const uint8_t* restrict bloqueio);
+
+/**
+ * Gera o passo dos fantasmas para uma grade com celulas do tipo 'tipo' e 'largura'
+ * colunas. Com a largura constante, o indice da celula vira deslocamentos e somas. O
+ * passo eh sem desvios: se a proxima celula for parede ou portal, o fantasma inverte a
+ * direcao (sentido = -1) e anda uma celula para tras; caso contrario, avanca.
+ */
+#define DEFINE_PASSO_FANTASMAS(nome, tipo, largura)                                                 \
+    void nome(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,       \
+              const tipo* restrict bloqueio) {                                                     \
+        int i;                                                                                     \
+        for (i = 0; i < qtd; i++) {                                                                \
+            int sentido = 1 - 2 * bloqueio[(y[i] + dy[i] + 1) * (largura) + x[i] + dx[i] + 1];     \
+            dx[i] *= sentido;                                                                      \
+            dy[i] *= sentido;                                                                      \
+            x[i] += dx[i];                                                                         \
+            y[i] += dy[i];                                                                         \
+        }                                                                                          \
+    }
+
+/**
+ * @brief Passos especializados para cada classe de tamanho, e o generico, com a grade
+ * de inteiros e MAX_COLUNAS + 2 colunas, usado como referencia em --mede-passos.
+ */
+void passoFantasmasPequeno(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasMedio(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasGrande(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasGenerico(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const int* restrict bloqueio);
+
+/**
+ * @brief Move os fantasmas no modo de perseguicao. Os movimentos seguem ciclos de
+ * CICLO_PERSEGUICAO jogadas, das quais as TEMPO_DISPERSAO primeiras sao de dispersao.
+ * Na dispersao, cada fantasma vai para o seu canto do mapa: Blinky (B) o superior
+ * direito, Pinky (P) o superior esquerdo, Inky (I) o inferior direito e Clyde (C) o
+ * inferior esquerdo. Na perseguicao, Blinky vai ate o Pacman; Pinky mira 4 celulas a
+ * frente dele; Inky mira o dobro do vetor entre Blinky e a celula 2 a frente do
+ * Pacman; e Clyde age como Blinky, mas volta ao seu canto quando esta a menos de
+ * RAIO_CLYDE celulas. Ir ate o Pacman eh descer no campo de distancias; os demais
+ * alvos sao buscados pela menor distancia em linha reta, como no jogo original. Um
+ * fantasma nao volta pelo caminho de onde veio, a nao ser que nao tenha outra saida.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void perseguePacman(tJogo* jogo);
+
+/**
+ * @brief Calcula, por busca em largura a partir do Pacman, a distancia de cada celula
+ * ate ele andando apenas pelas celulas livres da grade de bloqueio dos fantasmas.
+ * Celulas inalcancaveis ficam com -1.
+ *
+ * @param fantasmas Struct dos fantasmas, cujo campo eh preenchido
+ * @param x Posicao x do Pacman
+ * @param y Posicao y do Pacman
+ */
+void calculaCampoPerseguicao(tFantasmas* fantasmas, int x, int y);
+
+/**
+ * @brief Verifica se existe um fantasma na posicao indicada.
+ *
+ * @param x Posicao x
+ * @param y Posicao y
+ * @param fantasmas Struct dos fantasmas
+ * @return char Retorna o tipo do fantasma se existir, ou '\0' se nao existir.
+ */
+char temFantasmaNaPosicao(int x, int y, const tFantasmas* fantasmas);
+
+/**
+ * @brief Converte uma direcao ('w', 'a', 's' ou 'd') em deslocamento. Direcoes
+ * invalidas resultam em deslocamento nulo.
+ *
+ * @param direcao Direcao do movimento
+ * @param dx Deslocamento horizontal
+ * @param dy Deslocamento vertical
+ */
+void deltaDirecao(char direcao, int* dx, int* dy);
+
+
+///////////////////////////////// FUNCOES DAS COMIDAS ////////////////////////////////
+/**
+ * @brief Cria um vetor de comidas a partir do mapa do jogo.
+ *
+ * @param jogo Struct do jogo, que recebe o vetor de comidas
+ */
+void criaComidas(tJogo* jogo);
+
+/**
+ * @brief Cria o indice de comidas: para cada celula, a posicao da comida no vetor de
+ * comidas, ou -1 se nao houver comida nela.
+ *
+ * @param jogo Struct do jogo, que recebe o indice
+ */
+void indexaComidas(tJogo* jogo);
+
+/**
+ * @brief Remove uma comida do vetor de comidas se a posicao do parametro
+ * for igual a posicao da comida.
+ *
+ * @param x Posicao x do personagem
+ * @param y Posicao y do personagem
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void comeComida(int x, int y, tJogo* jogo);
+
+/**
+ * @brief Verifica se existe uma comida na posicao indicada.
+ *
+ * @param x Posicao x do personagem
+ * @param y Posicao y do personagem
+ * @param jogo Struct do jogo
+ * @return int 1 se existe uma comida na posicao, 0 se nao existe.
+ */
+int temComidaNaPosicao(int x, int y, const tJogo* jogo);
+
+
+///////////////////////////////// FUNCOES DOS PORTAIS ////////////////////////////////
+/**
+ * @brief Cria os portais do jogo.
+ *
+ * @param jogo Struct do jogo, que recebe os portais
+ */
+void criaPortais(tJogo* jogo);
+
+/**
+ * @brief Verifica se o Pacman esta em cima de um portal. Caso esteja, move ele para
+ * a posição do outro portal.
+ *
+ * @param pacman Struct do Pacman
+ * @param jogo Struct do jogo
+ * @return tPacman Struct do Pacman atualizada para nova posicao
+ */
+tPacman teleportaPacman(tPacman pacman, const tJogo* jogo);
+
+/**
+ * @brief Verifica se existe um portal na posicao indicada.
+ *
+ * @param x Posicao x
+ * @param y Posicao y
+ * @param portais Vetor de portais
+ * @return int 1 se existe um portal na posicao, 0 caso contrario
+ */
+int temPortalNaPosicao(int x, int y, const tPortal portais[QTD_PORTAIS]);
+
+
+///////////////////////////////////// FUNCOES DO JOGO ////////////////////////////////
+/**
+ * @brief Cria o Pacman, os fantasmas, as comidas e os portais a partir do mapa ja lido.
+ *
+ * @param jogo Struct do jogo com o mapa, que recebe os objetos
+ */
+void criaObjetos(tJogo* jogo);
+
+/**
+ * @brief Funcao que realiza o jogo. Chama as funcoes de movimentacao do Pacman, na
+ * direcao ja guardada em 'jogo.pacman.direcao', e dos fantasmas. Após isso, atualiza
+ * os objetos e o mapa.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void realizaJogo(tJogo* jogo);
+
+/**
+ * @brief Atualiza os objetos do jogo de acordo com as posicoes dos personagens.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void atualizaObjetos(tJogo* jogo);
+
+/**
+ * @brief Calcula o resultado do jogo, sem imprimir nada.
+ *
+ * @param jogo Struct do jogo a ser verificado
+ * @return int 1 se o jogador venceu, -1 se perdeu ou 0 caso o jogo nao tenha acabado
+ */
+int resultadoJogo(const tJogo* jogo);
+
+/**
+ * @brief Verifica se o Pacman e um fantasma trocaram de posicao.
+ *
+ * Essa funcao eh necessaria para que o Pacman nao troque sua posicao com
+ * um fantasma em vez de colidir com ele. O que causaria um bug, fazendo
+ * com que o jogo nao terminasse nesse caso especifico.
+ *
+ * @param pacman Struct do Pacman
+ * @param fantasmas Struct dos fantasmas
+ * @return int 1 se o Pacman e um fantasma trocaram de posicao, 0 caso contrario
+ */
+int verificaTrocaDePosicao(tPacman pacman, const tFantasmas* fantasmas);
+
+
+/**
+ * @brief Imprime o estado do jogo no formato da tela do jogo sem '--janela' e sem
+ * '--minimapa'.
+ *
+ * @param jogo Struct do jogo
+ */
+void imprimeEstado(const tJogo* jogo);
+
+
+/****************************************** MAIN ********************************************/
+int main(int argc, char* argv[])
+{
+    static tJogo jogo;
+    char erro[MAX_DIR_SIZE + 64];
+    int arg = 1;
+
+    if (arg < argc && strcmp(argv[arg], "--perseguicao") == 0) {
+        jogo.opcoes.perseguicao = 1;
+        arg++;
+    }
+
+    if (arg >= argc || strlen(argv[arg]) >= MAX_DIR_SIZE) {
+        printf("ERRO: Uso: %s [--perseguicao] <diretorio>\n", argv[0]);
+        return 1;
+    }
+
+    strcpy(jogo.dir, argv[arg]);
+
+    if (!leMapa(jogo.dir, &jogo.mapa, erro)) {
+        printf("ERRO: %s\n", erro);
+        return 1;
+    }
+
+    criaObjetos(&jogo);
+    indexaComidas(&jogo);
+    criaTrilha(&jogo);
+
+    // Mesma ordem do laco do jogo: a tela antes de ler cada jogada e depois dela
+    int venceu = 0;
+    while (venceu == 0) {
+        char comando = jogo.pacman.direcao;
+
+        imprimeEstado(&jogo);
+        scanf(" %c", &comando);
+
+        jogo.pacman.direcao = comando;
+        realizaJogo(&jogo);
+        imprimeEstado(&jogo);
+
+        venceu = resultadoJogo(&jogo);
+    }
+
+    printf("%s\n", venceu == 1 ? "Voce venceu!" : "Game over!");
+    printf("Pontuacao final: %d\n", jogo.pacman.pontos);
+
+    return 0;
+}
+
+void imprimeEstado(const tJogo* jogo) {
+    printf("Estado do jogo apos o movimento '%c':\n", jogo->pacman.direcao);
+    fprintMapa(jogo->mapa, stdout);
+    printf("Pontuacao: %d\n\n", jogo->pacman.pontos);
+}
+
+
+////////////////////////////////// FUNCOES DO MAPA ///////////////////////////////////
+int leMapa(char* dir, tMapa* mapa, char* erro) {
+    FILE* mapaFile;
+    char mapa_dir[MAX_DIR_SIZE + 9];
+    sprintf(mapa_dir, "%s/mapa.txt", dir);
+
+    mapaFile = fopen(mapa_dir, "r");
+
+    if (mapaFile == NULL) {
+        sprintf(erro, "arquivo 'mapa.txt' nao encontrado em %s", dir);
+        return 0;
+    }
+
+    tMapa lido = { 0 };
+
+    if (fscanf(mapaFile, "%d %d %d\n", &lido.linhas, &lido.colunas, &lido.lim_movs) != 3) {
+        sprintf(erro, "cabecalho invalido em %s/mapa.txt", dir);
+        fclose(mapaFile);
+        return 0;
+    }
+
+    if (lido.linhas < 1 || lido.linhas > MAX_LINHAS || lido.colunas < 1 || lido.colunas > MAX_COLUNAS || lido.lim_movs < 0) {
+        sprintf(erro, "dimensoes invalidas (%d x %d, %d movimentos) em %s/mapa.txt", lido.linhas, lido.colunas, lido.lim_movs, dir);
+        fclose(mapaFile);
+        return 0;
+    }
+
+    int i, j;
+    for (i = 0; i < lido.linhas; i++) {
+        for (j = 0; j < lido.colunas; j++) {
+            if (fscanf(mapaFile, "%c", &lido.mapa[i][j]) != 1 || lido.mapa[i][j] == '\n') {
+                sprintf(erro, "linha %d com menos de %d colunas em %s/mapa.txt", i + 1, lido.colunas, dir);
+                fclose(mapaFile);
+                return 0;
+            }
+        }
+        fscanf(mapaFile, "\n");
+    }
+
+    fclose(mapaFile);
+
+    *mapa = lido;
+
+    return 1;
+}
+
+void atualizaMapa(tJogo* jogo) {
+    int i, j;
+    tMapa* mapa = &jogo->mapa;
+
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == '#') continue;
+
+            mapa->mapa[i][j] = ' ';
+
+            if (temComidaNaPosicao(j, i, jogo)) {
+                mapa->mapa[i][j] = '*';
+            } else if (temPortalNaPosicao(j, i, jogo->portais)) {
+                mapa->mapa[i][j] = '@';
+            }
+
+            if (jogo->pacman.x == j && jogo->pacman.y == i && !temFantasmaNaPosicao(j, i, &jogo->fantasmas)) {
+                mapa->mapa[i][j] = '>';
+                mapa->trilha[i][j] = jogo->pacman.mov_atual;
+            }
+        }
+    }
+
+    // Os fantasmas sao desenhados do ultimo para o primeiro, para que o primeiro
+    // fantasma de uma celula compartilhada seja o que aparece no mapa
+    for (i = jogo->fantasmas.qtd - 1; i >= 0; i--) {
+        int x = jogo->fantasmas.x[i];
+        int y = jogo->fantasmas.y[i];
+
+        if (x < 0 || x >= mapa->colunas || y < 0 || y >= mapa->linhas) continue;
+
+        if (mapa->mapa[y][x] != '#') {
+            mapa->mapa[y][x] = jogo->fantasmas.tipo[i];
+        }
+    }
+}
+
+void criaTrilha(tJogo* jogo) {
+    int i, j;
+    tMapa* mapa = &jogo->mapa;
+
+    // A linha da trilha vai por ponteiro: indexando mapa->trilha[i][j] junto da leitura
+    // de mapa->mapa, o GCC 12 em -O1 descarta a chamada inteira em preparaJogo
+    for (i = 0; i < mapa->linhas; i++) {
+        int* trilha = mapa->trilha[i];
+
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == '>') {
+                trilha[j] = 0;
+            } else {
+                trilha[j] = -1;
+            }
+        }
+    }
+}
+
+void fprintMapa(tMapa mapa, FILE* saidaFile) {
+    int i;
+
+    // As linhas do mapa nao terminam em '\0'; cada uma eh escrita de uma vez
+    for (i = 0; i < mapa.linhas; i++) {
+        fwrite(mapa.mapa[i], 1, mapa.colunas, saidaFile);
+        fputc('\n', saidaFile);
+    }
+}
+
+
+////////////////////////////////// FUNCOES DO PACMAN /////////////////////////////////
+tPacman criaPacman(const tJogo* jogo) {
+    int i, j;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '>') {
+                tPacman pacman = { 0 };
+
+                pacman.y = i;
+                pacman.x = j;
+                pacman.pontos = 0;
+                pacman.movs_restantes = jogo->mapa.lim_movs;
+                pacman.mov_atual = 0;
+                pacman.colidiu_com_parede = 0;
+                pacman.colidiu_com_fantasma = 0;
+                pacman.colidiu_com_comida = 0;
+                pacman.colidiu_com_portal = 0;
+
+                return pacman;
+            }
+        }
+    }
+}
+
+tPacman movePacman(const tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    pacman.mov_atual++;
+    pacman.movs_restantes--;
+
+    int new_x = pacman.x;
+    int new_y = pacman.y;
+
+    if (pacman.direcao == 'w') {
+        new_y--;
+    } else if (pacman.direcao == 'a') {
+        new_x--;
+    } else if (pacman.direcao == 's') {
+        new_y++;
+    } else if (pacman.direcao == 'd') {
+        new_x++;
+    }
+
+    if (jogo->mapa.mapa[new_y][new_x] != '#') {
+        if (!jogo->trocaram_posicao) {
+            pacman.x = new_x;
+            pacman.y = new_y;
+        }
+        pacman.colidiu_com_parede = 0;
+    } else {
+        pacman.colidiu_com_parede = 1;
+    }
+
+    return pacman;
+}
+
+tPacman verificaColisaoPacman(const tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    pacman.colidiu_com_fantasma = 0;
+    pacman.colidiu_com_comida = 0;
+    pacman.colidiu_com_portal = 0;
+
+    if (temFantasmaNaPosicao(pacman.x, pacman.y, &jogo->fantasmas) || jogo->trocaram_posicao) {
+        pacman.colidiu_com_fantasma = 1;
+    } else if (temComidaNaPosicao(pacman.x, pacman.y, jogo)) {
+        pacman.colidiu_com_comida = 1;
+    }
+
+    if (temPortalNaPosicao(pacman.x, pacman.y, jogo->portais)) {
+        pacman.colidiu_com_portal = 1;
+    }
+
+    return pacman;
+}
+
+int temPacmanNaPosicao(int x, int y, tPacman pacman) {
+    return (x == pacman.x && y == pacman.y);
+}
+
+
+//////////////////////////////// FUNCOES DOS FANTASMAS ///////////////////////////////
+void criaFantasmas(tJogo* jogo) {
+    int i, j;
+
+    jogo->fantasmas.qtd = 0;
+
+    preparaBloqueio(&jogo->fantasmas, jogo->mapa.linhas, jogo->mapa.colunas);
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            BLOQUEIO(&jogo->fantasmas, j, i) = (posicao == '#' || posicao == '@');
+
+            if (posicao == 'B' || posicao == 'P' || posicao == 'I' || posicao == 'C') {
+                int idx = jogo->fantasmas.qtd;
+                char direcao = '\0';
+
+                if (posicao == 'B') direcao = 'a';
+                else if (posicao == 'P') direcao = 'w';
+                else if (posicao == 'I') direcao = 's';
+                else if (posicao == 'C') direcao = 'd';
+
+                jogo->fantasmas.x[idx] = j;
+                jogo->fantasmas.y[idx] = i;
+                jogo->fantasmas.tipo[idx] = posicao;
+                deltaDirecao(direcao, &jogo->fantasmas.dx[idx], &jogo->fantasmas.dy[idx]);
+
+                jogo->fantasmas.qtd++;
+            }
+        }
+    }
+}
+
+void moveFantasmas(tJogo* jogo) {
+    int i;
+    tFantasmas* fantasmas = &jogo->fantasmas;
+
+#ifdef MAPA_EMBUTIDO
+    if (MAPA_EMBUTIDO_CICLOS_FIXOS && !jogo->opcoes.perseguicao) {
+        posicionaFantasmasPeloCiclo(jogo);
+        return;
+    }
+#endif
+
+    // Um portal so bloqueia enquanto aparece no mapa; coberto pelo Pacman, nao bloqueia
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        char celula = jogo->mapa.mapa[jogo->portais[i].y][jogo->portais[i].x];
+        BLOQUEIO(fantasmas, jogo->portais[i].x, jogo->portais[i].y) = (celula == '#' || celula == '@');
+    }
+
+    if (jogo->opcoes.perseguicao) {
+        perseguePacman(jogo);
+        return;
+    }
+
+    passoFantasmas(fantasmas->classe, fantasmas->qtd, fantasmas->x, fantasmas->y, fantasmas->dx, fantasmas->dy, fantasmas->bloqueio);
+}
+
+void preparaBloqueio(tFantasmas* fantasmas, int linhas, int colunas) {
+    // A borda extra conta nas dimensoes da grade
+    if (linhas + 2 <= LARGURA_PEQUENA && colunas + 2 <= LARGURA_PEQUENA) {
+        fantasmas->classe = CLASSE_PEQUENA;
+        fantasmas->largura_bloqueio = LARGURA_PEQUENA;
+    } else if (colunas + 2 <= LARGURA_MEDIA) {
+        fantasmas->classe = CLASSE_MEDIA;
+        fantasmas->largura_bloqueio = LARGURA_MEDIA;
+    } else {
+        fantasmas->classe = CLASSE_GRANDE;
+        fantasmas->largura_bloqueio = LARGURA_GRANDE;
+    }
+
+    memset(fantasmas->bloqueio, 1, sizeof(fantasmas->bloqueio));
+}
+
+void passoFantasmas(int classe, int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,
+                    const uint8_t* restrict bloqueio) {
+    if (classe == CLASSE_PEQUENA) {
+        passoFantasmasPequeno(qtd, x, y, dx, dy, bloqueio);
+    } else if (classe == CLASSE_MEDIA) {
+        passoFantasmasMedio(qtd, x, y, dx, dy, bloqueio);
+    } else {
+        passoFantasmasGrande(qtd, x, y, dx, dy, bloqueio);
+    }
+}
+
+DEFINE_PASSO_FANTASMAS(passoFantasmasPequeno, uint8_t, LARGURA_PEQUENA)
+DEFINE_PASSO_FANTASMAS(passoFantasmasMedio, uint8_t, LARGURA_MEDIA)
+DEFINE_PASSO_FANTASMAS(passoFantasmasGrande, uint8_t, LARGURA_GRANDE)
+DEFINE_PASSO_FANTASMAS(passoFantasmasGenerico, int, MAX_COLUNAS + 2)
+
+void perseguePacman(tJogo* jogo) {
+    int i, k;
+    tFantasmas* fantasmas = &jogo->fantasmas;
+    int portais = 0;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        portais |= BLOQUEIO(fantasmas, jogo->portais[i].x, jogo->portais[i].y) << i;
+    }
+
+    // O campo so depende da posicao do Pacman e de quais portais bloqueiam
+    if (!fantasmas->campo_valido || fantasmas->campo_x != jogo->pacman.x || fantasmas->campo_y != jogo->pacman.y ||
+        fantasmas->campo_portais != portais) {
+        calculaCampoPerseguicao(fantasmas, jogo->pacman.x, jogo->pacman.y);
+        fantasmas->campo_valido = 1;
+        fantasmas->campo_x = jogo->pacman.x;
+        fantasmas->campo_y = jogo->pacman.y;
+        fantasmas->campo_portais = portais;
+    }
+
+    int dispersao = jogo->pacman.mov_atual % CICLO_PERSEGUICAO < TEMPO_DISPERSAO;
+    int linhas = jogo->mapa.linhas;
+    int colunas = jogo->mapa.colunas;
+    int pdx, pdy;
+    deltaDirecao(jogo->pacman.direcao, &pdx, &pdy);
+
+    // Inky usa a posicao do primeiro Blinky no inicio da jogada; sem Blinky, mira a
+    // propria celula 2 a frente do Pacman
+    int pivo_x = jogo->pacman.x + 2 * pdx;
+    int pivo_y = jogo->pacman.y + 2 * pdy;
+    int alvo_inky_x = pivo_x, alvo_inky_y = pivo_y;
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (fantasmas->tipo[i] == 'B') {
+            alvo_inky_x = 2 * pivo_x - fantasmas->x[i];
+            alvo_inky_y = 2 * pivo_y - fantasmas->y[i];
+            break;
+        }
+    }
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        int x = fantasmas->x[i];
+        int y = fantasmas->y[i];
+        char tipo = fantasmas->tipo[i];
+        int usa_campo = 0, alvo_x = 0, alvo_y = 0;
+
+        if (dispersao || (tipo == 'C' && fantasmas->campo[y][x] >= 0 && fantasmas->campo[y][x] < RAIO_CLYDE)) {
+            alvo_x = (tipo == 'B' || tipo == 'I') ? colunas - 1 : 0;
+            alvo_y = (tipo == 'I' || tipo == 'C') ? linhas - 1 : 0;
+        } else if (tipo == 'P') {
+            alvo_x = jogo->pacman.x + 4 * pdx;
+            alvo_y = jogo->pacman.y + 4 * pdy;
+        } else if (tipo == 'I') {
+            alvo_x = alvo_inky_x;
+            alvo_y = alvo_inky_y;
+        } else {
+            usa_campo = 1;
+        }
+
+        // Comeca pela direcao atual, para que ela venca os empates
+        int melhor_dx = 0, melhor_dy = 0, melhor_valor = 0, achou = 0;
+        int candidatos[QTD_MOVIMENTOS + 1][2] = {
+            { fantasmas->dx[i], fantasmas->dy[i] }, { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 }
+        };
+
+        for (k = 0; k <= QTD_MOVIMENTOS; k++) {
+            int cdx = candidatos[k][0];
+            int cdy = candidatos[k][1];
+
+            if (cdx == 0 && cdy == 0) continue;
+            if (cdx == -fantasmas->dx[i] && cdy == -fantasmas->dy[i]) continue;
+            if (BLOQUEIO(fantasmas, x + cdx, y + cdy)) continue;
+
+            // Celulas de onde nao se chega ao Pacman contam como as mais distantes
+            int valor;
+            if (usa_campo) {
+                valor = fantasmas->campo[y + cdy][x + cdx];
+                if (valor < 0) valor = MAX_LINHAS * MAX_COLUNAS;
+            } else {
+                valor = (x + cdx - alvo_x) * (x + cdx - alvo_x) + (y + cdy - alvo_y) * (y + cdy - alvo_y);
+            }
+            valor = -valor;
+
+            if (!achou || valor > melhor_valor) {
+                melhor_dx = cdx;
+                melhor_dy = cdy;
+                melhor_valor = valor;
+                achou = 1;
+            }
+        }
+
+        // Sem outra saida, volta; sem nem isso, fica parado
+        if (!achou && !BLOQUEIO(fantasmas, x - fantasmas->dx[i], y - fantasmas->dy[i])) {
+            melhor_dx = -fantasmas->dx[i];
+            melhor_dy = -fantasmas->dy[i];
+        }
+
+        fantasmas->dx[i] = melhor_dx;
+        fantasmas->dy[i] = melhor_dy;
+        fantasmas->x[i] += melhor_dx;
+        fantasmas->y[i] += melhor_dy;
+    }
+}
+
+void calculaCampoPerseguicao(tFantasmas* fantasmas, int x, int y) {
+    static _Thread_local int fila[MAX_LINHAS * MAX_COLUNAS][2];
+    int inicio = 0, fim = 0;
+    int i, j;
+
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            fantasmas->campo[i][j] = -1;
+        }
+    }
+
+    fantasmas->campo[y][x] = 0;
+    fila[fim][0] = x;
+    fila[fim][1] = y;
+    fim++;
+
+    while (inicio < fim) {
+        int cx = fila[inicio][0];
+        int cy = fila[inicio][1];
+        inicio++;
+
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            int nx = cx + (i == D) - (i == A);
+            int ny = cy + (i == S) - (i == W);
+
+            if (BLOQUEIO(fantasmas, nx, ny) || fantasmas->campo[ny][nx] >= 0) continue;
+
+            fantasmas->campo[ny][nx] = fantasmas->campo[cy][cx] + 1;
+            fila[fim][0] = nx;
+            fila[fim][1] = ny;
+            fim++;
+        }
+    }
+}
+
+char temFantasmaNaPosicao(int x, int y, const tFantasmas* fantasmas) {
+    int i;
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (fantasmas->x[i] == x && fantasmas->y[i] == y) {
+            return fantasmas->tipo[i];
+        }
+    }
+
+    return '\0';
+}
+
+void deltaDirecao(char direcao, int* dx, int* dy) {
+    *dx = (direcao == 'd') - (direcao == 'a');
+    *dy = (direcao == 's') - (direcao == 'w');
+}
+
+
+///////////////////////////////// FUNCOES DAS COMIDAS ////////////////////////////////
+void criaComidas(tJogo* jogo) {
+    int i, j;
+
+    jogo->qtd_inicial_comidas = 0;
+    jogo->comidas_restantes = 0;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '*') {
+                tComida comida = { 0 };
+
+                comida.x = j;
+                comida.y = i;
+                comida.foi_comida = 0;
+
+                jogo->comidas[jogo->qtd_inicial_comidas] = comida;
+                jogo->qtd_inicial_comidas++;
+                jogo->comidas_restantes++;
+            }
+        }
+    }
+}
+
+void indexaComidas(tJogo* jogo) {
+    int i, j;
+
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            jogo->indice_comidas[i][j] = -1;
+        }
+    }
+
+    for (i = 0; i < jogo->qtd_inicial_comidas; i++) {
+        if (!jogo->comidas[i].foi_comida) {
+            jogo->indice_comidas[jogo->comidas[i].y][jogo->comidas[i].x] = i;
+        }
+    }
+}
+
+void comeComida(int x, int y, tJogo* jogo) {
+    if (x < 0 || x >= MAX_COLUNAS || y < 0 || y >= MAX_LINHAS) return;
+
+    int i = jogo->indice_comidas[y][x];
+
+    if (i >= 0) {
+        tComida comida = jogo->comidas[i];
+
+        comida.x = -1;
+        comida.y = -1;
+        comida.foi_comida = 1;
+
+        jogo->comidas[i] = comida;
+        jogo->comidas_restantes--;
+        jogo->indice_comidas[y][x] = -1;
+    }
+}
+
+int temComidaNaPosicao(int x, int y, const tJogo* jogo) {
+    if (x < 0 || x >= MAX_COLUNAS || y < 0 || y >= MAX_LINHAS) return 0;
+
+    return jogo->indice_comidas[y][x] >= 0;
+}
+
+
+///////////////////////////////// FUNCOES DOS PORTAIS ////////////////////////////////
+void criaPortais(tJogo* jogo) {
+    int i, j, idx = 0;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '@') {
+                jogo->portais[idx].x = j;
+                jogo->portais[idx].y = i;
+
+                idx++;
+            }
+        }
+    }
+}
+
+tPacman teleportaPacman(tPacman pacman, const tJogo* jogo) {
+    int i;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        tPortal portal = jogo->portais[i];
+
+        if (pacman.x == portal.x && pacman.y == portal.y) {
+            if (i == 0) {
+                pacman.x = jogo->portais[1].x;
+                pacman.y = jogo->portais[1].y;
+            } else {
+                pacman.x = jogo->portais[0].x;
+                pacman.y = jogo->portais[0].y;
+            }
+
+            return pacman;
+        }
+    }
+
+    return pacman;
+}
+
+int temPortalNaPosicao(int x, int y, const tPortal portais[QTD_PORTAIS]) {
+    int i;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        if (portais[i].x == x && portais[i].y == y) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/////////////////////////////////// FUNCOES DO JOGO //////////////////////////////////
+void criaObjetos(tJogo* jogo) {
+    jogo->pacman = criaPacman(jogo);
+    criaFantasmas(jogo);
+    criaComidas(jogo);
+    criaPortais(jogo);
+}
+
+void realizaJogo(tJogo* jogo) {
+    moveFantasmas(jogo);
+    jogo->trocaram_posicao = verificaTrocaDePosicao(jogo->pacman, &jogo->fantasmas);
+    jogo->pacman = movePacman(jogo);
+
+    jogo->pacman = verificaColisaoPacman(jogo);
+
+    atualizaObjetos(jogo);
+    atualizaMapa(jogo);
+}
+
+void atualizaObjetos(tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    if (pacman.colidiu_com_comida) {
+        pacman.pontos++;
+        comeComida(pacman.x, pacman.y, jogo);
+    } else if (pacman.colidiu_com_portal) {
+        jogo->mapa.trilha[pacman.y][pacman.x] = pacman.mov_atual;
+        pacman = teleportaPacman(pacman, jogo);
+    }
+
+    jogo->pacman = pacman;
+}
+
+int resultadoJogo(const tJogo* jogo) {
+    int venceu = 0;
+
+    if (jogo->comidas_restantes == 0) venceu = 1;
+    if (jogo->pacman.movs_restantes == 0) venceu = -1;
+    if (jogo->pacman.colidiu_com_fantasma) venceu = -1;
+    if (jogo->impossivel) venceu = -1;
+
+    return venceu;
+}
+
+int verificaTrocaDePosicao(tPacman pacman, const tFantasmas* fantasmas) {
+    int i;
+    int dx, dy;
+
+    deltaDirecao(pacman.direcao, &dx, &dy);
+
+    // Houve troca se um fantasma esta na posicao do Pacman andando na direcao oposta
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (temPacmanNaPosicao(fantasmas->x[i], fantasmas->y[i], pacman)) {
+            if ((dx != 0 || dy != 0) && fantasmas->dx[i] == -dx && fantasmas->dy[i] == -dy) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
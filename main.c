@@ -13,16 +13,77 @@
  *
 *************************************************************************************/
 
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <ftw.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <signal.h>
+
+#include "pacman_bot.h"
 
 #define MAX_DIR_SIZE 1001
-#define QTD_FANTASMAS 4
-#define QTD_COMIDAS 38 * 98 - 1
+#define MAX_LINHAS 40
+#define MAX_COLUNAS 100
+#define QTD_FANTASMAS (38 * 98 - 1)
+#define QTD_COMIDAS (38 * 98 - 1)
 #define QTD_MOVIMENTOS 4
 #define QTD_PORTAIS 2
+#define TAM_FILA_ESCRITA 1024
+#define QTD_FILAS_ESCRITA 8
+#define QTD_ARQUIVOS_ABERTOS 16
+#define TAM_LOTE_SESSAO (64 * 1024)
+#define TAM_LOTE_RESUMO (16 * 1024)
+#define LIMITE_MST_COMIDAS 64
+#define TAM_CACHE_NIVEIS 8
+#define NIVEIS_ANTECIPADOS 2
+#define VIDAS_CAMPANHA 3
+#define TAM_HISTORICO (1 << 20)
+#define CELULAS_TRILHA_CANDIDATAS 7
+#define INTERVALO_QUADROS_CHAVE 64
+#define CICLO_PERSEGUICAO 27
+#define TEMPO_DISPERSAO 7
+#define RAIO_CLYDE 8
+#define SEMENTES_TORNEIO 3
+#define VERSAO_METRICAS 2
+#define VERSAO_TRANSMISSAO 1
+#define QTD_QUADROS_TRANSMISSAO 256
+#define INTERVALO_CHAVE_TRANSMISSAO 32
+#define TAM_FATIA_LOTE 8
+#define MAX_TENTATIVAS_LOTE 3
+#define MAX_CONEXOES_LOTE 64
+
+#define CLASSE_PEQUENA 0
+#define CLASSE_MEDIA 1
+#define CLASSE_GRANDE 2
+#define LARGURA_PEQUENA 16
+#define LARGURA_MEDIA 32
+#define LARGURA_GRANDE 128
+
+#define MAX_JOGADORES 35
+#define SIMBOLOS_JOGADORES "123456789abcdefghijklmnopqrstuvwxyz"
+
+#define LOTE_PEDIDO 1
+#define LOTE_RESULTADO 2
+#define LOTE_FATIA 3
+#define LOTE_FIM 4
 
 #define W 0
 #define A 1
@@ -34,8 +95,8 @@ typedef struct
     int linhas;
     int colunas;
     int lim_movs;
-    char mapa[40][100];
-    int trilha[40][100];
+    char mapa[MAX_LINHAS][MAX_COLUNAS];
+    int trilha[MAX_LINHAS][MAX_COLUNAS];
 } tMapa;
 
 typedef struct
@@ -52,22 +113,45 @@ typedef struct
     int colidiu_com_portal;
 } tPacman;
 
+/**
+ * Os fantasmas sao guardados como estrutura de vetores: cada campo fica em um vetor
+ * proprio, e a direcao eh codificada como deslocamento (dx, dy). Assim o passo de
+ * movimento percorre vetores contiguos sem desvios, e o compilador pode vetoriza-lo.
+ * A grade 'bloqueio' marca com 1 as paredes e portais, que fazem o fantasma voltar. Ela
+ * tem uma borda extra, tambem bloqueada, e eh acessada com BLOQUEIO(fantasmas, x, y).
+ * Sua largura depende da classe de tamanho do mapa, escolhida ao carrega-lo: 16 colunas
+ * nos mapas pequenos, em que a grade inteira cabe em 256 bytes, 32 nos medios e 128 nos
+ * grandes. Cada classe tem o seu passo de fantasmas, com a largura fixa.
+ * No modo de perseguicao, 'campo' guarda a distancia de cada celula ate o Pacman pelo
+ * caminho dos fantasmas, e so eh recalculado quando o Pacman ou os portais mudam.
+ */
 typedef struct
 {
-    int x;
-    int y;
-    int existe;
-    char tipo;
-    char direcao;
-    int colidiu_com_parede;
-    int colidiu_com_portal;
-} tFantasma;
+    int qtd;
+    int x[QTD_FANTASMAS];
+    int y[QTD_FANTASMAS];
+    int dx[QTD_FANTASMAS];
+    int dy[QTD_FANTASMAS];
+    char tipo[QTD_FANTASMAS];
+    int classe;
+    int largura_bloqueio;
+    uint8_t bloqueio[(MAX_LINHAS + 2) * LARGURA_GRANDE];
+
+    int campo[MAX_LINHAS][MAX_COLUNAS];
+    int campo_valido;
+    int campo_x;
+    int campo_y;
+    int campo_portais;
+} tFantasmas;
+
+#define BLOQUEIO(fantasmas, x, y) ((fantasmas)->bloqueio[((y) + 1) * (fantasmas)->largura_bloqueio + (x) + 1])
 
 typedef struct
 {
     int x;
     int y;
     int foi_comida;
+    int alcancavel;
 } tComida;
 
 typedef struct
@@ -85,12 +169,45 @@ typedef struct
     int y;
 } tPortal;
 
+typedef struct
+{
+    int encerra_impossivel;
+    int mapa_de_calor;
+    int desfazer;
+    int gravar;
+    int perseguicao;
+    int bot;
+    int threads;
+    int registrar_sessao;
+    int antecipar;
+    int janela_linhas;
+    int janela_colunas;
+    int minimapa;
+    int trilha_binaria;
+    int multijogador;
+} tOpcoes;
+
+/**
+ * Contadores por celula acumulados ao longo de varias partidas no mesmo mapa: quantas
+ * vezes o Pacman passou por cada celula e quantas vezes morreu nela. Os incrementos
+ * sao atomicos, para que partidas em threads diferentes possam dividir a mesma tabela.
+ */
+typedef struct
+{
+    int linhas;
+    int colunas;
+    atomic_ullong partidas;
+    atomic_uint visitas[MAX_LINHAS][MAX_COLUNAS];
+    atomic_uint mortes[MAX_LINHAS][MAX_COLUNAS];
+} tMapaDeCalor;
+
 typedef struct
 {
     tMapa mapa;
     tPacman pacman;
-    tFantasma fantasmas[QTD_FANTASMAS];
+    tFantasmas fantasmas;
     tComida comidas[QTD_COMIDAS];
+    int indice_comidas[MAX_LINHAS][MAX_COLUNAS];
     tPortal portais[2];
     tEstatisticaMovimento estatistica_movs[QTD_MOVIMENTOS];
 
@@ -98,35 +215,499 @@ typedef struct
     int comidas_restantes;
     int trocaram_posicao;
 
+    int comidas_inalcancaveis;
+    int impossivel;
+    int movs_necessarios;
+
+    tOpcoes opcoes;
     char dir[MAX_DIR_SIZE];
+    // Acrescentado ao nome dos arquivos de resumo, estatisticas e ranking
+    char sufixo_saida[20];
 } tJogo;
 
+/**
+ * Resultado da validacao de um mapa do acervo, que vira uma linha do catalogo.
+ */
+typedef struct
+{
+    char dir[MAX_DIR_SIZE];
+    unsigned long long hash;
+    int linhas;
+    int colunas;
+    int lim_movs;
+    int comidas;
+    char status[MAX_DIR_SIZE + 64];
+} tItemCatalogo;
+
+typedef struct
+{
+    tItemCatalogo* itens;
+    int qtd;
+    int capacidade;
+    atomic_int proximo;
+} tAcervo;
+
+/**
+ * Nivel ja carregado e pronto para ser jogado. 'uso' guarda o momento do ultimo acesso,
+ * usado para descartar o nivel usado ha mais tempo quando o cache enche. Um nivel com
+ * mapa invalido tambem fica no cache, com 'valido' em 0 e a mensagem em 'erro', para
+ * que o erro so seja mostrado quando o jogador chegar nele.
+ */
+typedef struct
+{
+    int nivel;
+    unsigned long uso;
+    int valido;
+    char erro[MAX_DIR_SIZE + 64];
+    tJogo jogo;
+} tNivelPreparado;
+
+/**
+ * Campanha: lista ordenada de niveis e o cache de niveis preparados. Uma thread de
+ * preparacao carrega os proximos niveis enquanto o atual eh jogado.
+ */
+typedef struct
+{
+    char (*dirs)[MAX_DIR_SIZE];
+    int qtd_niveis;
+    int nivel_atual;
+    int encerrar;
+    unsigned long relogio;
+
+    tNivelPreparado* cache;
+    int qtd_cache;
+
+    pthread_mutex_t trava;
+    pthread_cond_t mudou;
+    pthread_t thread;
+} tCampanha;
+
+/**
+ * Historico de jogadas para desfazer e refazer. Cada jogada vira um registro de tamanho
+ * variavel com apenas o que mudou: posicao, direcao e colisoes do Pacman, a comida
+ * pega, as celulas da trilha sobrescritas e os fantasmas que mudaram de direcao. O
+ * resto (passo dos fantasmas, pontos, contadores e estatisticas) eh deduzido disso.
+ * Os registros ficam em um buffer circular de bytes e tem o tamanho no comeco e no fim,
+ * para que possam ser percorridos nos dois sentidos; quando o buffer enche, os mais
+ * antigos sao descartados. As posicoes 'inicio', 'atual' e 'topo' so crescem, e sao
+ * reduzidas modulo a capacidade ao acessar 'dados'. Entre 'atual' e 'topo' ficam as
+ * jogadas desfeitas, que podem ser refeitas.
+ */
+typedef struct
+{
+    unsigned char* dados;
+    size_t inicio;
+    size_t atual;
+    size_t topo;
+
+    // Estado anterior a jogada em andamento, usado para montar o proximo registro
+    tPacman pacman;
+    int trocaram_posicao;
+    int qtd_candidatas;
+    int candidatas[CELULAS_TRILHA_CANDIDATAS][4];
+    int dx[QTD_FANTASMAS];
+    int dy[QTD_FANTASMAS];
+    unsigned char registro[32 + 3 * QTD_FANTASMAS];
+} tHistorico;
+
+typedef struct
+{
+    uint32_t movimento;
+    uint64_t posicao;
+} tQuadroChave;
+
+/**
+ * Gravacao de uma partida em 'saida/gravacao.bin', enviada aos poucos para a thread de
+ * escrita. O arquivo tem um cabecalho ("PMGR", versao, intervalo entre quadros-chave,
+ * dimensoes, limite de movimentos, as opcoes que mudam o jogo ou a impressao e o mapa
+ * inicial) e uma sequencia de blocos: 'M' seguido da direcao de cada jogada, e 'K'
+ * seguido do numero do movimento, do tamanho e do estado compacto do jogo a cada
+ * INTERVALO_QUADROS_CHAVE jogadas. O estado compacto tem o mapa desenhado, o Pacman,
+ * os contadores, as estatisticas, os fantasmas, um bit por celula com comida e as
+ * celulas da trilha ja visitadas; o resto eh refeito a partir do mapa inicial. Ao fim
+ * da partida vem o indice ('I', quantidade e pares movimento/posicao dos
+ * quadros-chave), a posicao do indice e a marca "PMIX". Cada jogada eh enviada assim
+ * que acontece; so o indice fica em memoria ate o fim. Uma gravacao interrompida nao
+ * tem indice, mas ainda pode ser lida bloco a bloco ate a ultima jogada enviada.
+ */
+typedef struct
+{
+    char caminho[MAX_DIR_SIZE + 26];
+    uint64_t tamanho;
+    tQuadroChave* quadros;
+    int qtd_quadros;
+    int capacidade;
+} tGravacao;
+
+/**
+ * Bot carregado de uma biblioteca compartilhada com a opcao '--bot'.
+ */
+typedef struct
+{
+    void* biblioteca;
+    const tPacmanBot* bot;
+} tBotCarregado;
+
+static tBotCarregado bot_carregado;
+
+typedef struct
+{
+    int bot;
+    int mapa;
+    int semente;
+} tTarefaTorneio;
+
+/**
+ * Fila de tarefas de um trabalhador do torneio. O dono tira tarefas do fim; quando a
+ * sua acaba, ele rouba do inicio da fila de outro trabalhador.
+ */
+typedef struct
+{
+    tTarefaTorneio* itens;
+    int inicio;
+    int fim;
+    pthread_mutex_t trava;
+} tFilaTorneio;
+
+/**
+ * Totais de um bot ao longo do torneio, ordenados como o ranking de movimentos.
+ */
+typedef struct
+{
+    char nome[MAX_DIR_SIZE];
+    int partidas;
+    int vitorias;
+    long long comidas_pegas;
+    long long colisoes_apenas_parede;
+    long long qtd_realizado;
+} tResultadoBot;
+
+/**
+ * Torneio: todos os bots jogam todos os mapas com SEMENTES_TORNEIO sementes cada. Cada
+ * partida terminada vira uma linha no arquivo de resultados e soma nos totais do bot,
+ * ambos protegidos por 'trava'.
+ */
+typedef struct
+{
+    tBotCarregado* bots;
+    int qtd_bots;
+    char (*dirs)[MAX_DIR_SIZE];
+    tJogo** mapas;
+    tMapaDeCalor** calor;
+    int qtd_mapas;
+    tOpcoes opcoes;
+
+    tFilaTorneio* filas;
+    int qtd_trabalhadores;
+
+    FILE* resultados;
+    tResultadoBot* totais;
+    pthread_mutex_t trava;
+} tTorneio;
+
+typedef struct
+{
+    tTorneio* torneio;
+    int indice;
+    pthread_t thread;
+} tTrabalhadorTorneio;
+
+/**
+ * Metricas publicadas a cada jogada em um segmento de memoria compartilhada.
+ */
+typedef struct
+{
+    uint64_t movimento;
+    int64_t pontos;
+    int64_t comidas_restantes;
+    int64_t movs_restantes;
+    char direcoes[QTD_MOVIMENTOS];
+    int64_t comidas_pegas[QTD_MOVIMENTOS];
+    int64_t colisoes_parede[QTD_MOVIMENTOS];
+    int64_t colisoes_apenas_parede[QTD_MOVIMENTOS];
+    int64_t qtd_realizado[QTD_MOVIMENTOS];
+    double movimentos_por_segundo;
+    uint64_t latencia_ns;
+    // Soma das duracoes de todas as jogadas: o tempo do motor, sem a entrada e a tela
+    uint64_t tempo_jogadas_ns;
+    int32_t encerrado;
+} tValoresMetricas;
+
+/**
+ * Segmento de metricas protegido por um seqlock: o jogo torna 'sequencia' impar, grava
+ * os valores e a torna par de novo. O leitor copia os valores e so aceita a copia se
+ * 'sequencia' era par e nao mudou durante ela, tentando de novo caso contrario. Assim o
+ * jogo nunca espera pelos leitores.
+ */
+typedef struct
+{
+    uint32_t versao;
+    atomic_uint sequencia;
+    tValoresMetricas valores;
+} tMetricas;
+
+/**
+ * Quadro transmitido aos espectadores: a linha de cabecalho de printEstadoJogo (direcao
+ * e pontuacao) e o mapa, inteiro (quadro-chave) ou apenas as celulas que mudaram desde
+ * o quadro anterior, como trios x, y e caractere. 'sequencia' eh 2n + 1 enquanto o
+ * quadro n eh escrito e 2n + 2 depois.
+ */
+typedef struct
+{
+    atomic_ullong sequencia;
+    int32_t chave;
+    int32_t linhas;
+    int32_t colunas;
+    int32_t pontos;
+    char direcao;
+    int32_t qtd_celulas;
+    unsigned char dados[MAX_LINHAS * MAX_COLUNAS];
+} tQuadroTransmissao;
+
+/**
+ * Anel de quadros em memoria compartilhada, com um produtor (o jogo) e qualquer numero
+ * de espectadores. O jogo nunca espera: ele sobrescreve os quadros mais antigos, e um
+ * espectador que ficar para tras volta ao ultimo quadro-chave.
+ */
+typedef struct
+{
+    uint32_t versao;
+    atomic_ullong publicados;
+    atomic_ullong ultima_chave;
+    atomic_int encerrado;
+    tQuadroTransmissao quadros[QTD_QUADROS_TRANSMISSAO];
+} tTransmissao;
+
+/**
+ * Registro da sessao em 'saida/sessao.log': cabecalho ("PMSL", versao, linhas e
+ * colunas), o mapa inicial uma unica vez e, para cada estado impresso, um bloco 'F' com
+ * a direcao, a variacao da pontuacao e as celulas que mudaram desde o estado anterior.
+ * Cada celula eh o intervalo desde a anterior (em ordem de linha) e o novo caractere.
+ * O fim do jogo eh um bloco 'E' com o resultado e a pontuacao final. Os numeros sao
+ * gravados em varint, 7 bits por byte. Os blocos se acumulam em 'lote' e so sao
+ * enviados a thread de escrita quando passam de TAM_LOTE_SESSAO bytes ou no fim do jogo.
+ */
+typedef struct
+{
+    int ativo;
+    char caminho[MAX_DIR_SIZE + 26];
+    char dir[MAX_DIR_SIZE];
+    tMapa anterior;
+    int pontos;
+    FILE* lote;
+    char* dados;
+    size_t tamanho;
+} tSessao;
+
+/**
+ * Antecipacao das jogadas: enquanto o jogo espera o comando do jogador, uma thread
+ * calcula o estado seguinte para cada uma das quatro direcoes e ja o formata como
+ * printEstadoJogo o imprimiria. Com a tecla, o laco do jogo so escolhe o estado pronto
+ * e escreve o texto guardado. 'prontos' conta as direcoes ja calculadas do pedido
+ * atual, na ordem w, a, s, d. O estado escolhido nao eh copiado: o laco do jogo troca o
+ * ponteiro do seu estado atual com o do sucessor, e o buffer antigo vira o sucessor.
+ */
+typedef struct
+{
+    tJogo base;
+    tJogo estados[QTD_MOVIMENTOS];
+    tJogo* sucessores[QTD_MOVIMENTOS];
+    char* textos[QTD_MOVIMENTOS];
+    size_t tamanhos[QTD_MOVIMENTOS];
+
+    int pedidos;
+    int atendidos;
+    int prontos;
+    int encerrar;
+
+    pthread_mutex_t trava;
+    pthread_cond_t mudou;
+    pthread_t thread;
+} tAntecipacao;
+
+/**
+ * Partida de um lote: o diretorio do mapa e o arquivo com as jogadas, uma por linha.
+ * Vai do coordenador para os trabalhadores pelo socket.
+ */
+typedef struct
+{
+    int32_t indice;
+    char dir[MAX_DIR_SIZE];
+    char jogadas[MAX_DIR_SIZE];
+} tTarefaLote;
+
+/**
+ * Resultado de uma partida do lote, devolvido pelo trabalhador. 'situacao' eh 1 se a
+ * partida foi jogada e 0 se o mapa ou as jogadas nao puderam ser lidos.
+ */
+typedef struct
+{
+    int32_t indice;
+    int32_t situacao;
+    int32_t resultado;
+    int32_t pontos;
+    tEstatisticaMovimento estatisticas[QTD_MOVIMENTOS];
+} tResultadoLote;
+
+/**
+ * Cabecalho das mensagens do lote. O trabalhador manda LOTE_PEDIDO quando quer mais
+ * trabalho e LOTE_RESULTADO, seguido de um tResultadoLote, a cada partida jogada. O
+ * coordenador responde a um pedido com LOTE_FATIA, seguido de 'qtd' tarefas, ou com
+ * LOTE_FIM quando nao ha mais nada a fazer.
+ */
+typedef struct
+{
+    int32_t tipo;
+    int32_t qtd;
+} tMensagemLote;
+
+typedef struct
+{
+    int fd;
+    int fatia;
+    int esperando;
+} tConexaoLote;
+
+/**
+ * Lote de partidas dividido em fatias de 'tam_fatia' partidas consecutivas. As fatias
+ * ainda nao distribuidas ficam em uma fila circular; cada trabalhador recebe uma fatia
+ * por vez, so quando pede. Se um trabalhador cai, a partida em que ele estava ganha uma
+ * tentativa e o resto da fatia volta para a fila.
+ */
+typedef struct
+{
+    tTarefaLote* tarefas;
+    tResultadoLote* resultados;
+    int* recebido;
+    int* tentativas;
+    int qtd_tarefas;
+    int concluidas;
+
+    int tam_fatia;
+    int qtd_fatias;
+    int* fila;
+    int inicio_fila;
+    int qtd_fila;
+
+    tConexaoLote conexoes[MAX_CONEXOES_LOTE];
+    int qtd_conexoes;
+} tLote;
+
+/**
+ * Partida com varios Pac-Men no mesmo mapa, um em cada '>' do mapa, jogada em rodadas
+ * sincronizadas. O mapa, os fantasmas, as comidas e os portais ficam em 'jogo' e sao
+ * compartilhados; 'jogo.pacman' e 'jogo.estatistica_movs' recebem os de cada jogador
+ * enquanto ele eh resolvido, para que as funcoes de um jogador so sirvam para todos.
+ * Um jogador que encosta em um fantasma fica eliminado; os outros continuam. O resumo
+ * de cada jogador se acumula em 'resumos' e so vai a thread de escrita quando passa de
+ * TAM_LOTE_RESUMO bytes ou no fim da partida.
+ */
+typedef struct
+{
+    tJogo jogo;
+    int qtd_jogadores;
+    int cooperativo;
+    int rodada;
+
+    tPacman pacmen[MAX_JOGADORES];
+    tEstatisticaMovimento estatisticas[MAX_JOGADORES][QTD_MOVIMENTOS];
+    int ativo[MAX_JOGADORES];
+
+    FILE* resumos[MAX_JOGADORES];
+    char* dados_resumos[MAX_JOGADORES];
+    size_t tamanhos_resumos[MAX_JOGADORES];
+} tPartidaMulti;
+
+#ifdef MAPA_EMBUTIDO
+#include "mapa_embutido.h"
+#endif
+
+/**
+ * Pedido de escrita de um arquivo de saida. O conteudo ja vem formatado em memoria; a
+ * thread de escrita apenas grava os dados no arquivo, no modo indicado.
+ */
+typedef struct
+{
+    char caminho[MAX_DIR_SIZE + 26];
+    char modo[2];
+    char* dados;
+    size_t tamanho;
+    char erro[MAX_DIR_SIZE + 64];
+    int fatal;
+} tEscrita;
+
+/**
+ * Arquivo de saida mantido aberto pela thread de escrita entre um pedido e outro.
+ */
+typedef struct
+{
+    char caminho[MAX_DIR_SIZE + 26];
+    FILE* arquivo;
+    unsigned long uso;
+} tArquivoAberto;
+
+/**
+ * Fila circular sem travas de um produtor e um consumidor (a thread de escrita).
+ * 'inicio' so eh alterado pelo consumidor e 'fim' so pelo produtor. Com a fila cheia,
+ * o produtor marca 'esperando' e dorme no eventfd 'espaco', que o consumidor so
+ * sinaliza quando ha alguem esperando.
+ */
+typedef struct
+{
+    tEscrita* itens[TAM_FILA_ESCRITA];
+    atomic_size_t inicio;
+    atomic_size_t fim;
+    atomic_int esperando;
+    int espaco;
+} tFilaEscrita;
+
+/**
+ * Thread de escrita com uma fila por thread produtora, obtida no primeiro pedido de
+ * cada thread, para que cada fila continue com um unico produtor. Sem pedidos, a
+ * thread de escrita marca 'dormindo' e dorme no eventfd 'pedido'; os produtores so
+ * fazem a chamada de sistema para acorda-la quando ela esta dormindo. Os arquivos
+ * abertos so sao acessados pela thread de escrita.
+ */
+typedef struct
+{
+    tFilaEscrita filas[QTD_FILAS_ESCRITA];
+    atomic_int qtd_filas;
+    atomic_int dormindo;
+    atomic_int encerrar;
+    atomic_int falha_fatal;
+    int pedido;
+    tArquivoAberto abertos[QTD_ARQUIVOS_ABERTOS];
+    unsigned long usos;
+    int ativo;
+    pthread_t thread;
+} tEscritor;
+
 
 /////////////////////////////////// FUNCOES DO MAPA //////////////////////////////////
 /**
- * @brief Cria um mapa a partir de um arquivo de texto.
+ * @brief Le o mapa de um diretorio sem encerrar o programa em caso de erro.
  *
  * @param dir Diretorio do arquivo de texto
- * @return tMapa Struct do mapa criado
+ * @param mapa Struct do mapa lido
+ * @param erro Mensagem de erro, preenchida quando a leitura falha
+ * @return int 1 se o mapa foi lido, 0 caso contrario
  */
-tMapa criaMapa(char* dir);
+int leMapa(char* dir, tMapa* mapa, char* erro);
 
 /**
  * @brief Atualiza o mapa com as posicoes dos personagens e comidas.
  *
- * @param jogo Struct do jogo
- * @return tMapa Struct do mapa atualizado
+ * @param jogo Struct do jogo, atualizada no lugar
  */
-tMapa atualizaMapa(tJogo jogo);
+void atualizaMapa(tJogo* jogo);
 
 /**
  * @brief Cria a trilha do pacman no mapa. Por onde o pacman passa, a trilha eh
  * marcada com seu respectivo numero de movimento naquele momento.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo com a trilha criada
+ * @param jogo Struct do jogo, que recebe a trilha criada
  */
-tJogo criaTrilha(tJogo jogo);
+void criaTrilha(tJogo* jogo);
 
 /**
  * @brief Imprime o mapa no arquivo de saida.
@@ -151,7 +732,7 @@ void printMapa(tMapa mapa);
  * @param jogo Struct do jogo
  * @return tPacman Struct do Pacman criado
  */
-tPacman criaPacman(tJogo jogo);
+tPacman criaPacman(const tJogo* jogo);
 
 /**
  * @brief Move o Pacman de acordo com sua direcao.
@@ -159,7 +740,7 @@ tPacman criaPacman(tJogo jogo);
  * @param jogo Struct do jogo
  * @return tPacman Struct do Pacman movido
  */
-tPacman movePacman(tJogo jogo);
+tPacman movePacman(const tJogo* jogo);
 
 /**
  * @brief Verifica a colisao do Pacman com os objetos do mapa.
@@ -167,7 +748,7 @@ tPacman movePacman(tJogo jogo);
  * @param jogo Struct do jogo
  * @return tPacman Struct do Pacman com as colisoes verificadas
  */
-tPacman verificaColisaoPacman(tJogo jogo);
+tPacman verificaColisaoPacman(const tJogo* jogo);
 
 /**
  * @brief Verifica se existe um Pacman na posicao indicada.
@@ -184,38 +765,134 @@ int temPacmanNaPosicao(int x, int y, tPacman pacman);
 /**
  * @brief Cria os fantasmas do jogo.
  *
- * @param jogo Struct do jogo sem o vetor de fantasmas
- * @return tJogo Struct do jogo com o vetor de fantasmas
+ * @param jogo Struct do jogo, que recebe o vetor de fantasmas
  */
-tJogo criaFantasmas(tJogo jogo);
+void criaFantasmas(tJogo* jogo);
 
 /**
  * @brief Move os fantasmas de acordo com suas direcoes.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo com os fantasmas movidos
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void moveFantasmas(tJogo* jogo);
+
+/**
+ * @brief Escolhe a classe de tamanho do mapa e a largura da grade de bloqueio, e marca
+ * a grade inteira como bloqueada.
+ *
+ * @param fantasmas Struct dos fantasmas
+ * @param linhas Quantidade de linhas do mapa
+ * @param colunas Quantidade de colunas do mapa
+ */
+void preparaBloqueio(tFantasmas* fantasmas, int linhas, int colunas);
+
+/**
+ * @brief Avanca uma rodada de todos os fantasmas, sem desvios condicionais. Quando a
+ * proxima celula eh parede ou portal, o fantasma inverte a direcao e recua. Chama o
+ * passo especializado para a classe de tamanho do mapa.
+ *
+ * @param classe Classe de tamanho do mapa
+ * @param qtd Quantidade de fantasmas
+ * @param x Vetor de posicoes x
+ * @param y Vetor de posicoes y
+ * @param dx Vetor de deslocamentos horizontais
+ * @param dy Vetor de deslocamentos verticais
+ * @param bloqueio Grade de bloqueio com borda, linha a linha, com a largura da classe
+ */
+void passoFantasmas(int classe, int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,
+                    const uint8_t* restrict bloqueio);
+
+/**
+ * Gera o passo dos fantasmas para uma grade com celulas do tipo 'tipo' e 'largura'
+ * colunas. Com a largura constante, o indice da celula vira deslocamentos e somas. O
+ * passo eh sem desvios: se a proxima celula for parede ou portal, o fantasma inverte a
+ * direcao (sentido = -1) e anda uma celula para tras; caso contrario, avanca.
+ */
+#define DEFINE_PASSO_FANTASMAS(nome, tipo, largura)                                                 \
+    void nome(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,       \
+              const tipo* restrict bloqueio) {                                                     \
+        int i;                                                                                     \
+        for (i = 0; i < qtd; i++) {                                                                \
+            int sentido = 1 - 2 * bloqueio[(y[i] + dy[i] + 1) * (largura) + x[i] + dx[i] + 1];     \
+            dx[i] *= sentido;                                                                      \
+            dy[i] *= sentido;                                                                      \
+            x[i] += dx[i];                                                                         \
+            y[i] += dy[i];                                                                         \
+        }                                                                                          \
+    }
+
+/**
+ * @brief Passos especializados para cada classe de tamanho, e o generico, com a grade
+ * de inteiros e MAX_COLUNAS + 2 colunas, usado como referencia em --mede-passos.
+ */
+void passoFantasmasPequeno(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasMedio(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasGrande(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const uint8_t* restrict bloqueio);
+void passoFantasmasGenerico(int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy, const int* restrict bloqueio);
+
+/**
+ * @brief Move os fantasmas no modo de perseguicao. Os movimentos seguem ciclos de
+ * CICLO_PERSEGUICAO jogadas, das quais as TEMPO_DISPERSAO primeiras sao de dispersao.
+ * Na dispersao, cada fantasma vai para o seu canto do mapa: Blinky (B) o superior
+ * direito, Pinky (P) o superior esquerdo, Inky (I) o inferior direito e Clyde (C) o
+ * inferior esquerdo. Na perseguicao, Blinky vai ate o Pacman; Pinky mira 4 celulas a
+ * frente dele; Inky mira o dobro do vetor entre Blinky e a celula 2 a frente do
+ * Pacman; e Clyde age como Blinky, mas volta ao seu canto quando esta a menos de
+ * RAIO_CLYDE celulas. Ir ate o Pacman eh descer no campo de distancias; os demais
+ * alvos sao buscados pela menor distancia em linha reta, como no jogo original. Um
+ * fantasma nao volta pelo caminho de onde veio, a nao ser que nao tenha outra saida.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void perseguePacman(tJogo* jogo);
+
+/**
+ * @brief Calcula, por busca em largura a partir do Pacman, a distancia de cada celula
+ * ate ele andando apenas pelas celulas livres da grade de bloqueio dos fantasmas.
+ * Celulas inalcancaveis ficam com -1.
+ *
+ * @param fantasmas Struct dos fantasmas, cujo campo eh preenchido
+ * @param x Posicao x do Pacman
+ * @param y Posicao y do Pacman
  */
-tJogo moveFantasmas(tJogo jogo);
+void calculaCampoPerseguicao(tFantasmas* fantasmas, int x, int y);
 
 /**
  * @brief Verifica se existe um fantasma na posicao indicada.
  *
  * @param x Posicao x
  * @param y Posicao y
- * @param fantasmas Vetor de fantasmas
+ * @param fantasmas Struct dos fantasmas
  * @return char Retorna o tipo do fantasma se existir, ou '\0' se nao existir.
  */
-char temFantasmaNaPosicao(int x, int y, tFantasma fantasmas[QTD_FANTASMAS]);
+char temFantasmaNaPosicao(int x, int y, const tFantasmas* fantasmas);
+
+/**
+ * @brief Converte uma direcao ('w', 'a', 's' ou 'd') em deslocamento. Direcoes
+ * invalidas resultam em deslocamento nulo.
+ *
+ * @param direcao Direcao do movimento
+ * @param dx Deslocamento horizontal
+ * @param dy Deslocamento vertical
+ */
+void deltaDirecao(char direcao, int* dx, int* dy);
 
 
 ///////////////////////////////// FUNCOES DAS COMIDAS ////////////////////////////////
 /**
  * @brief Cria um vetor de comidas a partir do mapa do jogo.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo atualizada
+ * @param jogo Struct do jogo, que recebe o vetor de comidas
+ */
+void criaComidas(tJogo* jogo);
+
+/**
+ * @brief Cria o indice de comidas: para cada celula, a posicao da comida no vetor de
+ * comidas, ou -1 se nao houver comida nela.
+ *
+ * @param jogo Struct do jogo, que recebe o indice
  */
-tJogo criaComidas(tJogo jogo);
+void indexaComidas(tJogo* jogo);
 
 /**
  * @brief Remove uma comida do vetor de comidas se a posicao do parametro
@@ -223,31 +900,28 @@ tJogo criaComidas(tJogo jogo);
  *
  * @param x Posicao x do personagem
  * @param y Posicao y do personagem
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo atualizada
+ * @param jogo Struct do jogo, atualizada no lugar
  */
-tJogo comeComida(int x, int y, tJogo jogo);
+void comeComida(int x, int y, tJogo* jogo);
 
 /**
  * @brief Verifica se existe uma comida na posicao indicada.
  *
  * @param x Posicao x do personagem
  * @param y Posicao y do personagem
- * @param qtd_inicial_comidas Quantidade inicial de comidas
- * @param comidas Vetor de comidas
+ * @param jogo Struct do jogo
  * @return int 1 se existe uma comida na posicao, 0 se nao existe.
  */
-int temComidaNaPosicao(int x, int y, int qtd_inicial_comidas, tComida comidas[qtd_inicial_comidas]);
+int temComidaNaPosicao(int x, int y, const tJogo* jogo);
 
 
 ///////////////////////////////// FUNCOES DOS PORTAIS ////////////////////////////////
 /**
  * @brief Cria os portais do jogo.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo com os portais
+ * @param jogo Struct do jogo, que recebe os portais
  */
-tJogo criaPortais(tJogo jogo);
+void criaPortais(tJogo* jogo);
 
 /**
  * @brief Verifica se o Pacman esta em cima de um portal. Caso esteja, move ele para
@@ -257,7 +931,7 @@ tJogo criaPortais(tJogo jogo);
  * @param jogo Struct do jogo
  * @return tPacman Struct do Pacman atualizada para nova posicao
  */
-tPacman teleportaPacman(tPacman pacman, tJogo jogo);
+tPacman teleportaPacman(tPacman pacman, const tJogo* jogo);
 
 /**
  * @brief Verifica se existe um portal na posicao indicada.
@@ -267,7 +941,7 @@ tPacman teleportaPacman(tPacman pacman, tJogo jogo);
  * @param portais Vetor de portais
  * @return int 1 se existe um portal na posicao, 0 caso contrario
  */
-int temPortalNaPosicao(int x, int y, tPortal portais[QTD_PORTAIS]);
+int temPortalNaPosicao(int x, int y, const tPortal portais[QTD_PORTAIS]);
 
 
 ///////////////////////////////////// FUNCOES DO JOGO ////////////////////////////////
@@ -280,919 +954,6604 @@ int temPortalNaPosicao(int x, int y, tPortal portais[QTD_PORTAIS]);
 tJogo inicializaJogo(char* dir);
 
 /**
- * @brief Funcao que realiza o jogo. Chama as funcoes de movimentacao do Pacman e dos
- * fantasmas. Após isso, atualiza o mapa e imprime o estado do jogo.
+ * @brief Carrega o mapa do diretorio e cria os objetos do jogo, sem tocar na pasta
+ * de saida.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo
+ * @param dir Diretorio padrao do jogo
+ * @return tJogo Struct do jogo carregado
  */
-tJogo realizaJogo(tJogo jogo);
+tJogo carregaJogo(char* dir);
 
 /**
- * @brief Atualiza os objetos do jogo de acordo com as posicoes dos personagens.
+ * @brief Carrega o jogo como carregaJogo, mas sem encerrar o programa se o mapa for
+ * invalido. Pode ser chamada fora da thread principal.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo atualizada
+ * @param dir Diretorio padrao do jogo
+ * @param jogo Struct do jogo carregado
+ * @param erro Mensagem de erro, preenchida quando o mapa nao pode ser lido
+ * @return int 1 se o jogo foi carregado, 0 caso contrario
  */
-tJogo atualizaObjetos(tJogo jogo);
+int leJogo(char* dir, tJogo* jogo, char* erro);
 
 /**
- * @brief Imprime o estado do jogo apos o movimento do pacman.
+ * @brief Cria o Pacman, os fantasmas, as comidas e os portais a partir do mapa ja lido.
  *
- * @param jogo Struct do jogo
+ * @param jogo Struct do jogo com o mapa, que recebe os objetos
  */
-void printEstadoJogo(tJogo jogo);
+void criaObjetos(tJogo* jogo);
 
 /**
- * @brief Verifica se o jogo acabou e imprime na tela o resultado.
+ * @brief Indexa as comidas, zera as estatisticas e a trilha e marca as comidas
+ * alcancaveis, deixando o jogo pronto para o primeiro movimento.
  *
- * @param jogo Struct do jogo a ser verificado
- * @return int 1 se o jogador venceu, -1 se perdeu ou 0 caso o jogo nao tenha acabado
+ * @param jogo Struct do jogo com os objetos criados, preparada no lugar
  */
-int verificaFimDeJogo(tJogo jogo);
+void preparaJogo(tJogo* jogo);
 
 /**
- * @brief Verifica se o Pacman e um fantasma trocaram de posicao.
- *
- * Essa funcao eh necessaria para que o Pacman nao troque sua posicao com
- * um fantasma em vez de colidir com ele. O que causaria um bug, fazendo
- * com que o jogo nao terminasse nesse caso especifico.
+ * @brief Joga uma partida completa: gera a inicializacao, executa os movimentos ate o
+ * fim do jogo e gera os arquivos de estatisticas, ranking e trilha.
  *
- * @param pacman Struct do Pacman
- * @param fantasmas Vetor de fantasmas
- * @return int 1 se o Pacman e um fantasma trocaram de posicao, 0 caso contrario
+ * @param jogo Struct do jogo inicializado
+ * @return tJogo Struct do jogo ao final da partida
  */
-int verificaTrocaDePosicao(tPacman pacman, tFantasma fantasmas[QTD_FANTASMAS]);
-
+tJogo jogaPartida(tJogo jogo);
 
-///////////////////////////////// FUNCOES DE ESTATISTICAS ////////////////////////////
 /**
- * @brief Cria a pasta de saida do jogo.
- * 
- * @param dir Diretorio do jogo 
+ * @brief Executa uma jogada completa na direcao indicada: move os personagens e
+ * atualiza as estatisticas e a verificacao de jogo impossivel. Nao le nem imprime nada.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ * @param direcao Direcao do Pacman
  */
-void criaPastaSaida(char* dir);
+void executaJogada(tJogo* jogo, char direcao);
 
 /**
- * @brief Gera o arquivo 'inicializacao.txt' com as informacoes iniciais do jogo.
+ * @brief Imprime o estado do jogo e le o proximo comando do jogador.
  *
  * @param jogo Struct do jogo
+ * @return char Comando lido
  */
-void geraInicializacaoTxt(tJogo jogo);
+char leComando(const tJogo* jogo);
 
 /**
- * @brief Limpa o arquivo 'resumo.txt' para uma nova execucao
+ * @brief Funcao que realiza o jogo. Chama as funcoes de movimentacao do Pacman, na
+ * direcao ja guardada em 'jogo.pacman.direcao', e dos fantasmas. Após isso, atualiza
+ * os objetos e o mapa.
  *
- * @param dir Diretorio do jogo
+ * @param jogo Struct do jogo, atualizada no lugar
  */
-void limpaResumo(char* dir);
+void realizaJogo(tJogo* jogo);
 
 /**
- * @brief Atualiza o arquivo 'resumo.txt' com informacoes dos movimentos relevantes.
+ * @brief Atualiza os objetos do jogo de acordo com as posicoes dos personagens.
  *
- * @param jogo Struct do jogo
+ * @param jogo Struct do jogo, atualizada no lugar
  */
-void atualizaResumo(tJogo jogo);
+void atualizaObjetos(tJogo* jogo);
 
 /**
- * @brief Cria as structs de estatisticas de movimentos do jogo.
+ * @brief Imprime o estado do jogo apos o movimento do pacman.
  *
  * @param jogo Struct do jogo
- * @return tJogo Struct do jogo com o vetor de estatisticas de movimentos
  */
-tJogo criaEstatisticasMovimentos(tJogo jogo);
+void printEstadoJogo(const tJogo* jogo);
 
 /**
- * @brief Atualiza as estatisticas de movimentos do jogo.
+ * @brief Escreve o estado do jogo em um arquivo, no formato de printEstadoJogo.
  *
  * @param jogo Struct do jogo
- * @return tJogo Struct do jogo atualizada
+ * @param saidaFile Arquivo de saida
  */
-tJogo atualizaEstatisticasMovimentos(tJogo jogo);
+void fprintEstadoJogo(const tJogo* jogo, FILE* saidaFile);
 
 /**
- * @brief Gera o arquivo 'ranking.txt' com as estatisticas dos movimentos. Os
- * movimentos sao ordenados de acordo com quatro criterios: Mais comidas pegas, menos
- * colisoes com paredes, mais movimentos realizados, e por ordem alfabetica.
+ * @brief Calcula o resultado do jogo, sem imprimir nada.
  *
- * @param jogo Struct do jogo
- * @return tJogo Struct do jogo atualizada
+ * @param jogo Struct do jogo a ser verificado
+ * @return int 1 se o jogador venceu, -1 se perdeu ou 0 caso o jogo nao tenha acabado
  */
-void geraRankingTxt(tJogo jogo);
+int resultadoJogo(const tJogo* jogo);
 
 /**
- * @brief Gera o arquivo 'estatisticas.txt' com as estatisticas dos movimentos
- * do Pacman.
+ * @brief Verifica se o jogo acabou e imprime na tela o resultado.
+ *
+ * @param jogo Struct do jogo a ser verificado
+ * @return int 1 se o jogador venceu, -1 se perdeu ou 0 caso o jogo nao tenha acabado
+ */
+int verificaFimDeJogo(const tJogo* jogo);
+
+/**
+ * @brief Verifica se o Pacman e um fantasma trocaram de posicao.
+ *
+ * Essa funcao eh necessaria para que o Pacman nao troque sua posicao com
+ * um fantasma em vez de colidir com ele. O que causaria um bug, fazendo
+ * com que o jogo nao terminasse nesse caso especifico.
+ *
+ * @param pacman Struct do Pacman
+ * @param fantasmas Struct dos fantasmas
+ * @return int 1 se o Pacman e um fantasma trocaram de posicao, 0 caso contrario
+ */
+int verificaTrocaDePosicao(tPacman pacman, const tFantasmas* fantasmas);
+
+
+////////////////////////////////// FUNCOES DE ALCANCE ////////////////////////////////
+/**
+ * @brief Calcula, por busca em largura, a menor quantidade de movimentos do Pacman
+ * ate cada celula do mapa. Entrar em um portal leva ao outro sem custo adicional.
+ * Os fantasmas sao ignorados, pois se movem.
+ *
+ * @param mapa Struct do mapa
+ * @param portais Vetor de portais
+ * @param x Posicao x de origem
+ * @param y Posicao y de origem
+ * @param distancias Distancia ate cada celula, ou -1 se a celula eh inalcancavel
+ */
+void calculaDistancias(const tMapa* mapa, const tPortal portais[QTD_PORTAIS], int x, int y, int distancias[MAX_LINHAS][MAX_COLUNAS]);
+
+/**
+ * @brief Marca as comidas que o Pacman nao consegue alcancar a partir da posicao
+ * inicial, mesmo usando os portais.
+ *
+ * @param jogo Struct do jogo, com as comidas marcadas no lugar
+ */
+void marcaComidasAlcancaveis(tJogo* jogo);
+
+/**
+ * @brief Calcula uma estimativa por baixo da distancia entre duas celulas, sem
+ * considerar paredes, mas considerando o atalho pelos portais.
+ *
+ * @return int Distancia estimada
+ */
+int distanciaEstimada(int x1, int y1, int x2, int y2, const tPortal portais[QTD_PORTAIS]);
+
+/**
+ * @brief Calcula um limite inferior para a quantidade de movimentos necessarios para
+ * pegar todas as comidas restantes: a distancia real ate a comida mais proxima mais
+ * o peso da arvore geradora minima entre as comidas restantes. Com muitas comidas, a
+ * arvore eh trocada pelo limite mais barato de um movimento por comida.
+ *
+ * @param jogo Struct do jogo
+ * @return int Limite inferior de movimentos, ou -1 se nenhuma comida restante eh
+ * alcancavel
+ */
+int limiteInferiorMovimentos(const tJogo* jogo);
+
+/**
+ * @brief Verifica se o jogo ainda pode ser vencido. So tem efeito quando a opcao
+ * '--encerra-impossivel' foi informada.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void verificaJogoImpossivel(tJogo* jogo);
+
+
+///////////////////////////////// FUNCOES DE ESTATISTICAS ////////////////////////////
+/**
+ * @brief Cria a pasta de saida do jogo e verifica se ela pode ser gravada. Encerra o
+ * programa se nao puder.
+ * 
+ * @param dir Diretorio do jogo 
+ */
+void criaPastaSaida(char* dir);
+
+/**
+ * @brief Gera o arquivo 'inicializacao.txt' com as informacoes iniciais do jogo.
+ *
+ * @param jogo Struct do jogo
+ */
+void geraInicializacaoTxt(const tJogo* jogo);
+
+/**
+ * @brief Limpa o arquivo 'resumo.txt' para uma nova execucao
+ *
+ * @param dir Diretorio do jogo
+ */
+void limpaResumo(char* dir);
+
+/**
+ * @brief Atualiza o arquivo 'resumo.txt' com informacoes dos movimentos relevantes.
+ *
+ * @param jogo Struct do jogo
+ */
+void atualizaResumo(const tJogo* jogo);
+
+/**
+ * @brief Escreve as linhas do resumo para o movimento atual; movimentos sem eventos
+ * nao escrevem nada.
+ *
+ * @param jogo Struct do jogo
+ * @param resumoFile Arquivo de saida
+ */
+void fprintResumo(const tJogo* jogo, FILE* resumoFile);
+
+/**
+ * @brief Cria as structs de estatisticas de movimentos do jogo.
+ *
+ * @param jogo Struct do jogo, que recebe o vetor de estatisticas de movimentos
+ */
+void criaEstatisticasMovimentos(tJogo* jogo);
+
+/**
+ * @brief Atualiza as estatisticas de movimentos do jogo.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void atualizaEstatisticasMovimentos(tJogo* jogo);
+
+/**
+ * @brief Compara duas entradas de um ranking pelos tres primeiros criterios: Mais
+ * comidas pegas, menos colisoes com paredes e mais movimentos realizados.
+ *
+ * @param comidas1 Comidas pegas pela primeira entrada
+ * @param colisoes1 Colisoes apenas com parede da primeira entrada
+ * @param realizados1 Movimentos realizados pela primeira entrada
+ * @param comidas2 Comidas pegas pela segunda entrada
+ * @param colisoes2 Colisoes apenas com parede da segunda entrada
+ * @param realizados2 Movimentos realizados pela segunda entrada
+ * @return int Negativo se a primeira vem antes, positivo se a segunda vem antes e 0 se
+ * empatam, deixando o desempate por ordem alfabetica para quem chama
+ */
+int comparaCriteriosRanking(long long comidas1, long long colisoes1, long long realizados1,
+                            long long comidas2, long long colisoes2, long long realizados2);
+
+/**
+ * @brief Compara duas estatisticas de movimento pelos criterios do ranking.
+ *
+ * @param a Primeira estatistica (tEstatisticaMovimento)
+ * @param b Segunda estatistica (tEstatisticaMovimento)
+ * @return int Negativo se 'a' vem antes de 'b' no ranking
+ */
+int comparaMovimentosRanking(const void* a, const void* b);
+
+/**
+ * @brief Ordena um ranking por selecao. Entradas empatadas mantem a ordem que a
+ * selecao lhes da, igual em todos os rankings.
+ *
+ * @param itens Vetor com as entradas
+ * @param qtd Quantidade de entradas
+ * @param tamanho Tamanho de cada entrada
+ * @param compara Funcao que retorna um valor negativo se a primeira entrada vem antes
+ */
+void ordenaRanking(void* itens, int qtd, size_t tamanho, int (*compara)(const void*, const void*));
+
+/**
+ * @brief Gera o arquivo 'ranking.txt' com as estatisticas dos movimentos. Os
+ * movimentos sao ordenados de acordo com quatro criterios: Mais comidas pegas, menos
+ * colisoes com paredes, mais movimentos realizados, e por ordem alfabetica.
+ *
+ * @param jogo Struct do jogo
+ * @return tJogo Struct do jogo atualizada
+ */
+void geraRankingTxt(const tJogo* jogo);
+
+/**
+ * @brief Gera o arquivo 'estatisticas.txt' com as estatisticas dos movimentos
+ * do Pacman.
+ *
+ * @param jogo Struct do jogo
+ */
+void geraEstatisticasTxt(const tJogo* jogo);
+
+/**
+ * @brief Gera o arquivo 'trilha.txt' com a trilha percorrida pelo Pacman.
+ *
+ * @param jogo Struct do jogo
+ */
+void geraTrilhaTxt(const tJogo* jogo);
+
+/**
+ * @brief Escreve um inteiro em decimal, sem '\0' no final.
+ *
+ * @param valor Numero a ser escrito
+ * @param destino Buffer com espaco para pelo menos 11 caracteres
+ * @return int Quantidade de caracteres escritos
+ */
+int formataInteiro(int valor, char* destino);
+
+/**
+ * @brief Escreve uma linha da trilha no formato do 'trilha.txt': o movimento de cada
+ * celula, ou '#' se o Pacman nao passou por ela, separados por espaco e terminados
+ * em '\n'.
+ *
+ * @param trilha Linha da trilha
+ * @param colunas Quantidade de colunas
+ * @param destino Buffer com espaco para 12 caracteres por coluna
+ * @return int Quantidade de caracteres escritos
+ */
+int formataLinhaTrilha(const int* trilha, int colunas, char* destino);
+
+/**
+ * @brief Gera o arquivo 'trilha.bin' apenas com as celulas visitadas. O arquivo tem
+ * "PMTB", versao, linhas, colunas e quantidade de celulas (uint32), seguidos de um par
+ * (celula, movimento) em uint32 para cada celula visitada, com celula = y * colunas + x,
+ * em ordem de linha.
+ *
+ * @param jogo Struct do jogo
+ */
+void geraTrilhaBinaria(const tJogo* jogo);
+
+/**
+ * @brief Converte um 'trilha.bin' para o formato do 'trilha.txt'.
+ *
+ * @param origem Caminho do 'trilha.bin'
+ * @param destino Caminho do texto a ser criado
+ * @return int 1 se a trilha foi convertida, 0 caso contrario
+ */
+int converteTrilha(char* origem, char* destino);
+
+
+////////////////////////////////// FUNCOES DO ESCRITOR ///////////////////////////////
+/**
+ * @brief Inicia a thread que grava os arquivos de saida em segundo plano.
+ */
+void iniciaEscritor(void);
+
+/**
+ * @brief Aguarda a gravacao de todos os pedidos pendentes e encerra a thread de
+ * escrita, fechando os arquivos que ela mantinha abertos. Pode ser chamada mais de
+ * uma vez. Se uma gravacao obrigatoria falhou, encerra o programa com erro.
+ */
+void encerraEscritor(void);
+
+/**
+ * @brief Enfileira a gravacao de um arquivo na fila da thread atual, sem travas. Se a
+ * fila estiver cheia, espera a thread de escrita liberar espaco. A posse de 'dados' passa para a thread de escrita. Se
+ * uma gravacao obrigatoria anterior falhou, encerra o programa com erro.
+ *
+ * @param caminho Caminho do arquivo
+ * @param modo Modo de abertura ("w" ou "a")
+ * @param dados Conteudo alocado com malloc, ou NULL
+ * @param tamanho Tamanho do conteudo
+ * @param nome Nome do arquivo, usado na mensagem de erro
+ * @param dir Diretorio do jogo, usado na mensagem de erro
+ * @param fatal 1 se uma falha ao abrir o arquivo deve encerrar o programa
+ */
+void enviaEscrita(const char* caminho, const char* modo, char* dados, size_t tamanho, const char* nome, const char* dir, int fatal);
+
+/**
+ * @brief Espera a thread de escrita gravar todos os pedidos ja enfileirados pela thread
+ * atual. Deve ser chamada antes de ler um arquivo de saida que pode ter uma gravacao
+ * pendente.
+ */
+void aguardaEscritor(void);
+
+/**
+ * @brief Obtem a fila da thread atual, reservando uma na primeira chamada.
+ *
+ * @return tFilaEscrita* Fila da thread atual
+ */
+tFilaEscrita* obtemFilaEscrita(void);
+
+/**
+ * @brief Dorme em um eventfd ate ser sinalizado, consumindo o sinal.
+ *
+ * @param evento Descritor do eventfd
+ */
+void esperaEvento(int evento);
+
+/**
+ * @brief Sinaliza um eventfd, acordando quem dorme nele.
+ *
+ * @param evento Descritor do eventfd
+ */
+void sinalizaEvento(int evento);
+
+/**
+ * @brief Laco da thread de escrita: consome as filas e grava cada pedido.
+ *
+ * @param arg Nao utilizado
+ * @return void* Sempre NULL
+ */
+void* executaEscritor(void* arg);
+
+/**
+ * @brief Grava um pedido de escrita em disco e libera sua memoria. O arquivo continua
+ * aberto para os proximos pedidos, mas os dados sao descarregados a cada pedido.
+ *
+ * @param escrita Pedido a ser gravado
+ */
+void realizaEscrita(tEscrita* escrita);
+
+/**
+ * @brief Obtem o arquivo aberto para um caminho, abrindo-o se necessario. Quando todos
+ * os espacos estao ocupados, fecha o arquivo usado ha mais tempo. No modo "w", um
+ * arquivo que ja estava aberto eh truncado.
+ *
+ * @param caminho Caminho do arquivo
+ * @param modo Modo de abertura ("w" ou "a")
+ * @return FILE* Arquivo aberto, ou NULL se nao foi possivel abri-lo
+ */
+FILE* obtemArquivoAberto(const char* caminho, const char* modo);
+
+
+////////////////////////////////// FUNCOES DO MAPA EMBUTIDO //////////////////////////
+/**
+ * @brief Compila o 'mapa.txt' de um diretorio em um cabecalho C com bitmaps de paredes
+ * e comidas, tabelas com as posicoes iniciais e os ciclos dos fantasmas. Compilando
+ * com -DMAPA_EMBUTIDO, o jogo usa esse cabecalho em vez de ler o mapa.
+ *
+ * @param dir Diretorio do mapa
+ * @param arquivo Caminho do cabecalho a ser gerado
+ */
+void geraMapaEmbutido(char* dir, char* arquivo);
+
+/**
+ * @brief Simula um fantasma isolado ate seu estado se repetir. Como o movimento eh
+ * deterministico, a sequencia de estados eh uma cauda seguida de um ciclo.
+ *
+ * @param jogo Struct do jogo
+ * @param idx Indice do fantasma
+ * @param estados Vetor de estados (x, y, dx, dy) percorridos, a partir do inicial
+ * @param cauda Quantidade de estados antes do ciclo
+ * @return int Quantidade total de estados (cauda mais periodo)
+ */
+int calculaCicloFantasma(const tJogo* jogo, int idx, int estados[][4], int* cauda);
+
+#ifdef MAPA_EMBUTIDO
+/**
+ * @brief Cria os objetos do jogo a partir do cabecalho gerado por geraMapaEmbutido.
+ *
+ * @param jogo Struct do jogo, que recebe o mapa embutido
+ */
+void carregaMapaEmbutido(tJogo* jogo);
+
+/**
+ * @brief Posiciona os fantasmas pelo ciclo pre-calculado, de acordo com o numero do
+ * movimento. So eh valida quando nenhum ciclo depende de portais.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ */
+void posicionaFantasmasPeloCiclo(tJogo* jogo);
+#endif
+
+
+////////////////////////////////// FUNCOES DO CATALOGO ///////////////////////////////
+/**
+ * @brief Percorre uma arvore de diretorios, valida em paralelo cada 'mapa.txt'
+ * encontrado e grava o resultado em um catalogo indexado.
+ *
+ * @param raiz Diretorio raiz do acervo
+ * @param catalogo Caminho do catalogo a ser gerado
+ * @param qtd_threads Quantidade de threads de validacao
+ * @return int Quantidade de mapas invalidos
+ */
+int validaAcervo(char* raiz, char* catalogo, int qtd_threads);
+
+/**
+ * @brief Funcao chamada pelo nftw para cada arquivo da arvore. Guarda no acervo os
+ * diretorios que possuem um 'mapa.txt'.
+ */
+int registraMapaDoAcervo(const char* caminho, const struct stat* info, int tipo, struct FTW* ftw);
+
+/**
+ * @brief Laco de uma thread de validacao: pega o proximo mapa do acervo e valida.
+ *
+ * @param arg Ponteiro para o acervo
+ * @return void* Sempre NULL
+ */
+void* executaValidacao(void* arg);
+
+/**
+ * @brief Valida o mapa de um diretorio: leitura, dimensoes, bordas, caracteres,
+ * quantidade de Pacmans, pares de portais e alcance das comidas.
+ *
+ * @param item Item do catalogo com o diretorio preenchido
+ */
+void validaMapa(tItemCatalogo* item);
+
+/**
+ * @brief Calcula o hash FNV-1a de 64 bits do 'mapa.txt' de um diretorio.
+ *
+ * @param dir Diretorio do mapa
+ * @return unsigned long long Hash do arquivo, ou 0 se nao foi possivel le-lo
+ */
+unsigned long long hashMapa(char* dir);
+
+/**
+ * @brief Busca no catalogo o diretorio do mapa de um indice e confere se o 'mapa.txt'
+ * ainda tem o hash registrado na validacao.
+ *
+ * @param catalogo Caminho do catalogo
+ * @param indice Indice do mapa
+ * @param dir Diretorio do mapa encontrado
+ * @return int 1 se o mapa foi encontrado e eh valido, -1 se o mapa mudou desde a
+ * validacao, 0 caso contrario
+ */
+int buscaNoCatalogo(char* catalogo, int indice, char* dir);
+
+
+////////////////////////////////// FUNCOES DA CAMPANHA ///////////////////////////////
+/**
+ * @brief Joga os niveis listados em um arquivo, em ordem, acumulando a pontuacao. Ao
+ * perder um nivel, o jogador perde uma vida e o nivel eh repetido.
+ *
+ * @param lista Arquivo com o diretorio de um nivel por linha
+ * @param opcoes Opcoes do jogo
+ * @return int 0 se a campanha foi concluida, 1 caso contrario
+ */
+int jogaCampanha(char* lista, tOpcoes opcoes);
+
+/**
+ * @brief Laco da thread de preparacao: carrega os niveis seguintes ao atual que ainda
+ * nao estao no cache.
+ *
+ * @param arg Ponteiro para a campanha
+ * @return void* Sempre NULL
+ */
+void* preparaNiveis(void* arg);
+
+/**
+ * @brief Procura um nivel no cache. Deve ser chamada com a trava da campanha.
+ *
+ * @param campanha Struct da campanha
+ * @param nivel Indice do nivel
+ * @return tNivelPreparado* Nivel preparado, ou NULL se nao estiver no cache
+ */
+tNivelPreparado* buscaNivelNoCache(tCampanha* campanha, int nivel);
+
+/**
+ * @brief Obtem um nivel preparado, esperando a thread de preparacao se preciso. Marca
+ * o nivel como o atual, para que os seguintes sejam antecipados. Se o mapa do nivel
+ * for invalido, imprime o erro.
+ *
+ * @param campanha Struct da campanha
+ * @param nivel Indice do nivel
+ * @param jogo Copia do jogo preparado
+ * @return int 1 se o nivel foi obtido, 0 se o mapa dele eh invalido
+ */
+int obtemNivel(tCampanha* campanha, int nivel, tJogo* jogo);
+
+
+///////////////////////////////// FUNCOES DO MAPA DE CALOR ////////////////////////////
+/**
+ * @brief Carrega o mapa de calor acumulado em 'saida/calor.bin', depois de esperar a
+ * gravacao pendente da partida anterior. Se o arquivo nao existir, estiver incompleto
+ * ou for de um mapa com outras dimensoes, comeca com os contadores zerados.
  *
+ * @param dir Diretorio do jogo
+ * @param linhas Quantidade de linhas do mapa
+ * @param colunas Quantidade de colunas do mapa
+ * @return tMapaDeCalor* Mapa de calor alocado
+ */
+tMapaDeCalor* carregaMapaDeCalor(char* dir, int linhas, int colunas);
+
+/**
+ * @brief Conta a passagem do Pacman pela sua posicao atual e, se ele encostou em um
+ * fantasma, a morte nessa posicao.
+ *
+ * @param calor Mapa de calor
  * @param jogo Struct do jogo
  */
-void geraEstatisticasTxt(tJogo jogo);
+void registraNoMapaDeCalor(tMapaDeCalor* calor, const tJogo* jogo);
+
+/**
+ * @brief Grava o mapa de calor em 'saida/calor.bin', e as imagens 'saida/calor.pgm'
+ * (passagens, em tons de cinza) e 'saida/calor.ppm' (passagens em verde, mortes em
+ * vermelho e paredes em azul).
+ *
+ * @param calor Mapa de calor
+ * @param mapa Struct do mapa, usada para desenhar as paredes
+ * @param dir Diretorio do jogo
+ */
+void salvaMapaDeCalor(tMapaDeCalor* calor, tMapa mapa, char* dir);
+
+
+///////////////////////////////// FUNCOES DO HISTORICO ////////////////////////////////
+/**
+ * @brief Aloca um historico vazio.
+ *
+ * @return tHistorico* Historico alocado
+ */
+tHistorico* criaHistorico(void);
+
+/**
+ * @brief Guarda o que a proxima jogada pode alterar e nao da para deduzir depois dela:
+ * o Pacman, as direcoes dos fantasmas e a trilha e as comidas nas celulas que ela pode
+ * alcancar (a posicao atual, as vizinhas e os portais).
+ *
+ * @param historico Historico do jogo
+ * @param jogo Struct do jogo antes da jogada
+ */
+void preparaRegistroHistorico(tHistorico* historico, const tJogo* jogo);
+
+/**
+ * @brief Compara o jogo apos a jogada com o que foi guardado por
+ * preparaRegistroHistorico e grava o registro da jogada. As jogadas desfeitas deixam
+ * de poder ser refeitas.
+ *
+ * @param historico Historico do jogo
+ * @param jogo Struct do jogo apos a jogada
+ */
+void registraNoHistorico(tHistorico* historico, const tJogo* jogo);
+
+/**
+ * @brief Desfaz ate 'qtd' jogadas, parando se o historico acabar.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ * @param historico Historico do jogo
+ * @param qtd Quantidade de jogadas a desfazer
+ */
+void desfazJogadas(tJogo* jogo, tHistorico* historico, int qtd);
+
+/**
+ * @brief Refaz ate 'qtd' jogadas desfeitas, parando se nao houver mais nenhuma.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ * @param historico Historico do jogo
+ * @param qtd Quantidade de jogadas a refazer
+ */
+void refazJogadas(tJogo* jogo, tHistorico* historico, int qtd);
+
+/**
+ * @brief Aplica um registro ao jogo, no sentido de refazer (sentido = 1) ou de desfazer
+ * (sentido = -1) a jogada.
+ *
+ * @param jogo Struct do jogo, atualizada no lugar
+ * @param registro Registro da jogada
+ * @param sentido 1 para refazer ou -1 para desfazer
+ */
+void aplicaRegistro(tJogo* jogo, const unsigned char* registro, int sentido);
+
+/**
+ * @brief Copia bytes entre o buffer circular do historico e um buffer linear.
+ *
+ * @param historico Historico do jogo
+ * @param posicao Posicao no historico, ainda nao reduzida modulo a capacidade
+ * @param buffer Buffer linear
+ * @param tamanho Quantidade de bytes
+ * @param escrever 1 para copiar do buffer para o historico, 0 para o contrario
+ */
+void copiaHistorico(tHistorico* historico, size_t posicao, unsigned char* buffer, size_t tamanho, int escrever);
+
+
+///////////////////////////////// FUNCOES DA GRAVACAO /////////////////////////////////
+/**
+ * @brief Cria 'saida/gravacao.bin' com o cabecalho e o quadro-chave inicial.
+ *
+ * @param jogo Struct do jogo no inicio da partida
+ * @return tGravacao* Gravacao iniciada
+ */
+tGravacao* iniciaGravacao(const tJogo* jogo);
+
+/**
+ * @brief Acrescenta a jogada a gravacao e, a cada INTERVALO_QUADROS_CHAVE jogadas, um
+ * quadro-chave com o estado apos ela.
+ *
+ * @param gravacao Gravacao da partida
+ * @param jogo Struct do jogo apos a jogada
+ */
+void gravaJogada(tGravacao* gravacao, const tJogo* jogo);
+
+/**
+ * @brief Acrescenta o indice dos quadros-chave ao fim da gravacao e a libera.
+ *
+ * @param gravacao Gravacao da partida
+ * @param jogo Struct do jogo ao final da partida
+ */
+void encerraGravacao(tGravacao* gravacao, const tJogo* jogo);
+
+/**
+ * @brief Envia um quadro-chave para a gravacao e o registra no indice.
+ *
+ * @param gravacao Gravacao da partida
+ * @param jogo Struct do jogo a ser gravado
+ */
+void enviaQuadroChave(tGravacao* gravacao, const tJogo* jogo);
+
+/**
+ * @brief Escreve o estado compacto do jogo, no formato do quadro-chave.
+ *
+ * @param jogo Struct do jogo
+ * @param arquivo Arquivo de destino
+ */
+void fprintQuadroChave(const tJogo* jogo, FILE* arquivo);
+
+/**
+ * @brief Le o estado compacto de um quadro-chave sobre o jogo refeito a partir do mapa
+ * inicial da gravacao.
+ *
+ * @param jogo Struct do jogo no inicio da partida, atualizada no lugar
+ * @param arquivo Arquivo posicionado no estado compacto
+ * @return int 1 se o quadro-chave foi lido, 0 caso contrario
+ */
+int leQuadroChave(tJogo* jogo, FILE* arquivo);
+
+/**
+ * @brief Mostra o estado do jogo gravado apos o movimento indicado. Carrega o ultimo
+ * quadro-chave ate esse movimento, pelo indice ou, se nao houver indice, percorrendo os
+ * blocos, e refaz as jogadas seguintes.
+ *
+ * @param arquivo Caminho da gravacao
+ * @param movimento Movimento desejado
+ * @return int 1 se o estado foi mostrado, 0 caso contrario
+ */
+int reproduzGravacao(char* arquivo, int movimento);
+
+
+/////////////////////////////////// FUNCOES DOS BOTS //////////////////////////////////
+/**
+ * @brief Carrega o bot de uma biblioteca compartilhada, que deve exportar a funcao
+ * 'pacman_bot' na versao PACMAN_BOT_VERSAO.
+ *
+ * @param caminho Caminho da biblioteca
+ * @param destino Onde guardar o bot carregado
+ * @return int 1 se o bot foi carregado, 0 caso contrario
+ */
+int carregaBot(char* caminho, tBotCarregado* destino);
+
+/**
+ * @brief Monta a visao do bot apontando para a memoria do jogo, sem copiar nada.
+ *
+ * @param jogo Struct do jogo, que precisa continuar valida enquanto a visao for usada
+ * @param semente Semente da partida
+ * @return tVisaoBot Visao do jogo para o bot
+ */
+tVisaoBot criaVisaoBot(const tJogo* jogo, unsigned int semente);
+
+/**
+ * @brief Joga uma partida inteira com o bot, sem imprimir nem gerar arquivos.
+ *
+ * @param jogo Struct do jogo, atualizada ate o fim da partida
+ * @param bot Bot que controla o Pacman
+ * @param semente Semente da partida, repassada ao bot
+ * @param tempo_bot Se nao for nulo, recebe a soma do tempo gasto nas decisoes
+ * @param calor Se nao for nulo, recebe as passagens e a morte do Pacman
+ * @return long long Quantidade de decisoes tomadas
+ */
+long long jogaComBot(tJogo* jogo, const tPacmanBot* bot, unsigned int semente, double* tempo_bot, tMapaDeCalor* calor);
+
+/**
+ * @brief Joga partidas seguidas com o bot carregado, sem imprimir o estado do jogo nem
+ * gerar arquivos, e informa quantas decisoes por segundo o bot toma e quantas jogadas
+ * por segundo o conjunto bot e jogo executa.
+ *
+ * @param dir Diretorio do mapa
+ * @param partidas Quantidade de partidas
+ */
+void medeBot(char* dir, int partidas);
+
+
+////////////////////////////////// FUNCOES DO TORNEIO ////////////////////////////////
+/**
+ * @brief Joga o torneio entre os bots da lista em todos os mapas da lista, com
+ * SEMENTES_TORNEIO sementes, dividindo as partidas entre trabalhadores que roubam
+ * tarefas uns dos outros. Os resultados das partidas sao gravados a medida que
+ * terminam, e o ranking dos bots eh gravado ao final.
+ *
+ * @param lista_bots Arquivo com uma biblioteca de bot por linha
+ * @param lista_mapas Arquivo com um diretorio de mapa por linha
+ * @param resultados Arquivo de resultados das partidas
+ * @param ranking Arquivo do ranking dos bots
+ * @param opcoes Opcoes aplicadas a todas as partidas
+ * @return int 0 se o torneio foi jogado, 1 caso contrario
+ */
+int jogaTorneio(char* lista_bots, char* lista_mapas, char* resultados, char* ranking, tOpcoes opcoes);
+
+/**
+ * @brief Laco de um trabalhador do torneio: tira tarefas da propria fila ou rouba das
+ * outras ate que todas estejam vazias.
+ *
+ * @param arg Ponteiro para o tTrabalhadorTorneio
+ * @return void* NULL
+ */
+void* executaTorneio(void* arg);
+
+/**
+ * @brief Pega a proxima tarefa do trabalhador: do fim da propria fila ou, se ela estiver
+ * vazia, do inicio da fila de outro.
+ *
+ * @param torneio Torneio em andamento
+ * @param indice Indice do trabalhador
+ * @param tarefa Tarefa obtida
+ * @return int 1 se obteve uma tarefa, 0 se todas as filas estao vazias
+ */
+int pegaTarefa(tTorneio* torneio, int indice, tTarefaTorneio* tarefa);
+
+/**
+ * @brief Ordena os totais dos bots pelos criterios do ranking de movimentos (mais
+ * comidas, menos colisoes com parede, mais movimentos e ordem alfabetica) e os grava.
+ *
+ * @param torneio Torneio encerrado
+ * @param ranking Arquivo do ranking
+ */
+void geraRankingTorneio(tTorneio* torneio, char* ranking);
+
+/**
+ * @brief Compara os totais de dois bots pelos criterios do ranking.
+ *
+ * @param a Totais do primeiro bot (tResultadoBot)
+ * @param b Totais do segundo bot (tResultadoBot)
+ * @return int Negativo se 'a' vem antes de 'b' no ranking
+ */
+int comparaBotsRanking(const void* a, const void* b);
+
+/**
+ * @brief Le uma lista com um diretorio ou arquivo por linha, ignorando linhas vazias e
+ * comentarios iniciados por '#'.
+ *
+ * @param lista Arquivo da lista
+ * @param itens Vetor alocado com os itens lidos
+ * @param descricao Descricao da lista para as mensagens de erro
+ * @return int Quantidade de itens lidos
+ */
+int leLista(char* lista, char (**itens)[MAX_DIR_SIZE], char* descricao);
+
+
+///////////////////////////////// FUNCOES DAS METRICAS ////////////////////////////////
+/**
+ * @brief Cria o segmento de memoria compartilhada das metricas. O segmento eh removido
+ * quando o programa termina.
+ *
+ * @param nome Nome do segmento, como "/pacman"
+ * @return int 1 se o segmento foi criado, 0 caso contrario
+ */
+int iniciaMetricas(char* nome);
+
+/**
+ * @brief Remove o segmento de metricas.
+ */
+void encerraMetricas(void);
+
+/**
+ * @brief Publica as metricas do jogo apos uma jogada, se as metricas estiverem ativas.
+ *
+ * @param jogo Struct do jogo
+ * @param latencia_ns Duracao da ultima jogada, em nanossegundos, somada ao tempo das jogadas
+ * @param encerrado 1 se a partida acabou
+ */
+void publicaMetricas(const tJogo* jogo, uint64_t latencia_ns, int encerrado);
+
+/**
+ * @brief Le periodicamente o segmento de metricas de outro processo e imprime as
+ * amostras.
+ *
+ * @param nome Nome do segmento
+ * @param intervalo_ms Intervalo entre as amostras, em milissegundos
+ * @param amostras Quantidade de amostras, ou 0 para ler ate a partida acabar
+ * @return int 1 se o segmento foi lido, 0 caso contrario
+ */
+int leMetricas(char* nome, int intervalo_ms, int amostras);
+
+
+/////////////////////////////// FUNCOES DA TRANSMISSAO ///////////////////////////////
+/**
+ * @brief Cria o segmento de memoria compartilhada da transmissao. Ao fim do programa,
+ * a transmissao eh marcada como encerrada e o segmento eh removido.
+ *
+ * @param nome Nome do segmento, como "/pacman-tv"
+ * @return int 1 se o segmento foi criado, 0 caso contrario
+ */
+int iniciaTransmissao(char* nome);
+
+/**
+ * @brief Marca a transmissao como encerrada e remove o segmento.
+ */
+void encerraTransmissao(void);
+
+/**
+ * @brief Publica o quadro atual do jogo, se a transmissao estiver ativa. A cada
+ * INTERVALO_CHAVE_TRANSMISSAO quadros, ou quando as dimensoes do mapa mudam, o quadro
+ * leva o mapa inteiro; nos demais, apenas as celulas que mudaram, se forem poucas.
+ *
+ * @param jogo Struct do jogo
+ */
+void transmiteQuadro(const tJogo* jogo);
+
+/**
+ * @brief Acompanha uma transmissao: comeca pelo ultimo quadro-chave e imprime cada
+ * quadro como printEstadoJogo, ate a transmissao acabar.
+ *
+ * @param nome Nome do segmento
+ * @return int 1 se a transmissao foi acompanhada, 0 caso contrario
+ */
+int assisteTransmissao(char* nome);
+
+/**
+ * @brief Copia o quadro n do anel, se ele ainda estiver la.
+ *
+ * @param transmissao Segmento da transmissao
+ * @param n Numero do quadro
+ * @param quadro Copia do quadro
+ * @return int 1 se a copia eh do quadro n, 0 se ele ja foi sobrescrito
+ */
+int copiaQuadro(const tTransmissao* transmissao, unsigned long long n, tQuadroTransmissao* quadro);
+
+
+/////////////////////////////// FUNCOES DO REGISTRO DA SESSAO /////////////////////////
+/**
+ * @brief Comeca o registro da sessao do jogo, gravando o cabecalho e o mapa inicial.
+ *
+ * @param jogo Struct do jogo no inicio da partida
+ */
+void iniciaRegistroSessao(const tJogo* jogo);
+
+/**
+ * @brief Registra um estado impresso por printEstadoJogo, se o registro estiver ativo.
+ *
+ * @param jogo Struct do jogo impresso
+ */
+void registraQuadroSessao(const tJogo* jogo);
+
+/**
+ * @brief Registra o fim do jogo, se o registro estiver ativo, envia os blocos pendentes
+ * e encerra o registro.
+ *
+ * @param venceu 1 se o jogador venceu, -1 se perdeu
+ * @param pontos Pontuacao final
+ */
+void registraFimSessao(int venceu, int pontos);
+
+/**
+ * @brief Envia os blocos acumulados a thread de escrita e, se 'continua' for 1, abre
+ * um novo lote.
+ *
+ * @param continua 1 se ainda havera blocos depois deste lote
+ */
+void enviaLoteSessao(int continua);
+
+/**
+ * @brief Grava um numero em varint: 7 bits por byte, com o bit mais alto indicando
+ * que ha mais bytes.
+ *
+ * @param arquivo Arquivo de saida
+ * @param valor Numero a ser gravado
+ */
+void escreveVarint(FILE* arquivo, unsigned long long valor);
+
+/**
+ * @brief Le um numero gravado em varint.
+ *
+ * @param arquivo Arquivo de entrada
+ * @param valor Numero lido
+ * @return int 1 se o numero foi lido, 0 se o arquivo acabou
+ */
+int leVarint(FILE* arquivo, unsigned long long* valor);
+
+/**
+ * @brief Reconstroi a partir do registro da sessao o texto impresso pelo jogo: todos
+ * os estados e a mensagem final, ou apenas um dos estados.
+ *
+ * @param arquivo Caminho do registro
+ * @param quadro Indice do estado desejado, a partir de 0, ou -1 para todos
+ * @return int 1 se o registro foi lido, 0 caso contrario
+ */
+int decodificaSessao(char* arquivo, int quadro);
+
+
+///////////////////////////////////// FUNCOES DA JANELA //////////////////////////////
+/**
+ * @brief Escreve apenas a janela do mapa em volta do Pacman, com no maximo
+ * 'opcoes.janela_linhas' linhas e 'opcoes.janela_colunas' colunas. A janela acompanha
+ * o Pacman sem sair do mapa, e cada linha eh escrita de uma vez.
+ *
+ * @param jogo Struct do jogo
+ * @param saidaFile Arquivo de saida
+ */
+void fprintJanela(const tJogo* jogo, FILE* saidaFile);
+
+/**
+ * @brief Escreve o mapa reduzido: cada bloco de 'opcoes.minimapa' x 'opcoes.minimapa'
+ * celulas vira um caractere, escolhido pelo que ha de mais importante no bloco
+ * (Pacman, fantasma, portal, comida, espaco livre e parede, nessa ordem). Percorre o
+ * mapa inteiro a cada estado impresso, com uma consulta de prioridade por celula: o
+ * mesmo custo de atualizaMapa, que ja redesenha todas as celulas a cada movimento.
+ * Resumos por bloco atualizados aos poucos exigiriam saber quais celulas mudaram, o
+ * que o redesenho completo nao informa.
+ *
+ * @param jogo Struct do jogo
+ * @param saidaFile Arquivo de saida
+ */
+void fprintMinimapa(const tJogo* jogo, FILE* saidaFile);
+
+/**
+ * @brief Calcula a prioridade de um caractere do mapa no minimapa.
+ *
+ * @param c Caractere do mapa
+ * @return int Prioridade, maior para o que deve aparecer
+ */
+int prioridadeMinimapa(char c);
+
+
+//////////////////////////////// FUNCOES DA ANTECIPACAO ///////////////////////////////
+/**
+ * @brief Cria a antecipacao de jogadas e inicia a sua thread.
+ *
+ * @return tAntecipacao* Antecipacao criada
+ */
+tAntecipacao* criaAntecipacao();
+
+/**
+ * @brief Pede que os quatro estados seguintes a 'jogo' sejam calculados. Espera a
+ * thread terminar o pedido anterior, se ainda estiver nele.
+ *
+ * @param antecipacao Antecipacao de jogadas
+ * @param jogo Struct do jogo antes da jogada
+ */
+void antecipaJogadas(tAntecipacao* antecipacao, const tJogo* jogo);
+
+/**
+ * @brief Obtem o estado antecipado para o comando lido, esperando-o ficar pronto.
+ *
+ * @param antecipacao Antecipacao de jogadas
+ * @param comando Comando lido
+ * @param jogo Ponteiro para o estado atual do jogo, trocado pelo do estado antecipado
+ * @return int Indice da direcao, ou -1 se o comando nao eh uma direcao
+ */
+int obtemJogadaAntecipada(tAntecipacao* antecipacao, char comando, tJogo** jogo);
+
+/**
+ * @brief Escreve o texto ja formatado de um estado antecipado, como printEstadoJogo.
+ *
+ * @param antecipacao Antecipacao de jogadas
+ * @param direcao Indice da direcao devolvido por obtemJogadaAntecipada
+ * @param jogo Struct do jogo apos a jogada
+ */
+void printJogadaAntecipada(tAntecipacao* antecipacao, int direcao, const tJogo* jogo);
+
+/**
+ * @brief Funcao da thread de antecipacao: calcula e formata os estados pedidos.
+ *
+ * @param arg Antecipacao de jogadas
+ * @return void* NULL
+ */
+void* executaAntecipacao(void* arg);
+
+/**
+ * @brief Encerra a thread de antecipacao e libera a memoria.
+ *
+ * @param antecipacao Antecipacao de jogadas
+ * @param atual Estado atual do jogo, que pode estar em um buffer da antecipacao
+ * @param jogo Struct do jogo, que recebe o estado atual
+ */
+void encerraAntecipacao(tAntecipacao* antecipacao, const tJogo* atual, tJogo* jogo);
+
+
+////////////////////////////////////// FUNCOES DO LOTE ///////////////////////////////
+/**
+ * @brief Coordena um lote de partidas em varios processos. Le o manifesto (uma partida
+ * por linha, com o diretorio do mapa e o arquivo de jogadas), abre um socket local,
+ * inicia os trabalhadores e distribui as fatias ate todas as partidas terminarem. No
+ * fim, gera em '<saida>/saida/' o 'estatisticas.txt' e o 'ranking.txt' somados de
+ * todas as partidas e o 'lote.csv' com o resultado de cada uma.
+ *
+ * @param manifesto Arquivo com as partidas
+ * @param saida Diretorio onde a pasta 'saida' sera criada
+ * @param qtd_trabalhadores Quantidade de trabalhadores iniciados; com 0, o coordenador
+ * apenas espera trabalhadores iniciados por fora
+ * @param tam_fatia Quantidade de partidas por fatia
+ * @param caminho_socket Caminho do socket local
+ * @return int 0 se todas as partidas foram jogadas, 1 caso contrario
+ */
+int coordenaLote(char* manifesto, char* saida, int qtd_trabalhadores, int tam_fatia, char* caminho_socket);
+
+/**
+ * @brief Laco de um trabalhador do lote: conecta ao coordenador, pede uma fatia, joga
+ * suas partidas devolvendo cada resultado e pede a proxima, ate receber LOTE_FIM.
+ *
+ * @param caminho_socket Caminho do socket do coordenador
+ * @return int 0 se o lote terminou, 1 se a conexao falhou
+ */
+int trabalhaLote(char* caminho_socket);
+
+/**
+ * @brief Joga uma partida do lote sem imprimir nada, lendo as jogadas do arquivo da
+ * tarefa. Quando as jogadas acabam, o Pacman segue na ultima direcao.
+ *
+ * @param tarefa Partida a ser jogada
+ * @param resultado Resultado da partida
+ */
+void jogaTarefaLote(const tTarefaLote* tarefa, tResultadoLote* resultado);
+
+/**
+ * @brief Inicia um processo trabalhador deste mesmo executavel.
+ *
+ * @param caminho_socket Caminho do socket do coordenador
+ * @return pid_t Processo iniciado, ou -1 em caso de erro
+ */
+pid_t iniciaTrabalhadorLote(char* caminho_socket);
+
+/**
+ * @brief Trata uma mensagem recebida de um trabalhador.
+ *
+ * @param lote Lote em andamento
+ * @param conexao Conexao do trabalhador
+ * @return int 1 se a mensagem foi tratada, 0 se a conexao caiu
+ */
+int trataMensagemLote(tLote* lote, tConexaoLote* conexao);
+
+/**
+ * @brief Manda uma fatia da fila para cada trabalhador que esta esperando, ou LOTE_FIM
+ * se todas as partidas ja terminaram.
+ *
+ * @param lote Lote em andamento
+ */
+void distribuiFatias(tLote* lote);
+
+/**
+ * @brief Fecha a conexao de um trabalhador que caiu. A primeira partida pendente da
+ * fatia dele ganha uma tentativa, e eh descartada apos MAX_TENTATIVAS_LOTE; as demais
+ * voltam para a fila.
+ *
+ * @param lote Lote em andamento
+ * @param indice Indice da conexao
+ */
+void derrubaConexaoLote(tLote* lote, int indice);
+
+/**
+ * @brief Gera os arquivos de saida do lote a partir dos resultados recebidos.
+ *
+ * @param lote Lote encerrado
+ * @param saida Diretorio onde a pasta 'saida' sera criada
+ */
+void geraSaidasLote(tLote* lote, char* saida);
+
+/**
+ * @brief Le exatamente 'tamanho' bytes de um socket.
+ *
+ * @param fd Socket
+ * @param dados Buffer de destino
+ * @param tamanho Quantidade de bytes
+ * @return int 1 se todos os bytes foram lidos, 0 se a conexao caiu
+ */
+int leTudo(int fd, void* dados, size_t tamanho);
+
+/**
+ * @brief Escreve exatamente 'tamanho' bytes em um socket.
+ *
+ * @param fd Socket
+ * @param dados Bytes a escrever
+ * @param tamanho Quantidade de bytes
+ * @return int 1 se todos os bytes foram escritos, 0 se a conexao caiu
+ */
+int escreveTudo(int fd, const void* dados, size_t tamanho);
+
+
+////////////////////////////////// FUNCOES DO MULTIJOGADOR ////////////////////////////
+/**
+ * @brief Joga uma partida com varios Pac-Men no mesmo mapa. A cada rodada, le uma
+ * linha com uma direcao por jogador, resolve todos os jogadores e imprime o estado. No
+ * fim, gera o 'trilha.txt' do mapa e o resumo, as estatisticas e o ranking de cada
+ * jogador, com o sufixo '_jogador<n>'.
+ *
+ * @param dir Diretorio do mapa
+ * @param opcoes Opcoes do jogo; 'multijogador' eh 1 no modo cooperativo e 2 no
+ * competitivo
+ * @return int 0 se a partida foi jogada, 1 se o mapa nao tem Pac-Man
+ */
+int jogaPartidaMulti(char* dir, tOpcoes opcoes);
+
+/**
+ * @brief Cria um jogador em cada '>' do mapa, em ordem de leitura.
+ *
+ * @param partida Partida com o jogo ja carregado
+ */
+void criaJogadoresMulti(tPartidaMulti* partida);
+
+/**
+ * @brief Le as direcoes de todos os jogadores para a rodada, de uma so vez: uma linha
+ * em que o n-esimo caractere que nao eh espaco eh a direcao do n-esimo jogador. Quem
+ * nao recebe direcao, inclusive quando a entrada acaba, segue na ultima.
+ *
+ * @param partida Partida em andamento
+ * @param direcoes Direcao de cada jogador
+ */
+void leComandosMulti(tPartidaMulti* partida, char* direcoes);
+
+/**
+ * @brief Realiza uma rodada: os fantasmas andam uma vez, todos os jogadores se movem e
+ * tem as colisoes verificadas contra o mesmo estado, e so entao as comidas sao
+ * distribuidas. Quando varios jogadores chegam a mesma comida, ela fica com o primeiro
+ * na ordem da rodada, que comeca em um jogador diferente a cada rodada.
+ *
+ * @param partida Partida em andamento
+ * @param direcoes Direcao de cada jogador
+ */
+void realizaRodadaMulti(tPartidaMulti* partida, const char* direcoes);
+
+/**
+ * @brief Envia o resumo acumulado de um jogador a thread de escrita e, se 'continua'
+ * for 1, abre um novo lote.
+ *
+ * @param partida Partida em andamento
+ * @param jogador Indice do jogador
+ * @param continua 1 se ainda havera linhas depois deste lote
+ */
+void enviaResumoMulti(tPartidaMulti* partida, int jogador, int continua);
+
+/**
+ * @brief Atualiza o mapa e desenha os jogadores ativos com os simbolos de
+ * SIMBOLOS_JOGADORES, marcando a trilha com o movimento de cada um.
+ *
+ * @param partida Partida em andamento
+ */
+void desenhaJogadoresMulti(tPartidaMulti* partida);
+
+/**
+ * @brief Imprime o mapa e a pontuacao de cada jogador apos a rodada.
+ *
+ * @param partida Partida em andamento
+ */
+void printEstadoMulti(tPartidaMulti* partida);
+
+/**
+ * @brief Verifica se a partida acabou e imprime o resultado.
+ *
+ * @param partida Partida em andamento
+ * @return int 1 se a partida acabou, 0 caso contrario
+ */
+int verificaFimMulti(tPartidaMulti* partida);
+
+
+////////////////////////////// FUNCOES DA MEDICAO DOS PASSOS ///////////////////////////
+/**
+ * @brief Mede, no mapa do diretorio, quanto tempo cada passo de fantasmas leva por
+ * rodada: o generico, com a grade de inteiros, e os especializados em cuja largura o
+ * mapa cabe. Os fantasmas partem das posicoes iniciais, e o resultado de cada passo eh
+ * conferido com o do generico.
+ *
+ * @param dir Diretorio do mapa
+ * @param rodadas Quantidade de rodadas medidas em cada passo
+ */
+void medePassos(char* dir, int rodadas);
+
+/**
+ * @brief Move os fantasmas pelas rodadas com o passo de uma classe e mede o tempo.
+ *
+ * @param classe Classe do passo, ou -1 para o generico
+ * @param fantasmas Fantasmas nas posicoes iniciais
+ * @param grade Grade de bloqueio no formato do passo
+ * @param rodadas Quantidade de rodadas
+ * @param estado Recebe x, y, dx e dy dos fantasmas ao final, em sequencia
+ * @return double Nanossegundos por rodada
+ */
+double cronometraPasso(int classe, const tFantasmas* fantasmas, const void* grade, int rodadas, int* estado);
+
+
+/****************************************** MAIN ********************************************/
+int main(int argc, char* argv[])
+{
+    if (argc <= 1) {
+        printf("ERRO: O diretorio de arquivos de configuracao nao foi informado\n");
+        return 1;
+    }
+
+    if (strcmp(argv[1], "--gera-mapa-embutido") == 0) {
+        if (argc <= 3) {
+            printf("ERRO: Uso: %s --gera-mapa-embutido <diretorio> <cabecalho.h>\n", argv[0]);
+            return 1;
+        }
+
+        geraMapaEmbutido(argv[2], argv[3]);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--valida") == 0) {
+        if (argc <= 3) {
+            printf("ERRO: Uso: %s --valida <diretorio_raiz> <catalogo> [threads]\n", argv[0]);
+            return 1;
+        }
+
+        int qtd_threads = argc > 4 ? atoi(argv[4]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        return validaAcervo(argv[2], argv[3], qtd_threads) > 0;
+    }
+
+    if (strcmp(argv[1], "--reproduz") == 0) {
+        if (argc <= 3) {
+            printf("ERRO: Uso: %s --reproduz <gravacao> <movimento>\n", argv[0]);
+            return 1;
+        }
+
+        return !reproduzGravacao(argv[2], atoi(argv[3]));
+    }
+
+    if (strcmp(argv[1], "--le-metricas") == 0) {
+        if (argc <= 2) {
+            printf("ERRO: Uso: %s --le-metricas <nome> [intervalo_ms] [amostras]\n", argv[0]);
+            return 1;
+        }
+
+        return !leMetricas(argv[2], argc > 3 ? atoi(argv[3]) : 500, argc > 4 ? atoi(argv[4]) : 0);
+    }
+
+    if (strcmp(argv[1], "--lote") == 0) {
+        if (argc <= 4) {
+            printf("ERRO: Uso: %s --lote <manifesto> <saida> <trabalhadores> [tamanho_fatia] [socket]\n", argv[0]);
+            return 1;
+        }
+
+        char caminho_socket[108];
+        if (argc > 6) {
+            snprintf(caminho_socket, sizeof(caminho_socket), "%s", argv[6]);
+        } else {
+            snprintf(caminho_socket, sizeof(caminho_socket), "/tmp/pacman-lote-%d.sock", (int)getpid());
+        }
+
+        iniciaEscritor();
+        int resultado = coordenaLote(argv[2], argv[3], atoi(argv[4]), argc > 5 ? atoi(argv[5]) : TAM_FATIA_LOTE, caminho_socket);
+        encerraEscritor();
+
+        return resultado;
+    }
+
+    if (strcmp(argv[1], "--trabalhador-lote") == 0) {
+        if (argc <= 2) {
+            printf("ERRO: Uso: %s --trabalhador-lote <socket>\n", argv[0]);
+            return 1;
+        }
+
+        return trabalhaLote(argv[2]);
+    }
+
+    if (strcmp(argv[1], "--converte-trilha") == 0) {
+        if (argc <= 3) {
+            printf("ERRO: Uso: %s --converte-trilha <trilha.bin> <trilha.txt>\n", argv[0]);
+            return 1;
+        }
+
+        return !converteTrilha(argv[2], argv[3]);
+    }
+
+    if (strcmp(argv[1], "--decodifica-sessao") == 0) {
+        if (argc <= 2) {
+            printf("ERRO: Uso: %s --decodifica-sessao <registro> [estado]\n", argv[0]);
+            return 1;
+        }
+
+        return !decodificaSessao(argv[2], argc > 3 ? atoi(argv[3]) : -1);
+    }
+
+    if (strcmp(argv[1], "--assiste") == 0) {
+        if (argc <= 2) {
+            printf("ERRO: Uso: %s --assiste <nome>\n", argv[0]);
+            return 1;
+        }
+
+        return !assisteTransmissao(argv[2]);
+    }
+
+    if (strcmp(argv[1], "--mede-bot") == 0) {
+        if (argc <= 3) {
+            printf("ERRO: Uso: %s --mede-bot <biblioteca> <diretorio> [partidas]\n", argv[0]);
+            return 1;
+        }
+
+        if (!carregaBot(argv[2], &bot_carregado)) return 1;
+        medeBot(argv[3], argc > 4 ? atoi(argv[4]) : 100);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "--mede-passos") == 0) {
+        if (argc <= 2) {
+            printf("ERRO: Uso: %s --mede-passos <diretorio> [rodadas]\n", argv[0]);
+            return 1;
+        }
+
+        medePassos(argv[2], argc > 3 ? atoi(argv[3]) : 100000);
+        return 0;
+    }
+
+    tOpcoes opcoes = { 0 };
+    char dir[MAX_DIR_SIZE];
+    char campanha[MAX_DIR_SIZE];
+    char** torneio = NULL;
+    int arg = 1;
+
+    dir[0] = '\0';
+    campanha[0] = '\0';
+
+    while (arg < argc && strncmp(argv[arg], "--", 2) == 0) {
+        if (strcmp(argv[arg], "--encerra-impossivel") == 0) {
+            opcoes.encerra_impossivel = 1;
+        } else if (strcmp(argv[arg], "--mapa-de-calor") == 0) {
+            opcoes.mapa_de_calor = 1;
+        } else if (strcmp(argv[arg], "--desfazer") == 0) {
+            opcoes.desfazer = 1;
+        } else if (strcmp(argv[arg], "--grava") == 0) {
+            opcoes.gravar = 1;
+        } else if (strcmp(argv[arg], "--perseguicao") == 0) {
+            opcoes.perseguicao = 1;
+        } else if (strcmp(argv[arg], "--bot") == 0 && arg + 1 < argc) {
+            if (!carregaBot(argv[arg + 1], &bot_carregado)) return 1;
+            opcoes.bot = 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--catalogo") == 0 && arg + 2 < argc) {
+            int encontrado = buscaNoCatalogo(argv[arg + 1], atoi(argv[arg + 2]), dir);
+
+            if (encontrado < 0) {
+                printf("ERRO: O mapa %s mudou desde a validacao do catalogo '%s'; valide o acervo de novo\n",
+                       argv[arg + 2], argv[arg + 1]);
+                return 1;
+            } else if (!encontrado) {
+                printf("ERRO: Mapa %s nao encontrado ou invalido no catalogo '%s'\n", argv[arg + 2], argv[arg + 1]);
+                return 1;
+            }
+            arg += 2;
+        } else if (strcmp(argv[arg], "--torneio") == 0 && arg + 4 < argc) {
+            torneio = &argv[arg + 1];
+            arg += 4;
+        } else if (strcmp(argv[arg], "--metricas") == 0 && arg + 1 < argc) {
+            if (!iniciaMetricas(argv[arg + 1])) return 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--transmite") == 0 && arg + 1 < argc) {
+            if (!iniciaTransmissao(argv[arg + 1])) return 1;
+            arg++;
+        } else if (strcmp(argv[arg], "--registra-sessao") == 0) {
+            opcoes.registrar_sessao = 1;
+        } else if (strcmp(argv[arg], "--multijogador") == 0 && arg + 1 < argc) {
+            if (strcmp(argv[arg + 1], "cooperativo") == 0) {
+                opcoes.multijogador = 1;
+            } else if (strcmp(argv[arg + 1], "competitivo") == 0) {
+                opcoes.multijogador = 2;
+            } else {
+                printf("ERRO: O modo multijogador deve ser 'cooperativo' ou 'competitivo'\n");
+                return 1;
+            }
+            arg++;
+        } else if (strcmp(argv[arg], "--trilha-binaria") == 0) {
+            opcoes.trilha_binaria = 1;
+        } else if (strcmp(argv[arg], "--antecipa") == 0) {
+            opcoes.antecipar = 1;
+        } else if (strcmp(argv[arg], "--janela") == 0 && arg + 2 < argc) {
+            opcoes.janela_linhas = atoi(argv[arg + 1]);
+            opcoes.janela_colunas = atoi(argv[arg + 2]);
+
+            if (opcoes.janela_linhas <= 0 || opcoes.janela_colunas <= 0) {
+                printf("ERRO: A janela deve ter pelo menos uma linha e uma coluna\n");
+                return 1;
+            }
+            arg += 2;
+        } else if (strcmp(argv[arg], "--minimapa") == 0 && arg + 1 < argc) {
+            opcoes.minimapa = atoi(argv[arg + 1]);
+
+            if (opcoes.minimapa <= 0) {
+                printf("ERRO: O fator do minimapa deve ser positivo\n");
+                return 1;
+            }
+            arg++;
+        } else if (strcmp(argv[arg], "--threads") == 0 && arg + 1 < argc) {
+            opcoes.threads = atoi(argv[arg + 1]);
+            arg++;
+        } else if (strcmp(argv[arg], "--campanha") == 0 && arg + 1 < argc) {
+            strncpy(campanha, argv[arg + 1], MAX_DIR_SIZE - 1);
+            campanha[MAX_DIR_SIZE - 1] = '\0';
+            arg++;
+        } else {
+            printf("ERRO: Opcao desconhecida '%s'\n", argv[arg]);
+            return 1;
+        }
+        arg++;
+    }
+
+    // A gravacao so tem jogadas para frente; desfazer quebraria a sequencia
+    if (opcoes.gravar && opcoes.desfazer) {
+        printf("ERRO: As opcoes --grava e --desfazer nao podem ser usadas juntas\n");
+        return 1;
+    }
+
+    if (torneio != NULL) {
+        iniciaEscritor();
+        int resultado = jogaTorneio(torneio[0], torneio[1], torneio[2], torneio[3], opcoes);
+        encerraEscritor();
+
+        return resultado;
+    }
+
+    if (campanha[0] != '\0') {
+        iniciaEscritor();
+        int resultado = jogaCampanha(campanha, opcoes);
+        encerraEscritor();
+
+        return resultado;
+    }
+
+    if (arg < argc) {
+        strcpy(dir, argv[arg]);
+    } else if (dir[0] == '\0') {
+        printf("ERRO: O diretorio de arquivos de configuracao nao foi informado\n");
+        return 1;
+    }
+
+    if (opcoes.multijogador) {
+        iniciaEscritor();
+        int resultado = jogaPartidaMulti(dir, opcoes);
+        encerraEscritor();
+
+        return resultado;
+    }
+
+    iniciaEscritor();
+
+    tJogo jogo = inicializaJogo(dir);
+    jogo.opcoes = opcoes;
+    jogaPartida(jogo);
+
+    encerraEscritor();
+
+    return 0;
+}
+
+
+////////////////////////////////// FUNCOES DO MAPA ///////////////////////////////////
+int leMapa(char* dir, tMapa* mapa, char* erro) {
+    FILE* mapaFile;
+    char mapa_dir[MAX_DIR_SIZE + 9];
+    sprintf(mapa_dir, "%s/mapa.txt", dir);
+
+    mapaFile = fopen(mapa_dir, "r");
+
+    if (mapaFile == NULL) {
+        sprintf(erro, "arquivo 'mapa.txt' nao encontrado em %s", dir);
+        return 0;
+    }
+
+    tMapa lido = { 0 };
+
+    if (fscanf(mapaFile, "%d %d %d\n", &lido.linhas, &lido.colunas, &lido.lim_movs) != 3) {
+        sprintf(erro, "cabecalho invalido em %s/mapa.txt", dir);
+        fclose(mapaFile);
+        return 0;
+    }
+
+    if (lido.linhas < 1 || lido.linhas > MAX_LINHAS || lido.colunas < 1 || lido.colunas > MAX_COLUNAS || lido.lim_movs < 0) {
+        sprintf(erro, "dimensoes invalidas (%d x %d, %d movimentos) em %s/mapa.txt", lido.linhas, lido.colunas, lido.lim_movs, dir);
+        fclose(mapaFile);
+        return 0;
+    }
+
+    int i, j;
+    for (i = 0; i < lido.linhas; i++) {
+        for (j = 0; j < lido.colunas; j++) {
+            if (fscanf(mapaFile, "%c", &lido.mapa[i][j]) != 1 || lido.mapa[i][j] == '\n') {
+                sprintf(erro, "linha %d com menos de %d colunas em %s/mapa.txt", i + 1, lido.colunas, dir);
+                fclose(mapaFile);
+                return 0;
+            }
+        }
+        fscanf(mapaFile, "\n");
+    }
+
+    fclose(mapaFile);
+
+    *mapa = lido;
+
+    return 1;
+}
+
+void atualizaMapa(tJogo* jogo) {
+    int i, j;
+    tMapa* mapa = &jogo->mapa;
+
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == '#') continue;
+
+            mapa->mapa[i][j] = ' ';
+
+            if (temComidaNaPosicao(j, i, jogo)) {
+                mapa->mapa[i][j] = '*';
+            } else if (temPortalNaPosicao(j, i, jogo->portais)) {
+                mapa->mapa[i][j] = '@';
+            }
+
+            if (jogo->pacman.x == j && jogo->pacman.y == i && !temFantasmaNaPosicao(j, i, &jogo->fantasmas)) {
+                mapa->mapa[i][j] = '>';
+                mapa->trilha[i][j] = jogo->pacman.mov_atual;
+            }
+        }
+    }
+
+    // Os fantasmas sao desenhados do ultimo para o primeiro, para que o primeiro
+    // fantasma de uma celula compartilhada seja o que aparece no mapa
+    for (i = jogo->fantasmas.qtd - 1; i >= 0; i--) {
+        int x = jogo->fantasmas.x[i];
+        int y = jogo->fantasmas.y[i];
+
+        if (x < 0 || x >= mapa->colunas || y < 0 || y >= mapa->linhas) continue;
+
+        if (mapa->mapa[y][x] != '#') {
+            mapa->mapa[y][x] = jogo->fantasmas.tipo[i];
+        }
+    }
+}
+
+void criaTrilha(tJogo* jogo) {
+    int i, j;
+    tMapa* mapa = &jogo->mapa;
+
+    // A linha da trilha vai por ponteiro: indexando mapa->trilha[i][j] junto da leitura
+    // de mapa->mapa, o GCC 12 em -O1 descarta a chamada inteira em preparaJogo
+    for (i = 0; i < mapa->linhas; i++) {
+        int* trilha = mapa->trilha[i];
+
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == '>') {
+                trilha[j] = 0;
+            } else {
+                trilha[j] = -1;
+            }
+        }
+    }
+}
+
+void fprintMapa(tMapa mapa, FILE* saidaFile) {
+    int i;
+
+    // As linhas do mapa nao terminam em '\0'; cada uma eh escrita de uma vez
+    for (i = 0; i < mapa.linhas; i++) {
+        fwrite(mapa.mapa[i], 1, mapa.colunas, saidaFile);
+        fputc('\n', saidaFile);
+    }
+}
+
+void printMapa(tMapa mapa) {
+    fprintMapa(mapa, stdout);
+}
+
+
+////////////////////////////////// FUNCOES DO PACMAN /////////////////////////////////
+tPacman criaPacman(const tJogo* jogo) {
+    int i, j;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '>') {
+                tPacman pacman = { 0 };
+
+                pacman.y = i;
+                pacman.x = j;
+                pacman.pontos = 0;
+                pacman.movs_restantes = jogo->mapa.lim_movs;
+                pacman.mov_atual = 0;
+                pacman.colidiu_com_parede = 0;
+                pacman.colidiu_com_fantasma = 0;
+                pacman.colidiu_com_comida = 0;
+                pacman.colidiu_com_portal = 0;
+
+                return pacman;
+            }
+        }
+    }
+}
+
+tPacman movePacman(const tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    pacman.mov_atual++;
+    pacman.movs_restantes--;
+
+    int new_x = pacman.x;
+    int new_y = pacman.y;
+
+    if (pacman.direcao == 'w') {
+        new_y--;
+    } else if (pacman.direcao == 'a') {
+        new_x--;
+    } else if (pacman.direcao == 's') {
+        new_y++;
+    } else if (pacman.direcao == 'd') {
+        new_x++;
+    }
+
+    if (jogo->mapa.mapa[new_y][new_x] != '#') {
+        if (!jogo->trocaram_posicao) {
+            pacman.x = new_x;
+            pacman.y = new_y;
+        }
+        pacman.colidiu_com_parede = 0;
+    } else {
+        pacman.colidiu_com_parede = 1;
+    }
+
+    return pacman;
+}
+
+tPacman verificaColisaoPacman(const tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    pacman.colidiu_com_fantasma = 0;
+    pacman.colidiu_com_comida = 0;
+    pacman.colidiu_com_portal = 0;
+
+    if (temFantasmaNaPosicao(pacman.x, pacman.y, &jogo->fantasmas) || jogo->trocaram_posicao) {
+        pacman.colidiu_com_fantasma = 1;
+    } else if (temComidaNaPosicao(pacman.x, pacman.y, jogo)) {
+        pacman.colidiu_com_comida = 1;
+    }
+
+    if (temPortalNaPosicao(pacman.x, pacman.y, jogo->portais)) {
+        pacman.colidiu_com_portal = 1;
+    }
+
+    return pacman;
+}
+
+int temPacmanNaPosicao(int x, int y, tPacman pacman) {
+    return (x == pacman.x && y == pacman.y);
+}
+
+
+//////////////////////////////// FUNCOES DOS FANTASMAS ///////////////////////////////
+void criaFantasmas(tJogo* jogo) {
+    int i, j;
+
+    jogo->fantasmas.qtd = 0;
+
+    preparaBloqueio(&jogo->fantasmas, jogo->mapa.linhas, jogo->mapa.colunas);
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            BLOQUEIO(&jogo->fantasmas, j, i) = (posicao == '#' || posicao == '@');
+
+            if (posicao == 'B' || posicao == 'P' || posicao == 'I' || posicao == 'C') {
+                int idx = jogo->fantasmas.qtd;
+                char direcao = '\0';
+
+                if (posicao == 'B') direcao = 'a';
+                else if (posicao == 'P') direcao = 'w';
+                else if (posicao == 'I') direcao = 's';
+                else if (posicao == 'C') direcao = 'd';
+
+                jogo->fantasmas.x[idx] = j;
+                jogo->fantasmas.y[idx] = i;
+                jogo->fantasmas.tipo[idx] = posicao;
+                deltaDirecao(direcao, &jogo->fantasmas.dx[idx], &jogo->fantasmas.dy[idx]);
+
+                jogo->fantasmas.qtd++;
+            }
+        }
+    }
+}
+
+void moveFantasmas(tJogo* jogo) {
+    int i;
+    tFantasmas* fantasmas = &jogo->fantasmas;
+
+#ifdef MAPA_EMBUTIDO
+    if (MAPA_EMBUTIDO_CICLOS_FIXOS && !jogo->opcoes.perseguicao) {
+        posicionaFantasmasPeloCiclo(jogo);
+        return;
+    }
+#endif
+
+    // Um portal so bloqueia enquanto aparece no mapa; coberto pelo Pacman, nao bloqueia
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        char celula = jogo->mapa.mapa[jogo->portais[i].y][jogo->portais[i].x];
+        BLOQUEIO(fantasmas, jogo->portais[i].x, jogo->portais[i].y) = (celula == '#' || celula == '@');
+    }
+
+    if (jogo->opcoes.perseguicao) {
+        perseguePacman(jogo);
+        return;
+    }
+
+    passoFantasmas(fantasmas->classe, fantasmas->qtd, fantasmas->x, fantasmas->y, fantasmas->dx, fantasmas->dy, fantasmas->bloqueio);
+}
+
+void preparaBloqueio(tFantasmas* fantasmas, int linhas, int colunas) {
+    // A borda extra conta nas dimensoes da grade
+    if (linhas + 2 <= LARGURA_PEQUENA && colunas + 2 <= LARGURA_PEQUENA) {
+        fantasmas->classe = CLASSE_PEQUENA;
+        fantasmas->largura_bloqueio = LARGURA_PEQUENA;
+    } else if (colunas + 2 <= LARGURA_MEDIA) {
+        fantasmas->classe = CLASSE_MEDIA;
+        fantasmas->largura_bloqueio = LARGURA_MEDIA;
+    } else {
+        fantasmas->classe = CLASSE_GRANDE;
+        fantasmas->largura_bloqueio = LARGURA_GRANDE;
+    }
+
+    memset(fantasmas->bloqueio, 1, sizeof(fantasmas->bloqueio));
+}
+
+void passoFantasmas(int classe, int qtd, int* restrict x, int* restrict y, int* restrict dx, int* restrict dy,
+                    const uint8_t* restrict bloqueio) {
+    if (classe == CLASSE_PEQUENA) {
+        passoFantasmasPequeno(qtd, x, y, dx, dy, bloqueio);
+    } else if (classe == CLASSE_MEDIA) {
+        passoFantasmasMedio(qtd, x, y, dx, dy, bloqueio);
+    } else {
+        passoFantasmasGrande(qtd, x, y, dx, dy, bloqueio);
+    }
+}
+
+DEFINE_PASSO_FANTASMAS(passoFantasmasPequeno, uint8_t, LARGURA_PEQUENA)
+DEFINE_PASSO_FANTASMAS(passoFantasmasMedio, uint8_t, LARGURA_MEDIA)
+DEFINE_PASSO_FANTASMAS(passoFantasmasGrande, uint8_t, LARGURA_GRANDE)
+DEFINE_PASSO_FANTASMAS(passoFantasmasGenerico, int, MAX_COLUNAS + 2)
+
+void perseguePacman(tJogo* jogo) {
+    int i, k;
+    tFantasmas* fantasmas = &jogo->fantasmas;
+    int portais = 0;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        portais |= BLOQUEIO(fantasmas, jogo->portais[i].x, jogo->portais[i].y) << i;
+    }
+
+    // O campo so depende da posicao do Pacman e de quais portais bloqueiam
+    if (!fantasmas->campo_valido || fantasmas->campo_x != jogo->pacman.x || fantasmas->campo_y != jogo->pacman.y ||
+        fantasmas->campo_portais != portais) {
+        calculaCampoPerseguicao(fantasmas, jogo->pacman.x, jogo->pacman.y);
+        fantasmas->campo_valido = 1;
+        fantasmas->campo_x = jogo->pacman.x;
+        fantasmas->campo_y = jogo->pacman.y;
+        fantasmas->campo_portais = portais;
+    }
+
+    int dispersao = jogo->pacman.mov_atual % CICLO_PERSEGUICAO < TEMPO_DISPERSAO;
+    int linhas = jogo->mapa.linhas;
+    int colunas = jogo->mapa.colunas;
+    int pdx, pdy;
+    deltaDirecao(jogo->pacman.direcao, &pdx, &pdy);
+
+    // Inky usa a posicao do primeiro Blinky no inicio da jogada; sem Blinky, mira a
+    // propria celula 2 a frente do Pacman
+    int pivo_x = jogo->pacman.x + 2 * pdx;
+    int pivo_y = jogo->pacman.y + 2 * pdy;
+    int alvo_inky_x = pivo_x, alvo_inky_y = pivo_y;
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (fantasmas->tipo[i] == 'B') {
+            alvo_inky_x = 2 * pivo_x - fantasmas->x[i];
+            alvo_inky_y = 2 * pivo_y - fantasmas->y[i];
+            break;
+        }
+    }
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        int x = fantasmas->x[i];
+        int y = fantasmas->y[i];
+        char tipo = fantasmas->tipo[i];
+        int usa_campo = 0, alvo_x = 0, alvo_y = 0;
+
+        if (dispersao || (tipo == 'C' && fantasmas->campo[y][x] >= 0 && fantasmas->campo[y][x] < RAIO_CLYDE)) {
+            alvo_x = (tipo == 'B' || tipo == 'I') ? colunas - 1 : 0;
+            alvo_y = (tipo == 'I' || tipo == 'C') ? linhas - 1 : 0;
+        } else if (tipo == 'P') {
+            alvo_x = jogo->pacman.x + 4 * pdx;
+            alvo_y = jogo->pacman.y + 4 * pdy;
+        } else if (tipo == 'I') {
+            alvo_x = alvo_inky_x;
+            alvo_y = alvo_inky_y;
+        } else {
+            usa_campo = 1;
+        }
+
+        // Comeca pela direcao atual, para que ela venca os empates
+        int melhor_dx = 0, melhor_dy = 0, melhor_valor = 0, achou = 0;
+        int candidatos[QTD_MOVIMENTOS + 1][2] = {
+            { fantasmas->dx[i], fantasmas->dy[i] }, { 0, -1 }, { -1, 0 }, { 0, 1 }, { 1, 0 }
+        };
+
+        for (k = 0; k <= QTD_MOVIMENTOS; k++) {
+            int cdx = candidatos[k][0];
+            int cdy = candidatos[k][1];
+
+            if (cdx == 0 && cdy == 0) continue;
+            if (cdx == -fantasmas->dx[i] && cdy == -fantasmas->dy[i]) continue;
+            if (BLOQUEIO(fantasmas, x + cdx, y + cdy)) continue;
+
+            // Celulas de onde nao se chega ao Pacman contam como as mais distantes
+            int valor;
+            if (usa_campo) {
+                valor = fantasmas->campo[y + cdy][x + cdx];
+                if (valor < 0) valor = MAX_LINHAS * MAX_COLUNAS;
+            } else {
+                valor = (x + cdx - alvo_x) * (x + cdx - alvo_x) + (y + cdy - alvo_y) * (y + cdy - alvo_y);
+            }
+            valor = -valor;
+
+            if (!achou || valor > melhor_valor) {
+                melhor_dx = cdx;
+                melhor_dy = cdy;
+                melhor_valor = valor;
+                achou = 1;
+            }
+        }
+
+        // Sem outra saida, volta; sem nem isso, fica parado
+        if (!achou && !BLOQUEIO(fantasmas, x - fantasmas->dx[i], y - fantasmas->dy[i])) {
+            melhor_dx = -fantasmas->dx[i];
+            melhor_dy = -fantasmas->dy[i];
+        }
+
+        fantasmas->dx[i] = melhor_dx;
+        fantasmas->dy[i] = melhor_dy;
+        fantasmas->x[i] += melhor_dx;
+        fantasmas->y[i] += melhor_dy;
+    }
+}
+
+void calculaCampoPerseguicao(tFantasmas* fantasmas, int x, int y) {
+    static _Thread_local int fila[MAX_LINHAS * MAX_COLUNAS][2];
+    int inicio = 0, fim = 0;
+    int i, j;
+
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            fantasmas->campo[i][j] = -1;
+        }
+    }
+
+    fantasmas->campo[y][x] = 0;
+    fila[fim][0] = x;
+    fila[fim][1] = y;
+    fim++;
+
+    while (inicio < fim) {
+        int cx = fila[inicio][0];
+        int cy = fila[inicio][1];
+        inicio++;
+
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            int nx = cx + (i == D) - (i == A);
+            int ny = cy + (i == S) - (i == W);
+
+            if (BLOQUEIO(fantasmas, nx, ny) || fantasmas->campo[ny][nx] >= 0) continue;
+
+            fantasmas->campo[ny][nx] = fantasmas->campo[cy][cx] + 1;
+            fila[fim][0] = nx;
+            fila[fim][1] = ny;
+            fim++;
+        }
+    }
+}
+
+char temFantasmaNaPosicao(int x, int y, const tFantasmas* fantasmas) {
+    int i;
+
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (fantasmas->x[i] == x && fantasmas->y[i] == y) {
+            return fantasmas->tipo[i];
+        }
+    }
+
+    return '\0';
+}
+
+void deltaDirecao(char direcao, int* dx, int* dy) {
+    *dx = (direcao == 'd') - (direcao == 'a');
+    *dy = (direcao == 's') - (direcao == 'w');
+}
+
+
+///////////////////////////////// FUNCOES DAS COMIDAS ////////////////////////////////
+void criaComidas(tJogo* jogo) {
+    int i, j;
+
+    jogo->qtd_inicial_comidas = 0;
+    jogo->comidas_restantes = 0;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '*') {
+                tComida comida = { 0 };
+
+                comida.x = j;
+                comida.y = i;
+                comida.foi_comida = 0;
+
+                jogo->comidas[jogo->qtd_inicial_comidas] = comida;
+                jogo->qtd_inicial_comidas++;
+                jogo->comidas_restantes++;
+            }
+        }
+    }
+}
+
+void indexaComidas(tJogo* jogo) {
+    int i, j;
+
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            jogo->indice_comidas[i][j] = -1;
+        }
+    }
+
+    for (i = 0; i < jogo->qtd_inicial_comidas; i++) {
+        if (!jogo->comidas[i].foi_comida) {
+            jogo->indice_comidas[jogo->comidas[i].y][jogo->comidas[i].x] = i;
+        }
+    }
+}
+
+void comeComida(int x, int y, tJogo* jogo) {
+    if (x < 0 || x >= MAX_COLUNAS || y < 0 || y >= MAX_LINHAS) return;
+
+    int i = jogo->indice_comidas[y][x];
+
+    if (i >= 0) {
+        tComida comida = jogo->comidas[i];
+
+        comida.x = -1;
+        comida.y = -1;
+        comida.foi_comida = 1;
+
+        jogo->comidas[i] = comida;
+        jogo->comidas_restantes--;
+        jogo->indice_comidas[y][x] = -1;
+    }
+}
+
+int temComidaNaPosicao(int x, int y, const tJogo* jogo) {
+    if (x < 0 || x >= MAX_COLUNAS || y < 0 || y >= MAX_LINHAS) return 0;
+
+    return jogo->indice_comidas[y][x] >= 0;
+}
+
+
+///////////////////////////////// FUNCOES DOS PORTAIS ////////////////////////////////
+void criaPortais(tJogo* jogo) {
+    int i, j, idx = 0;
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas; j++) {
+            char posicao = jogo->mapa.mapa[i][j];
+
+            if (posicao == '@') {
+                jogo->portais[idx].x = j;
+                jogo->portais[idx].y = i;
+
+                idx++;
+            }
+        }
+    }
+}
+
+tPacman teleportaPacman(tPacman pacman, const tJogo* jogo) {
+    int i;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        tPortal portal = jogo->portais[i];
+
+        if (pacman.x == portal.x && pacman.y == portal.y) {
+            if (i == 0) {
+                pacman.x = jogo->portais[1].x;
+                pacman.y = jogo->portais[1].y;
+            } else {
+                pacman.x = jogo->portais[0].x;
+                pacman.y = jogo->portais[0].y;
+            }
+
+            return pacman;
+        }
+    }
+
+    return pacman;
+}
+
+int temPortalNaPosicao(int x, int y, const tPortal portais[QTD_PORTAIS]) {
+    int i;
+
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        if (portais[i].x == x && portais[i].y == y) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+
+/////////////////////////////////// FUNCOES DO JOGO //////////////////////////////////
+tJogo inicializaJogo(char* dir) {
+    criaPastaSaida(dir);
+    limpaResumo(dir);
+
+    return carregaJogo(dir);
+}
+
+tJogo carregaJogo(char* dir) {
+    tJogo jogo;
+    char erro[MAX_DIR_SIZE + 64];
+
+    if (!leJogo(dir, &jogo, erro)) {
+        printf("ERRO: %s\n", erro);
+        exit(1);
+    }
+
+    return jogo;
+}
+
+int leJogo(char* dir, tJogo* jogo, char* erro) {
+    memset(jogo, 0, sizeof(tJogo));
+    strcpy(jogo->dir, dir);
+
+#ifdef MAPA_EMBUTIDO
+    (void)erro;
+    carregaMapaEmbutido(jogo);
+#else
+    if (!leMapa(dir, &jogo->mapa, erro)) return 0;
+    criaObjetos(jogo);
+#endif
+
+    preparaJogo(jogo);
+
+    return 1;
+}
+
+void criaObjetos(tJogo* jogo) {
+    jogo->pacman = criaPacman(jogo);
+    criaFantasmas(jogo);
+    criaComidas(jogo);
+    criaPortais(jogo);
+}
+
+void preparaJogo(tJogo* jogo) {
+    indexaComidas(jogo);
+    criaEstatisticasMovimentos(jogo);
+    criaTrilha(jogo);
+    marcaComidasAlcancaveis(jogo);
+}
+
+tJogo jogaPartida(tJogo jogo) {
+    tMapaDeCalor* calor = NULL;
+    tHistorico* historico = NULL;
+    tGravacao* gravacao = NULL;
+    tAntecipacao* antecipacao = NULL;
+    void* estado_bot = NULL;
+    struct timespec antes, depois;
+
+    geraInicializacaoTxt(&jogo);
+
+    if (jogo.opcoes.mapa_de_calor) {
+        calor = carregaMapaDeCalor(jogo.dir, jogo.mapa.linhas, jogo.mapa.colunas);
+        registraNoMapaDeCalor(calor, &jogo);
+    }
+
+    if (jogo.opcoes.desfazer) {
+        historico = criaHistorico();
+    }
+
+    if (jogo.opcoes.gravar) {
+        gravacao = iniciaGravacao(&jogo);
+    }
+
+    if (jogo.opcoes.registrar_sessao) {
+        iniciaRegistroSessao(&jogo);
+    }
+
+    if (jogo.opcoes.bot && bot_carregado.bot->inicia != NULL) {
+        tVisaoBot visao = criaVisaoBot(&jogo, 0);
+        estado_bot = bot_carregado.bot->inicia(&visao);
+    }
+
+    // O bot decide na hora; so vale antecipar enquanto o jogador pensa
+    if (jogo.opcoes.antecipar && !jogo.opcoes.bot) {
+        antecipacao = criaAntecipacao();
+    }
+
+    verificaJogoImpossivel(&jogo);
+
+    publicaMetricas(&jogo, 0, 0);
+    transmiteQuadro(&jogo);
+
+    // Com a antecipacao, o estado atual passa a ser o buffer do sucessor escolhido
+    tJogo* atual = &jogo;
+
+    while (1) {
+        // Um jogo impossivel desde o inicio termina sem nenhum movimento
+        if (!atual->impossivel) {
+            char comando;
+            int antecipada = -1;
+
+            // O bot joga sem passar pela entrada nem pela impressao do mapa
+            if (atual->opcoes.bot) {
+                tVisaoBot visao = criaVisaoBot(atual, 0);
+                comando = bot_carregado.bot->decide(estado_bot, &visao);
+            } else {
+                if (antecipacao != NULL) antecipaJogadas(antecipacao, atual);
+                comando = leComando(atual);
+            }
+
+            // Desfazer e refazer nao contam como jogada nem entram no resumo
+            if (historico != NULL && (comando == 'u' || comando == 'r')) {
+                if (comando == 'u') {
+                    desfazJogadas(atual, historico, 1);
+                } else {
+                    refazJogadas(atual, historico, 1);
+                }
+                transmiteQuadro(atual);
+                continue;
+            }
+
+            if (historico != NULL) preparaRegistroHistorico(historico, atual);
+
+            clock_gettime(CLOCK_MONOTONIC, &antes);
+            if (antecipacao != NULL) antecipada = obtemJogadaAntecipada(antecipacao, comando, &atual);
+            if (antecipada < 0) executaJogada(atual, comando);
+            clock_gettime(CLOCK_MONOTONIC, &depois);
+
+            publicaMetricas(atual, (depois.tv_sec - antes.tv_sec) * 1000000000ULL + depois.tv_nsec - antes.tv_nsec,
+                            resultadoJogo(atual) != 0);
+            transmiteQuadro(atual);
+
+            if (antecipada >= 0) {
+                printJogadaAntecipada(antecipacao, antecipada, atual);
+            } else if (!atual->opcoes.bot) {
+                printEstadoJogo(atual);
+            }
+
+            if (historico != NULL) registraNoHistorico(historico, atual);
+            if (gravacao != NULL) gravaJogada(gravacao, atual);
+            if (calor != NULL) registraNoMapaDeCalor(calor, atual);
+        }
+
+        atualizaResumo(atual);
+
+        if (verificaFimDeJogo(atual))
+            break;
+    }
+
+    if (antecipacao != NULL) {
+        encerraAntecipacao(antecipacao, atual, &jogo);
+    }
+
+    geraEstatisticasTxt(&jogo);
+    geraRankingTxt(&jogo);
+    geraTrilhaTxt(&jogo);
+    if (jogo.opcoes.trilha_binaria) geraTrilhaBinaria(&jogo);
+
+    if (calor != NULL) {
+        atomic_fetch_add(&calor->partidas, 1);
+        salvaMapaDeCalor(calor, jogo.mapa, jogo.dir);
+        free(calor);
+    }
+
+    if (historico != NULL) {
+        free(historico->dados);
+        free(historico);
+    }
+
+    if (gravacao != NULL) {
+        encerraGravacao(gravacao, &jogo);
+    }
+
+    if (jogo.opcoes.bot && bot_carregado.bot->encerra != NULL) {
+        bot_carregado.bot->encerra(estado_bot);
+    }
+
+    return jogo;
+}
+
+void executaJogada(tJogo* jogo, char direcao) {
+    jogo->pacman.direcao = direcao;
+
+    realizaJogo(jogo);
+    atualizaEstatisticasMovimentos(jogo);
+    verificaJogoImpossivel(jogo);
+}
+
+char leComando(const tJogo* jogo) {
+    // Sem entrada, o Pacman segue na ultima direcao
+    char comando = jogo->pacman.direcao;
+
+    printEstadoJogo(jogo);
+    scanf(" %c", &comando);
+
+    return comando;
+}
+
+void realizaJogo(tJogo* jogo) {
+    moveFantasmas(jogo);
+    jogo->trocaram_posicao = verificaTrocaDePosicao(jogo->pacman, &jogo->fantasmas);
+    jogo->pacman = movePacman(jogo);
+
+    jogo->pacman = verificaColisaoPacman(jogo);
+
+    atualizaObjetos(jogo);
+    atualizaMapa(jogo);
+}
+
+void atualizaObjetos(tJogo* jogo) {
+    tPacman pacman = jogo->pacman;
+
+    if (pacman.colidiu_com_comida) {
+        pacman.pontos++;
+        comeComida(pacman.x, pacman.y, jogo);
+    } else if (pacman.colidiu_com_portal) {
+        jogo->mapa.trilha[pacman.y][pacman.x] = pacman.mov_atual;
+        pacman = teleportaPacman(pacman, jogo);
+    }
+
+    jogo->pacman = pacman;
+}
+
+void printEstadoJogo(const tJogo* jogo) {
+    fprintEstadoJogo(jogo, stdout);
+
+    registraQuadroSessao(jogo);
+}
+
+void fprintEstadoJogo(const tJogo* jogo, FILE* saidaFile) {
+    fprintf(saidaFile, "Estado do jogo apos o movimento '%c':\n", jogo->pacman.direcao);
+
+    if (jogo->opcoes.janela_linhas > 0) {
+        fprintJanela(jogo, saidaFile);
+    } else {
+        fprintMapa(jogo->mapa, saidaFile);
+    }
+
+    if (jogo->opcoes.minimapa > 0) {
+        fprintMinimapa(jogo, saidaFile);
+    }
+
+    fprintf(saidaFile, "Pontuacao: %d\n\n", jogo->pacman.pontos);
+}
+
+int resultadoJogo(const tJogo* jogo) {
+    int venceu = 0;
+
+    if (jogo->comidas_restantes == 0) venceu = 1;
+    if (jogo->pacman.movs_restantes == 0) venceu = -1;
+    if (jogo->pacman.colidiu_com_fantasma) venceu = -1;
+    if (jogo->impossivel) venceu = -1;
+
+    return venceu;
+}
+
+int verificaFimDeJogo(const tJogo* jogo) {
+    int venceu = resultadoJogo(jogo);
+    tPacman pacman = jogo->pacman;
+
+    if (venceu != 0) registraFimSessao(venceu, pacman.pontos);
+
+    if (venceu == 1) {
+        printf("Voce venceu!\n");
+        printf("Pontuacao final: %d\n", pacman.pontos);
+    } else if (venceu == -1) {
+        printf("Game over!\n");
+        printf("Pontuacao final: %d\n", pacman.pontos);
+    }
+
+    return venceu;
+}
+
+int verificaTrocaDePosicao(tPacman pacman, const tFantasmas* fantasmas) {
+    int i;
+    int dx, dy;
+
+    deltaDirecao(pacman.direcao, &dx, &dy);
+
+    // Houve troca se um fantasma esta na posicao do Pacman andando na direcao oposta
+    for (i = 0; i < fantasmas->qtd; i++) {
+        if (temPacmanNaPosicao(fantasmas->x[i], fantasmas->y[i], pacman)) {
+            if ((dx != 0 || dy != 0) && fantasmas->dx[i] == -dx && fantasmas->dy[i] == -dy) {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+////////////////////////////////// FUNCOES DE ALCANCE ////////////////////////////////
+void calculaDistancias(const tMapa* mapa, const tPortal portais[QTD_PORTAIS], int x, int y, int distancias[MAX_LINHAS][MAX_COLUNAS]) {
+    static _Thread_local int fila[MAX_LINHAS * MAX_COLUNAS][2];
+    int inicio = 0, fim = 0;
+    int i, j;
+
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            distancias[i][j] = -1;
+        }
+    }
+
+    distancias[y][x] = 0;
+    fila[fim][0] = x;
+    fila[fim][1] = y;
+    fim++;
+
+    while (inicio < fim) {
+        int cx = fila[inicio][0];
+        int cy = fila[inicio][1];
+        inicio++;
+
+        // Quem entra em um portal sai no outro com a mesma distancia
+        for (i = 0; i < QTD_PORTAIS; i++) {
+            if (cx == portais[i].x && cy == portais[i].y) {
+                tPortal destino = portais[1 - i];
+
+                if (mapa->mapa[destino.y][destino.x] != '#' && distancias[destino.y][destino.x] < 0) {
+                    distancias[destino.y][destino.x] = distancias[cy][cx];
+                    fila[fim][0] = destino.x;
+                    fila[fim][1] = destino.y;
+                    fim++;
+                }
+            }
+        }
+
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            int nx = cx + (i == D) - (i == A);
+            int ny = cy + (i == S) - (i == W);
+
+            if (nx < 0 || nx >= mapa->colunas || ny < 0 || ny >= mapa->linhas) continue;
+            if (mapa->mapa[ny][nx] == '#' || distancias[ny][nx] >= 0) continue;
+
+            distancias[ny][nx] = distancias[cy][cx] + 1;
+            fila[fim][0] = nx;
+            fila[fim][1] = ny;
+            fim++;
+        }
+    }
+}
+
+void marcaComidasAlcancaveis(tJogo* jogo) {
+    static _Thread_local int distancias[MAX_LINHAS][MAX_COLUNAS];
+    int i;
+
+    calculaDistancias(&jogo->mapa, jogo->portais, jogo->pacman.x, jogo->pacman.y, distancias);
+
+    jogo->comidas_inalcancaveis = 0;
+
+    for (i = 0; i < jogo->qtd_inicial_comidas; i++) {
+        jogo->comidas[i].alcancavel = distancias[jogo->comidas[i].y][jogo->comidas[i].x] >= 0;
+        jogo->comidas_inalcancaveis += !jogo->comidas[i].alcancavel;
+    }
+}
+
+int distanciaEstimada(int x1, int y1, int x2, int y2, const tPortal portais[QTD_PORTAIS]) {
+    int direta = abs(x1 - x2) + abs(y1 - y2);
+    int via_portal_0 = abs(x1 - portais[0].x) + abs(y1 - portais[0].y) + abs(portais[1].x - x2) + abs(portais[1].y - y2);
+    int via_portal_1 = abs(x1 - portais[1].x) + abs(y1 - portais[1].y) + abs(portais[0].x - x2) + abs(portais[0].y - y2);
+
+    int distancia = direta;
+    if (via_portal_0 < distancia) distancia = via_portal_0;
+    if (via_portal_1 < distancia) distancia = via_portal_1;
+
+    return distancia;
+}
+
+int limiteInferiorMovimentos(const tJogo* jogo) {
+    static _Thread_local int distancias[MAX_LINHAS][MAX_COLUNAS];
+    static _Thread_local int restantes[QTD_COMIDAS];
+    static _Thread_local int custo[QTD_COMIDAS];
+    int qtd = 0;
+    int mais_proxima = -1;
+    int i, j;
+
+    calculaDistancias(&jogo->mapa, jogo->portais, jogo->pacman.x, jogo->pacman.y, distancias);
+
+    for (i = 0; i < jogo->qtd_inicial_comidas; i++) {
+        if (jogo->comidas[i].foi_comida) continue;
+
+        int distancia = distancias[jogo->comidas[i].y][jogo->comidas[i].x];
+        if (distancia >= 0 && (mais_proxima < 0 || distancia < mais_proxima)) {
+            mais_proxima = distancia;
+        }
+
+        restantes[qtd] = i;
+        qtd++;
+    }
+
+    if (qtd == 0) return 0;
+    if (mais_proxima < 0) return -1;
+
+    if (qtd > LIMITE_MST_COMIDAS) {
+        return mais_proxima + qtd - 1;
+    }
+
+    // Arvore geradora minima pelo algoritmo de Prim, com a distancia estimada como peso.
+    // Qualquer caminho que passe por todas as comidas custa pelo menos o peso da arvore.
+    int peso = 0;
+
+    for (i = 0; i < qtd; i++) custo[i] = -1;
+    custo[0] = 0;
+
+    for (i = 0; i < qtd; i++) {
+        int escolhida = -1;
+
+        for (j = 0; j < qtd; j++) {
+            if (custo[j] >= 0 && (escolhida < 0 || custo[j] < custo[escolhida])) escolhida = j;
+        }
+
+        peso += custo[escolhida];
+        custo[escolhida] = -2;
+
+        tComida origem = jogo->comidas[restantes[escolhida]];
+        for (j = 0; j < qtd; j++) {
+            if (custo[j] == -2) continue;
+
+            tComida destino = jogo->comidas[restantes[j]];
+            int distancia = distanciaEstimada(origem.x, origem.y, destino.x, destino.y, jogo->portais);
+
+            if (custo[j] < 0 || distancia < custo[j]) custo[j] = distancia;
+        }
+    }
+
+    return mais_proxima + peso;
+}
+
+void verificaJogoImpossivel(tJogo* jogo) {
+    jogo->impossivel = 0;
+
+    if (!jogo->opcoes.encerra_impossivel) return;
+
+    if (jogo->comidas_inalcancaveis > 0) {
+        jogo->impossivel = 1;
+        return;
+    }
+
+    // Se o jogo ja vai acabar neste movimento, nao ha o que antecipar
+    if (jogo->pacman.movs_restantes <= 0 || jogo->pacman.colidiu_com_fantasma || jogo->comidas_restantes == 0) {
+        return;
+    }
+
+    jogo->movs_necessarios = limiteInferiorMovimentos(jogo);
+    jogo->impossivel = jogo->movs_necessarios > jogo->pacman.movs_restantes;
+}
+
+
+//////////////////////////////// FUNCOES DE ESTATISTICAS //////////////////////////////
+void criaPastaSaida(char* dir) {
+    char pasta_saida_dir[MAX_DIR_SIZE + 7];
+    sprintf(pasta_saida_dir, "%s/saida", dir);
+
+    mkdir(pasta_saida_dir, 0777);
+
+    // Os arquivos sao gravados em segundo plano; sem esta verificacao, uma pasta sem
+    // permissao so seria notada no meio da partida
+    if (access(pasta_saida_dir, W_OK | X_OK) != 0) {
+        printf("ERRO: Nao foi possivel gravar na pasta %s\n", pasta_saida_dir);
+        exit(1);
+    }
+}
+
+void geraInicializacaoTxt(const tJogo* jogo) {
+    FILE* inicializacaoFile;
+    char inicializacao_dir[MAX_DIR_SIZE + 26];
+    sprintf(inicializacao_dir, "%s/saida/inicializacao.txt", jogo->dir);
+
+    char* dados;
+    size_t tamanho;
+    inicializacaoFile = open_memstream(&dados, &tamanho);
+
+    fprintMapa(jogo->mapa, inicializacaoFile);
+    fprintf(inicializacaoFile, "Pac-Man comecara o jogo na linha %d e coluna %d\n", jogo->pacman.y + 1, jogo->pacman.x + 1);
+
+    fclose(inicializacaoFile);
+    enviaEscrita(inicializacao_dir, "w", dados, tamanho, "inicializacao.txt", jogo->dir, 1);
+}
+
+void limpaResumo(char* dir) {
+    char resumo_dir[MAX_DIR_SIZE + 19];
+    sprintf(resumo_dir, "%s/saida/resumo.txt", dir);
+
+    enviaEscrita(resumo_dir, "w", NULL, 0, "resumo.txt", dir, 1);
+}
+
+void atualizaResumo(const tJogo* jogo) {
+    FILE* resumoFile;
+    char resumo_nome[40];
+    char resumo_dir[MAX_DIR_SIZE + 48];
+    sprintf(resumo_nome, "resumo%s.txt", jogo->sufixo_saida);
+    sprintf(resumo_dir, "%s/saida/%s", jogo->dir, resumo_nome);
+
+    char* dados;
+    size_t tamanho;
+    resumoFile = open_memstream(&dados, &tamanho);
+    fprintResumo(jogo, resumoFile);
+    fclose(resumoFile);
+
+    // Movimentos sem eventos nao geram pedido de escrita
+    if (tamanho == 0) {
+        free(dados);
+        return;
+    }
+
+    enviaEscrita(resumo_dir, "a", dados, tamanho, resumo_nome, jogo->dir, 1);
+}
+
+void fprintResumo(const tJogo* jogo, FILE* resumoFile) {
+    const tPacman* pacman = &jogo->pacman;
+
+    if (pacman->colidiu_com_comida) {
+        fprintf(resumoFile, "Movimento %d (%c) pegou comida\n", pacman->mov_atual, pacman->direcao);
+    }
+    if (pacman->colidiu_com_fantasma) {
+        fprintf(resumoFile, "Movimento %d (%c) fim de jogo por encostar em um fantasma\n", pacman->mov_atual, pacman->direcao);
+    }
+    if (pacman->colidiu_com_parede && !pacman->colidiu_com_portal) {
+        fprintf(resumoFile, "Movimento %d (%c) colidiu na parede\n", pacman->mov_atual, pacman->direcao);
+    }
+    if (jogo->impossivel && jogo->comidas_inalcancaveis > 0) {
+        fprintf(resumoFile, "Movimento %d fim de jogo por haver %d comida(s) inalcancavel(is)\n", pacman->mov_atual, jogo->comidas_inalcancaveis);
+    } else if (jogo->impossivel) {
+        fprintf(resumoFile, "Movimento %d fim de jogo por faltarem movimentos: restam %d, mas sao necessarios ao menos %d\n", pacman->mov_atual, pacman->movs_restantes, jogo->movs_necessarios);
+    }
+}
+
+void criaEstatisticasMovimentos(tJogo* jogo) {
+    jogo->estatistica_movs[W].direcao = 'w';
+    jogo->estatistica_movs[W].comidas_pegas = 0;
+    jogo->estatistica_movs[W].colisoes_parede = 0;
+    jogo->estatistica_movs[W].colisoes_apenas_parede = 0;
+    jogo->estatistica_movs[W].qtd_realizado = 0;
+
+    jogo->estatistica_movs[S].direcao = 's';
+    jogo->estatistica_movs[S].comidas_pegas = 0;
+    jogo->estatistica_movs[S].colisoes_parede = 0;
+    jogo->estatistica_movs[S].colisoes_apenas_parede = 0;
+    jogo->estatistica_movs[S].qtd_realizado = 0;
+
+    jogo->estatistica_movs[A].direcao = 'a';
+    jogo->estatistica_movs[A].comidas_pegas = 0;
+    jogo->estatistica_movs[A].colisoes_parede = 0;
+    jogo->estatistica_movs[A].colisoes_apenas_parede = 0;
+    jogo->estatistica_movs[A].qtd_realizado = 0;
+
+    jogo->estatistica_movs[D].direcao = 'd';
+    jogo->estatistica_movs[D].comidas_pegas = 0;
+    jogo->estatistica_movs[D].colisoes_parede = 0;
+    jogo->estatistica_movs[D].colisoes_apenas_parede = 0;
+    jogo->estatistica_movs[D].qtd_realizado = 0;
+}
+
+void atualizaEstatisticasMovimentos(tJogo* jogo) {
+    int i;
+    tPacman pacman = jogo->pacman;
+
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        tEstatisticaMovimento movimento = jogo->estatistica_movs[i];
+
+        if (jogo->pacman.direcao == movimento.direcao) {
+            movimento.comidas_pegas += (pacman.colidiu_com_comida);
+            movimento.colisoes_parede += (pacman.colidiu_com_parede);
+            movimento.colisoes_apenas_parede += (pacman.colidiu_com_parede && !pacman.colidiu_com_portal);
+            movimento.qtd_realizado++;
+        }
+
+        jogo->estatistica_movs[i] = movimento;
+    }
+}
+
+int comparaCriteriosRanking(long long comidas1, long long colisoes1, long long realizados1,
+                            long long comidas2, long long colisoes2, long long realizados2) {
+    if (comidas1 != comidas2) return comidas1 > comidas2 ? -1 : 1;  // Primeiro criterio: mais comidas pegas
+    if (colisoes1 != colisoes2) return colisoes1 < colisoes2 ? -1 : 1;  // Segundo criterio: menos colisoes com parede
+    if (realizados1 != realizados2) return realizados1 > realizados2 ? -1 : 1;  // Terceiro criterio: mais movimentos realizados
+
+    return 0;
+}
+
+int comparaMovimentosRanking(const void* a, const void* b) {
+    const tEstatisticaMovimento* movimento1 = a;
+    const tEstatisticaMovimento* movimento2 = b;
+    int criterios = comparaCriteriosRanking(movimento1->comidas_pegas, movimento1->colisoes_apenas_parede, movimento1->qtd_realizado,
+                                            movimento2->comidas_pegas, movimento2->colisoes_apenas_parede, movimento2->qtd_realizado);
+
+    // Quarto criterio: ordem alfabetica
+    return criterios != 0 ? criterios : movimento1->direcao - movimento2->direcao;
+}
+
+void ordenaRanking(void* itens, int qtd, size_t tamanho, int (*compara)(const void*, const void*)) {
+    char* vetor = itens;
+    int i, j;
+    size_t k;
+
+    for (i = 0; i < qtd; i++) {
+        int escolhido = i;
+
+        for (j = i + 1; j < qtd; j++) {
+            if (compara(vetor + j * tamanho, vetor + escolhido * tamanho) < 0) escolhido = j;
+        }
+
+        // Troca byte a byte para servir a entradas de qualquer tamanho
+        for (k = 0; escolhido != i && k < tamanho; k++) {
+            char temp = vetor[escolhido * tamanho + k];
+            vetor[escolhido * tamanho + k] = vetor[i * tamanho + k];
+            vetor[i * tamanho + k] = temp;
+        }
+    }
+}
+
+void geraRankingTxt(const tJogo* jogo) {
+    tEstatisticaMovimento estatistica_movs[QTD_MOVIMENTOS];
+    int i;
+
+    memcpy(estatistica_movs, jogo->estatistica_movs, sizeof(estatistica_movs));
+
+    ordenaRanking(estatistica_movs, QTD_MOVIMENTOS, sizeof(tEstatisticaMovimento), comparaMovimentosRanking);
+
+    FILE* rankingFile;
+    char ranking_nome[40];
+    char ranking_dir[MAX_DIR_SIZE + 48];
+    sprintf(ranking_nome, "ranking%s.txt", jogo->sufixo_saida);
+    sprintf(ranking_dir, "%s/saida/%s", jogo->dir, ranking_nome);
+
+    char* dados;
+    size_t tamanho;
+    rankingFile = open_memstream(&dados, &tamanho);
+
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        tEstatisticaMovimento movimento = estatistica_movs[i];
+
+        fprintf(rankingFile, "%c,%d,%d,%d\n", movimento.direcao, movimento.comidas_pegas, movimento.colisoes_apenas_parede, movimento.qtd_realizado);
+    }
+
+    fclose(rankingFile);
+    enviaEscrita(ranking_dir, "w", dados, tamanho, ranking_nome, jogo->dir, 1);
+}
+
+void geraEstatisticasTxt(const tJogo* jogo) {
+    FILE* estatisticasFile;
+    char estatisticas_nome[40];
+    char estatisticas_dir[MAX_DIR_SIZE + 48];
+    sprintf(estatisticas_nome, "estatisticas%s.txt", jogo->sufixo_saida);
+    sprintf(estatisticas_dir, "%s/saida/%s", jogo->dir, estatisticas_nome);
+
+    char* dados;
+    size_t tamanho;
+    estatisticasFile = open_memstream(&dados, &tamanho);
+
+    int i;
+    int numero_movs = 0;
+    int numero_movs_sem_pontuar = 0;
+    int numero_colisoes_parede = 0;
+    int numero_movs_s = 0;
+    int numero_movs_w = 0;
+    int numero_movs_a = 0;
+    int numero_movs_d = 0;
+
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        tEstatisticaMovimento movimento = jogo->estatistica_movs[i];
+
+        numero_movs += movimento.qtd_realizado;
+        numero_movs_sem_pontuar += movimento.qtd_realizado - movimento.comidas_pegas;
+        numero_colisoes_parede += movimento.colisoes_parede;
+
+        if (movimento.direcao == 's')
+            numero_movs_s += movimento.qtd_realizado;
+        else if (movimento.direcao == 'w')
+            numero_movs_w += movimento.qtd_realizado;
+        else if (movimento.direcao == 'a')
+            numero_movs_a += movimento.qtd_realizado;
+        else if (movimento.direcao == 'd')
+            numero_movs_d += movimento.qtd_realizado;
+    }
+
+    fprintf(estatisticasFile, "Numero de movimentos: %d\n", numero_movs);
+    fprintf(estatisticasFile, "Numero de movimentos sem pontuar: %d\n", numero_movs_sem_pontuar);
+    fprintf(estatisticasFile, "Numero de colisoes com parede: %d\n", numero_colisoes_parede);
+    fprintf(estatisticasFile, "Numero de movimentos para baixo: %d\n", numero_movs_s);
+    fprintf(estatisticasFile, "Numero de movimentos para cima: %d\n", numero_movs_w);
+    fprintf(estatisticasFile, "Numero de movimentos para esquerda: %d\n", numero_movs_a);
+    fprintf(estatisticasFile, "Numero de movimentos para direita: %d\n", numero_movs_d);
+
+    fclose(estatisticasFile);
+    enviaEscrita(estatisticas_dir, "w", dados, tamanho, estatisticas_nome, jogo->dir, 0);
+}
+
+void geraTrilhaTxt(const tJogo* jogo) {
+    char trilha_dir[MAX_DIR_SIZE + 19];
+    sprintf(trilha_dir, "%s/saida/trilha.txt", jogo->dir);
+
+    // Cada celula ocupa no maximo 11 digitos e o separador
+    const tMapa* mapa = &jogo->mapa;
+    char* dados = malloc((size_t)mapa->linhas * (mapa->colunas * 12 + 1));
+    size_t tamanho = 0;
+
+    if (dados == NULL) {
+        printf("ERRO: Memoria insuficiente para gerar o arquivo trilha.txt\n");
+        return;
+    }
+
+    int i;
+    for (i = 0; i < mapa->linhas; i++) {
+        tamanho += formataLinhaTrilha(mapa->trilha[i], mapa->colunas, dados + tamanho);
+    }
+
+    enviaEscrita(trilha_dir, "w", dados, tamanho, "trilha.txt", jogo->dir, 0);
+}
+
+int formataInteiro(int valor, char* destino) {
+    char digitos[10];
+    unsigned int resto = valor < 0 ? 0u - (unsigned int)valor : (unsigned int)valor;
+    int qtd = 0, tamanho = 0;
+
+    do {
+        digitos[qtd++] = '0' + resto % 10;
+        resto /= 10;
+    } while (resto > 0);
+
+    if (valor < 0) destino[tamanho++] = '-';
+    while (qtd > 0) destino[tamanho++] = digitos[--qtd];
+
+    return tamanho;
+}
+
+int formataLinhaTrilha(const int* trilha, int colunas, char* destino) {
+    int j, tamanho = 0;
+
+    for (j = 0; j < colunas; j++) {
+        if (trilha[j] >= 0) {
+            tamanho += formataInteiro(trilha[j], destino + tamanho);
+        } else {
+            destino[tamanho++] = '#';
+        }
+        destino[tamanho++] = ' ';
+    }
+
+    // O separador da ultima coluna vira a quebra de linha
+    destino[tamanho - 1] = '\n';
+
+    return tamanho;
+}
+
+void geraTrilhaBinaria(const tJogo* jogo) {
+    char caminho[MAX_DIR_SIZE + 19];
+    char* dados;
+    size_t tamanho;
+    int i, j;
+
+    const tMapa* mapa = &jogo->mapa;
+    uint32_t cabecalho[4] = { 1, mapa->linhas, mapa->colunas, 0 };
+
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->trilha[i][j] >= 0) cabecalho[3]++;
+        }
+    }
+
+    FILE* trilhaFile = open_memstream(&dados, &tamanho);
+
+    if (trilhaFile == NULL) {
+        printf("ERRO: Memoria insuficiente para gerar o arquivo trilha.bin\n");
+        return;
+    }
+
+    fwrite("PMTB", 1, 4, trilhaFile);
+    fwrite(cabecalho, sizeof(uint32_t), 4, trilhaFile);
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->trilha[i][j] < 0) continue;
+
+            uint32_t par[2] = { (uint32_t)(i * mapa->colunas + j), (uint32_t)mapa->trilha[i][j] };
+            fwrite(par, sizeof(uint32_t), 2, trilhaFile);
+        }
+    }
+
+    fclose(trilhaFile);
+    sprintf(caminho, "%s/saida/trilha.bin", jogo->dir);
+    enviaEscrita(caminho, "w", dados, tamanho, "trilha.bin", (char*)jogo->dir, 0);
+}
+
+int converteTrilha(char* origem, char* destino) {
+    static int trilha[MAX_LINHAS][MAX_COLUNAS];
+    char assinatura[4];
+    uint32_t cabecalho[4];
+    uint32_t par[2];
+    uint32_t k;
+    int i, j;
+
+    FILE* binarioFile = fopen(origem, "rb");
+
+    if (binarioFile == NULL) {
+        printf("ERRO: Nao foi possivel abrir a trilha '%s'\n", origem);
+        return 0;
+    }
+
+    if (fread(assinatura, 1, 4, binarioFile) != 4 || memcmp(assinatura, "PMTB", 4) != 0 ||
+        fread(cabecalho, sizeof(uint32_t), 4, binarioFile) != 4 || cabecalho[0] != 1 ||
+        cabecalho[1] > MAX_LINHAS || cabecalho[2] > MAX_COLUNAS || cabecalho[1] == 0 || cabecalho[2] == 0) {
+        printf("ERRO: A trilha '%s' eh invalida\n", origem);
+        fclose(binarioFile);
+        return 0;
+    }
+
+    int linhas = cabecalho[1];
+    int colunas = cabecalho[2];
+
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            trilha[i][j] = -1;
+        }
+    }
+
+    for (k = 0; k < cabecalho[3]; k++) {
+        if (fread(par, sizeof(uint32_t), 2, binarioFile) != 2 || par[0] >= (uint32_t)(linhas * colunas)) {
+            printf("ERRO: A trilha '%s' esta incompleta\n", origem);
+            fclose(binarioFile);
+            return 0;
+        }
+
+        // Uma distancia que nao cabe em um int nao foi gerada por geraTrilhaBinaria
+        if (par[1] > INT_MAX) {
+            printf("ERRO: A trilha '%s' eh invalida\n", origem);
+            fclose(binarioFile);
+            return 0;
+        }
+
+        trilha[par[0] / colunas][par[0] % colunas] = par[1];
+    }
+
+    fclose(binarioFile);
+
+    FILE* textoFile = fopen(destino, "w");
+
+    if (textoFile == NULL) {
+        printf("ERRO: Nao foi possivel criar o arquivo '%s'\n", destino);
+        return 0;
+    }
+
+    char linha[MAX_COLUNAS * 12];
+    for (i = 0; i < linhas; i++) {
+        fwrite(linha, 1, formataLinhaTrilha(trilha[i], colunas, linha), textoFile);
+    }
+
+    fclose(textoFile);
+    return 1;
+}
+
+
+////////////////////////////////// FUNCOES DO ESCRITOR ///////////////////////////////
+static tEscritor escritor;
+static _Thread_local tFilaEscrita* fila_escrita = NULL;
+
+void iniciaEscritor(void) {
+    int i, falhou;
+
+    atomic_store(&escritor.dormindo, 0);
+    atomic_store(&escritor.encerrar, 0);
+    atomic_store(&escritor.falha_fatal, 0);
+
+    escritor.pedido = eventfd(0, 0);
+    falhou = escritor.pedido < 0;
+
+    for (i = 0; i < QTD_FILAS_ESCRITA; i++) {
+        atomic_store(&escritor.filas[i].inicio, 0);
+        atomic_store(&escritor.filas[i].fim, 0);
+        atomic_store(&escritor.filas[i].esperando, 0);
+        escritor.filas[i].espaco = eventfd(0, 0);
+        falhou |= escritor.filas[i].espaco < 0;
+    }
+
+    if (falhou || pthread_create(&escritor.thread, NULL, executaEscritor, NULL) != 0) {
+        printf("ERRO: Nao foi possivel iniciar a thread de escrita\n");
+        exit(1);
+    }
+
+    escritor.ativo = 1;
+    atexit(encerraEscritor);
+}
+
+void encerraEscritor(void) {
+    int i;
+
+    if (!escritor.ativo) return;
+
+    escritor.ativo = 0;
+
+    atomic_store(&escritor.encerrar, 1);
+    sinalizaEvento(escritor.pedido);
+
+    pthread_join(escritor.thread, NULL);
+
+    close(escritor.pedido);
+    for (i = 0; i < QTD_FILAS_ESCRITA; i++) {
+        close(escritor.filas[i].espaco);
+    }
+
+    // Pode estar sendo chamada pelo 'atexit', onde 'exit' nao pode ser chamado de novo
+    if (atomic_load(&escritor.falha_fatal)) {
+        fflush(stdout);
+        _exit(1);
+    }
+}
+
+void enviaEscrita(const char* caminho, const char* modo, char* dados, size_t tamanho, const char* nome, const char* dir, int fatal) {
+    tFilaEscrita* fila = obtemFilaEscrita();
+    tEscrita* escrita = malloc(sizeof(tEscrita));
+
+    if (escrita == NULL) {
+        printf("ERRO: Memoria insuficiente para gravar '%s'\n", nome);
+        exit(1);
+    }
+
+    strcpy(escrita->caminho, caminho);
+    strcpy(escrita->modo, modo);
+    escrita->dados = dados;
+    escrita->tamanho = tamanho;
+    escrita->fatal = fatal;
+    sprintf(escrita->erro, "ERRO: Nao foi possivel abrir '%s' em %s/saida\n", nome, dir);
+
+    size_t fim = atomic_load_explicit(&fila->fim, memory_order_relaxed);
+
+    // A thread de escrita continua consumindo mesmo depois de uma falha, entao a
+    // espera por espaco sempre termina
+    while (fim - atomic_load_explicit(&fila->inicio, memory_order_acquire) == TAM_FILA_ESCRITA) {
+        atomic_store(&fila->esperando, 1);
+        if (fim - atomic_load(&fila->inicio) == TAM_FILA_ESCRITA) esperaEvento(fila->espaco);
+        atomic_store(&fila->esperando, 0);
+    }
+
+    // A falha eh tratada aqui, na thread do jogo, e nao no meio da thread de escrita
+    if (atomic_load(&escritor.falha_fatal)) {
+        free(escrita->dados);
+        free(escrita);
+        encerraEscritor();
+        exit(1);
+    }
+
+    // As marcas de espera sao conferidas logo depois da publicacao, entao as duas
+    // operacoes precisam da ordem total (seq_cst) para que nenhum lado durma sem aviso
+    fila->itens[fim % TAM_FILA_ESCRITA] = escrita;
+    atomic_store(&fila->fim, fim + 1);
+
+    if (atomic_load(&escritor.dormindo)) sinalizaEvento(escritor.pedido);
+}
+
+void aguardaEscritor(void) {
+    if (!escritor.ativo || fila_escrita == NULL) return;
+
+    tFilaEscrita* fila = fila_escrita;
+    size_t fim = atomic_load_explicit(&fila->fim, memory_order_relaxed);
+
+    while (atomic_load_explicit(&fila->inicio, memory_order_acquire) != fim && !atomic_load(&escritor.falha_fatal)) {
+        atomic_store(&fila->esperando, 1);
+        if (atomic_load(&fila->inicio) != fim) esperaEvento(fila->espaco);
+        atomic_store(&fila->esperando, 0);
+    }
+}
+
+tFilaEscrita* obtemFilaEscrita(void) {
+    if (fila_escrita != NULL) return fila_escrita;
+
+    int indice = atomic_fetch_add(&escritor.qtd_filas, 1);
+
+    if (indice >= QTD_FILAS_ESCRITA) {
+        printf("ERRO: Threads demais gravando arquivos de saida\n");
+        exit(1);
+    }
+
+    fila_escrita = &escritor.filas[indice];
+    return fila_escrita;
+}
+
+void esperaEvento(int evento) {
+    uint64_t valor;
+
+    while (read(evento, &valor, sizeof(valor)) < 0) {
+        // Interrompido por um sinal; volta a esperar
+    }
+}
+
+void sinalizaEvento(int evento) {
+    uint64_t valor = 1;
+
+    while (write(evento, &valor, sizeof(valor)) < 0) {
+        // Interrompido por um sinal; tenta de novo
+    }
+}
+
+void* executaEscritor(void* arg) {
+    (void)arg;
+
+    while (1) {
+        int i, consumidos = 0;
+        int qtd_filas = atomic_load(&escritor.qtd_filas);
+        if (qtd_filas > QTD_FILAS_ESCRITA) qtd_filas = QTD_FILAS_ESCRITA;
+
+        for (i = 0; i < qtd_filas; i++) {
+            tFilaEscrita* fila = &escritor.filas[i];
+            size_t inicio = atomic_load_explicit(&fila->inicio, memory_order_relaxed);
+
+            while (inicio != atomic_load_explicit(&fila->fim, memory_order_acquire)) {
+                realizaEscrita(fila->itens[inicio % TAM_FILA_ESCRITA]);
+                inicio++;
+                atomic_store(&fila->inicio, inicio);
+                consumidos++;
+
+                if (atomic_load(&fila->esperando)) sinalizaEvento(fila->espaco);
+            }
+        }
+
+        if (consumidos > 0) continue;
+
+        // So encerra depois de esvaziar as filas
+        if (atomic_load(&escritor.encerrar)) break;
+
+        // Marca que vai dormir e confere as filas de novo: um pedido enfileirado antes
+        // da marca eh visto aqui, e um enfileirado depois sinaliza o eventfd
+        atomic_store(&escritor.dormindo, 1);
+
+        int vazias = 1;
+        for (i = 0; i < qtd_filas && vazias; i++) {
+            vazias = atomic_load(&escritor.filas[i].inicio) == atomic_load(&escritor.filas[i].fim);
+        }
+        if (vazias && atomic_load(&escritor.qtd_filas) == qtd_filas && !atomic_load(&escritor.encerrar)) {
+            esperaEvento(escritor.pedido);
+        }
+
+        atomic_store(&escritor.dormindo, 0);
+    }
+
+    int i;
+    for (i = 0; i < QTD_ARQUIVOS_ABERTOS; i++) {
+        if (escritor.abertos[i].arquivo != NULL) {
+            fclose(escritor.abertos[i].arquivo);
+            escritor.abertos[i].arquivo = NULL;
+        }
+    }
+
+    return NULL;
+}
+
+FILE* obtemArquivoAberto(const char* caminho, const char* modo) {
+    int i, livre = 0;
+
+    for (i = 0; i < QTD_ARQUIVOS_ABERTOS; i++) {
+        tArquivoAberto* aberto = &escritor.abertos[i];
+
+        if (aberto->arquivo != NULL && strcmp(aberto->caminho, caminho) == 0) {
+            aberto->uso = ++escritor.usos;
+
+            if (modo[0] == 'w') {
+                rewind(aberto->arquivo);
+                if (ftruncate(fileno(aberto->arquivo), 0) != 0) return NULL;
+            }
+            return aberto->arquivo;
+        }
+
+        // Prefere um espaco vazio; senao, o usado ha mais tempo
+        if (escritor.abertos[livre].arquivo != NULL &&
+            (aberto->arquivo == NULL || aberto->uso < escritor.abertos[livre].uso)) {
+            livre = i;
+        }
+    }
+
+    FILE* arquivo = fopen(caminho, modo);
+    if (arquivo == NULL) return NULL;
+
+    tArquivoAberto* aberto = &escritor.abertos[livre];
+    if (aberto->arquivo != NULL) fclose(aberto->arquivo);
+
+    strcpy(aberto->caminho, caminho);
+    aberto->arquivo = arquivo;
+    aberto->uso = ++escritor.usos;
+
+    return arquivo;
+}
+
+void realizaEscrita(tEscrita* escrita) {
+    FILE* arquivo = obtemArquivoAberto(escrita->caminho, escrita->modo);
+
+    if (arquivo == NULL) {
+        printf("%s", escrita->erro);
+        fflush(stdout);
+
+        if (escrita->fatal) {
+            atomic_store(&escritor.falha_fatal, 1);
+        }
+    } else {
+        if (escrita->tamanho > 0) {
+            fwrite(escrita->dados, 1, escrita->tamanho, arquivo);
+        }
+        fflush(arquivo);
+    }
+
+    free(escrita->dados);
+    free(escrita);
+}
+
+
+////////////////////////////////// FUNCOES DO MAPA EMBUTIDO //////////////////////////
+void geraMapaEmbutido(char* dir, char* arquivo) {
+    tJogo jogo = carregaJogo(dir);
+
+    FILE* cabecalhoFile = fopen(arquivo, "w");
+
+    if (cabecalhoFile == NULL) {
+        printf("ERRO: Nao foi possivel criar '%s'\n", arquivo);
+        exit(1);
+    }
+
+    int i, j;
+    int linhas = jogo.mapa.linhas;
+    int colunas = jogo.mapa.colunas;
+    int bytes_linha = (colunas + 7) / 8;
+    int qtd_portais = 0;
+
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            qtd_portais += (jogo.mapa.mapa[i][j] == '@');
+        }
+    }
+    if (qtd_portais > QTD_PORTAIS) qtd_portais = QTD_PORTAIS;
+
+    fprintf(cabecalhoFile, "/* Gerado por --gera-mapa-embutido a partir de '%s/mapa.txt'. Nao editar. */\n\n", dir);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_LINHAS %d\n", linhas);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_COLUNAS %d\n", colunas);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_LIM_MOVS %d\n", jogo.mapa.lim_movs);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_QTD_FANTASMAS %d\n", jogo.fantasmas.qtd);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_QTD_COMIDAS %d\n", jogo.qtd_inicial_comidas);
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_QTD_PORTAIS %d\n\n", qtd_portais);
+
+    // Bitmaps: bit (j % 8) do byte (j / 8) de cada linha
+    const char* camadas[2] = { "paredes", "comidas" };
+    const char simbolos[2] = { '#', '*' };
+    int c;
+
+    for (c = 0; c < 2; c++) {
+        fprintf(cabecalhoFile, "static const unsigned char mapa_embutido_%s[%d][%d] = {\n", camadas[c], linhas, bytes_linha);
+        for (i = 0; i < linhas; i++) {
+            fprintf(cabecalhoFile, "    {");
+            for (j = 0; j < bytes_linha; j++) {
+                int k, byte = 0;
+
+                for (k = 0; k < 8 && j * 8 + k < colunas; k++) {
+                    byte |= (jogo.mapa.mapa[i][j * 8 + k] == simbolos[c]) << k;
+                }
+                fprintf(cabecalhoFile, "%s0x%02x", j ? ", " : " ", byte);
+            }
+            fprintf(cabecalhoFile, " },\n");
+        }
+        fprintf(cabecalhoFile, "};\n\n");
+    }
+
+    fprintf(cabecalhoFile, "static const int mapa_embutido_pacman[2] = { %d, %d };\n\n", jogo.pacman.x, jogo.pacman.y);
+
+    fprintf(cabecalhoFile, "static const int mapa_embutido_portais[%d][2] = {\n", QTD_PORTAIS);
+    for (i = 0; i < QTD_PORTAIS; i++) {
+        fprintf(cabecalhoFile, "    { %d, %d },\n", jogo.portais[i].x, jogo.portais[i].y);
+    }
+    fprintf(cabecalhoFile, "};\n\n");
+
+    fprintf(cabecalhoFile, "static const int mapa_embutido_posicoes_comidas[%d][2] = {\n", jogo.qtd_inicial_comidas > 0 ? jogo.qtd_inicial_comidas : 1);
+    for (i = 0; i < jogo.qtd_inicial_comidas; i++) {
+        fprintf(cabecalhoFile, "    { %d, %d },\n", jogo.comidas[i].x, jogo.comidas[i].y);
+    }
+    if (jogo.qtd_inicial_comidas == 0) fprintf(cabecalhoFile, "    { 0, 0 },\n");
+    fprintf(cabecalhoFile, "};\n\n");
+
+    // Os ciclos de todos os fantasmas ficam em um unico vetor; cada fantasma guarda o
+    // inicio da sua sequencia, o tamanho da cauda e o periodo. Cada ciclo eh calculado
+    // uma vez: a linha do fantasma vai direto para o cabecalho e os estados se acumulam
+    // em memoria ate o tamanho do vetor ser conhecido
+    static int estados[4 * (MAX_LINHAS + 2) * (MAX_COLUNAS + 2)][4];
+    int ciclos_fixos = 1;
+    int inicio = 0;
+
+    char* ciclos;
+    size_t tamanho_ciclos;
+    FILE* ciclosFile = open_memstream(&ciclos, &tamanho_ciclos);
+
+    if (ciclosFile == NULL) {
+        printf("ERRO: Memoria insuficiente para gerar '%s'\n", arquivo);
+        exit(1);
+    }
+
+    fprintf(cabecalhoFile, "/* x, y, dx, dy, tipo, inicio do ciclo, cauda, periodo */\n");
+    fprintf(cabecalhoFile, "static const int mapa_embutido_fantasmas[%d][8] = {\n", jogo.fantasmas.qtd > 0 ? jogo.fantasmas.qtd : 1);
+    for (i = 0; i < jogo.fantasmas.qtd; i++) {
+        int cauda;
+        int qtd_estados = calculaCicloFantasma(&jogo, i, estados, &cauda);
+
+        fprintf(cabecalhoFile, "    { %d, %d, %d, %d, '%c', %d, %d, %d },\n", jogo.fantasmas.x[i], jogo.fantasmas.y[i],
+                jogo.fantasmas.dx[i], jogo.fantasmas.dy[i], jogo.fantasmas.tipo[i], inicio, cauda, qtd_estados - cauda);
+        inicio += qtd_estados;
+
+        for (j = 0; j < qtd_estados; j++) {
+            fprintf(ciclosFile, "    { %d, %d, %d, %d },\n", estados[j][0], estados[j][1], estados[j][2], estados[j][3]);
+
+            // Um portal pode deixar de bloquear quando o Pacman esta sobre ele, entao
+            // ciclos que esbarram em portais nao podem ser usados diretamente
+            int prox_x = estados[j][0] + estados[j][2];
+            int prox_y = estados[j][1] + estados[j][3];
+            if (qtd_portais > 0 && temPortalNaPosicao(prox_x, prox_y, jogo.portais)) {
+                ciclos_fixos = 0;
+            }
+        }
+    }
+    if (jogo.fantasmas.qtd == 0) fprintf(cabecalhoFile, "    { 0 },\n");
+    fprintf(cabecalhoFile, "};\n\n");
+
+    fclose(ciclosFile);
+    fprintf(cabecalhoFile, "static const int mapa_embutido_ciclos[%d][4] = {\n", inicio > 0 ? inicio : 1);
+    fwrite(ciclos, 1, tamanho_ciclos, cabecalhoFile);
+    free(ciclos);
+    if (inicio == 0) fprintf(cabecalhoFile, "    { 0 },\n");
+    fprintf(cabecalhoFile, "};\n\n");
+
+    fprintf(cabecalhoFile, "#define MAPA_EMBUTIDO_CICLOS_FIXOS %d\n", ciclos_fixos);
+
+    fclose(cabecalhoFile);
+}
+
+int calculaCicloFantasma(const tJogo* jogo, int idx, int estados[][4], int* cauda) {
+    static int visitado[MAX_LINHAS + 2][MAX_COLUNAS + 2][QTD_MOVIMENTOS];
+    static int visitado_limpo = 0;
+    int x = jogo->fantasmas.x[idx];
+    int y = jogo->fantasmas.y[idx];
+    int dx = jogo->fantasmas.dx[idx];
+    int dy = jogo->fantasmas.dy[idx];
+    int qtd = 0;
+
+    // A tabela so eh limpa por inteiro uma vez; depois, cada chamada desfaz apenas as
+    // marcas dos estados que percorreu
+    if (!visitado_limpo) {
+        memset(visitado, -1, sizeof(visitado));
+        visitado_limpo = 1;
+    }
+
+    while (1) {
+        // W, A, S e D como indice da direcao atual
+        int direcao = dy < 0 ? W : dx < 0 ? A : dy > 0 ? S : D;
+
+        if (visitado[y + 1][x + 1][direcao] >= 0) {
+            int i;
+
+            *cauda = visitado[y + 1][x + 1][direcao];
+
+            for (i = 0; i < qtd; i++) {
+                int d = estados[i][3] < 0 ? W : estados[i][2] < 0 ? A : estados[i][3] > 0 ? S : D;
+                visitado[estados[i][1] + 1][estados[i][0] + 1][d] = -1;
+            }
+            return qtd;
+        }
+
+        visitado[y + 1][x + 1][direcao] = qtd;
+        estados[qtd][0] = x;
+        estados[qtd][1] = y;
+        estados[qtd][2] = dx;
+        estados[qtd][3] = dy;
+        qtd++;
+
+        passoFantasmas(jogo->fantasmas.classe, 1, &x, &y, &dx, &dy, jogo->fantasmas.bloqueio);
+    }
+}
+
+#ifdef MAPA_EMBUTIDO
+void carregaMapaEmbutido(tJogo* jogo) {
+    int i, j;
+
+    jogo->mapa.linhas = MAPA_EMBUTIDO_LINHAS;
+    jogo->mapa.colunas = MAPA_EMBUTIDO_COLUNAS;
+    jogo->mapa.lim_movs = MAPA_EMBUTIDO_LIM_MOVS;
+
+    preparaBloqueio(&jogo->fantasmas, MAPA_EMBUTIDO_LINHAS, MAPA_EMBUTIDO_COLUNAS);
+
+    for (i = 0; i < MAPA_EMBUTIDO_LINHAS; i++) {
+        for (j = 0; j < MAPA_EMBUTIDO_COLUNAS; j++) {
+            int parede = (mapa_embutido_paredes[i][j / 8] >> (j % 8)) & 1;
+            int comida = (mapa_embutido_comidas[i][j / 8] >> (j % 8)) & 1;
+
+            jogo->mapa.mapa[i][j] = parede ? '#' : comida ? '*' : ' ';
+            BLOQUEIO(&jogo->fantasmas, j, i) = parede;
+        }
+    }
+
+    for (i = 0; i < MAPA_EMBUTIDO_QTD_PORTAIS; i++) {
+        jogo->portais[i].x = mapa_embutido_portais[i][0];
+        jogo->portais[i].y = mapa_embutido_portais[i][1];
+        jogo->mapa.mapa[jogo->portais[i].y][jogo->portais[i].x] = '@';
+        BLOQUEIO(&jogo->fantasmas, jogo->portais[i].x, jogo->portais[i].y) = 1;
+    }
+
+    for (i = 0; i < MAPA_EMBUTIDO_QTD_COMIDAS; i++) {
+        jogo->comidas[i].x = mapa_embutido_posicoes_comidas[i][0];
+        jogo->comidas[i].y = mapa_embutido_posicoes_comidas[i][1];
+        jogo->comidas[i].foi_comida = 0;
+    }
+    jogo->qtd_inicial_comidas = MAPA_EMBUTIDO_QTD_COMIDAS;
+    jogo->comidas_restantes = MAPA_EMBUTIDO_QTD_COMIDAS;
+
+    for (i = 0; i < MAPA_EMBUTIDO_QTD_FANTASMAS; i++) {
+        jogo->fantasmas.x[i] = mapa_embutido_fantasmas[i][0];
+        jogo->fantasmas.y[i] = mapa_embutido_fantasmas[i][1];
+        jogo->fantasmas.dx[i] = mapa_embutido_fantasmas[i][2];
+        jogo->fantasmas.dy[i] = mapa_embutido_fantasmas[i][3];
+        jogo->fantasmas.tipo[i] = mapa_embutido_fantasmas[i][4];
+        jogo->mapa.mapa[jogo->fantasmas.y[i]][jogo->fantasmas.x[i]] = jogo->fantasmas.tipo[i];
+    }
+    jogo->fantasmas.qtd = MAPA_EMBUTIDO_QTD_FANTASMAS;
+
+    jogo->pacman.x = mapa_embutido_pacman[0];
+    jogo->pacman.y = mapa_embutido_pacman[1];
+    jogo->pacman.movs_restantes = MAPA_EMBUTIDO_LIM_MOVS;
+    jogo->mapa.mapa[jogo->pacman.y][jogo->pacman.x] = '>';
+}
+
+void posicionaFantasmasPeloCiclo(tJogo* jogo) {
+    int i;
+    int movimento = jogo->pacman.mov_atual + 1;
+
+    for (i = 0; i < jogo->fantasmas.qtd; i++) {
+        int inicio = mapa_embutido_fantasmas[i][5];
+        int cauda = mapa_embutido_fantasmas[i][6];
+        int periodo = mapa_embutido_fantasmas[i][7];
+        int estado = movimento < cauda ? movimento : cauda + (movimento - cauda) % periodo;
+
+        jogo->fantasmas.x[i] = mapa_embutido_ciclos[inicio + estado][0];
+        jogo->fantasmas.y[i] = mapa_embutido_ciclos[inicio + estado][1];
+        jogo->fantasmas.dx[i] = mapa_embutido_ciclos[inicio + estado][2];
+        jogo->fantasmas.dy[i] = mapa_embutido_ciclos[inicio + estado][3];
+    }
+}
+#endif
+
+
+////////////////////////////////// FUNCOES DO CATALOGO ///////////////////////////////
+static tAcervo acervo;
+
+int validaAcervo(char* raiz, char* catalogo, int qtd_threads) {
+    int i;
+
+    if (nftw(raiz, registraMapaDoAcervo, 32, FTW_PHYS) != 0) {
+        printf("ERRO: Nao foi possivel percorrer o diretorio %s\n", raiz);
+        exit(1);
+    }
+
+    if (qtd_threads < 1) qtd_threads = 1;
+    if (qtd_threads > acervo.qtd) qtd_threads = acervo.qtd > 0 ? acervo.qtd : 1;
+
+    pthread_t* threads = malloc(qtd_threads * sizeof(pthread_t));
+    atomic_init(&acervo.proximo, 0);
+
+    if (threads == NULL) {
+        printf("ERRO: Memoria insuficiente para validar o acervo\n");
+        exit(1);
+    }
+
+    for (i = 0; i < qtd_threads; i++) {
+        if (pthread_create(&threads[i], NULL, executaValidacao, &acervo) != 0) {
+            printf("ERRO: Nao foi possivel iniciar as threads de validacao\n");
+            exit(1);
+        }
+    }
+    for (i = 0; i < qtd_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    // O catalogo eh ordenado pelo diretorio, para que os indices sejam estaveis
+    int j;
+    for (i = 1; i < acervo.qtd; i++) {
+        tItemCatalogo item = acervo.itens[i];
+
+        for (j = i - 1; j >= 0 && strcmp(acervo.itens[j].dir, item.dir) > 0; j--) {
+            acervo.itens[j + 1] = acervo.itens[j];
+        }
+        acervo.itens[j + 1] = item;
+    }
+
+    FILE* catalogoFile = fopen(catalogo, "w");
+
+    if (catalogoFile == NULL) {
+        printf("ERRO: Nao foi possivel criar o catalogo '%s'\n", catalogo);
+        exit(1);
+    }
+
+    int invalidos = 0;
+
+    fprintf(catalogoFile, "# indice hash linhas colunas lim_movs comidas status diretorio\n");
+    for (i = 0; i < acervo.qtd; i++) {
+        tItemCatalogo item = acervo.itens[i];
+
+        fprintf(catalogoFile, "%d %016llx %d %d %d %d %s %s\n", i, item.hash, item.linhas, item.colunas, item.lim_movs, item.comidas,
+                item.status[0] ? "invalido" : "ok", item.dir);
+
+        if (item.status[0]) {
+            printf("Mapa %d (%s): %s\n", i, item.dir, item.status);
+            invalidos++;
+        }
+    }
+
+    fclose(catalogoFile);
+
+    printf("%d mapas catalogados, %d invalidos\n", acervo.qtd, invalidos);
+
+    free(acervo.itens);
+
+    return invalidos;
+}
+
+int registraMapaDoAcervo(const char* caminho, const struct stat* info, int tipo, struct FTW* ftw) {
+    (void)info;
+
+    if (tipo != FTW_F || strcmp(caminho + ftw->base, "mapa.txt") != 0) return 0;
+    if (ftw->base - 1 >= MAX_DIR_SIZE) return 0;
+
+    if (acervo.qtd == acervo.capacidade) {
+        acervo.capacidade = acervo.capacidade ? 2 * acervo.capacidade : 64;
+        acervo.itens = realloc(acervo.itens, acervo.capacidade * sizeof(tItemCatalogo));
+
+        if (acervo.itens == NULL) {
+            printf("ERRO: Memoria insuficiente para o catalogo\n");
+            exit(1);
+        }
+    }
+
+    tItemCatalogo* item = &acervo.itens[acervo.qtd];
+    memset(item, 0, sizeof(tItemCatalogo));
+
+    // O diretorio eh o caminho sem o '/mapa.txt' do final
+    strncpy(item->dir, caminho, ftw->base - 1);
+    item->dir[ftw->base - 1] = '\0';
+    acervo.qtd++;
+
+    return 0;
+}
+
+void* executaValidacao(void* arg) {
+    tAcervo* dados = arg;
+
+    while (1) {
+        int idx = atomic_fetch_add(&dados->proximo, 1);
+        if (idx >= dados->qtd) break;
+
+        validaMapa(&dados->itens[idx]);
+    }
+
+    return NULL;
+}
+
+void validaMapa(tItemCatalogo* item) {
+    static _Thread_local tJogo jogo;
+    char erro[MAX_DIR_SIZE + 64];
+    int i, j;
+
+    memset(&jogo, 0, sizeof(tJogo));
+    item->hash = hashMapa(item->dir);
+
+    if (!leMapa(item->dir, &jogo.mapa, erro)) {
+        strcpy(item->status, erro);
+        return;
+    }
+
+    item->linhas = jogo.mapa.linhas;
+    item->colunas = jogo.mapa.colunas;
+    item->lim_movs = jogo.mapa.lim_movs;
+
+    int qtd_pacman = 0, qtd_portais = 0;
+
+    for (i = 0; i < jogo.mapa.linhas; i++) {
+        for (j = 0; j < jogo.mapa.colunas; j++) {
+            char celula = jogo.mapa.mapa[i][j];
+            int borda = (i == 0 || j == 0 || i == jogo.mapa.linhas - 1 || j == jogo.mapa.colunas - 1);
+
+            if (!strchr("# *>@BPIC", celula)) {
+                sprintf(item->status, "caractere '%c' invalido na linha %d, coluna %d", celula, i + 1, j + 1);
+                return;
+            }
+            if (borda && celula != '#') {
+                sprintf(item->status, "borda aberta na linha %d, coluna %d", i + 1, j + 1);
+                return;
+            }
+
+            item->comidas += (celula == '*');
+            qtd_pacman += (celula == '>');
+            qtd_portais += (celula == '@');
+        }
+    }
+
+    if (qtd_pacman != 1) {
+        sprintf(item->status, "%d Pacmans no mapa, em vez de 1", qtd_pacman);
+        return;
+    }
+    if (qtd_portais != 0 && qtd_portais != QTD_PORTAIS) {
+        sprintf(item->status, "%d portais no mapa, em vez de 0 ou %d", qtd_portais, QTD_PORTAIS);
+        return;
+    }
+
+    jogo.pacman = criaPacman(&jogo);
+    criaComidas(&jogo);
+    criaPortais(&jogo);
+    marcaComidasAlcancaveis(&jogo);
+
+    if (jogo.comidas_inalcancaveis > 0) {
+        sprintf(item->status, "%d comida(s) inalcancavel(is)", jogo.comidas_inalcancaveis);
+    }
+}
+
+unsigned long long hashMapa(char* dir) {
+    char mapa_dir[MAX_DIR_SIZE + 9];
+    sprintf(mapa_dir, "%s/mapa.txt", dir);
+
+    FILE* mapaFile = fopen(mapa_dir, "rb");
+    if (mapaFile == NULL) return 0;
+
+    unsigned long long hash = 14695981039346656037ULL;
+    unsigned char bloco[4096];
+    size_t lidos, i;
+
+    while ((lidos = fread(bloco, 1, sizeof(bloco), mapaFile)) > 0) {
+        for (i = 0; i < lidos; i++) {
+            hash = (hash ^ bloco[i]) * 1099511628211ULL;
+        }
+    }
+
+    fclose(mapaFile);
+
+    return hash;
+}
+
+int buscaNoCatalogo(char* catalogo, int indice, char* dir) {
+    FILE* catalogoFile = fopen(catalogo, "r");
+    if (catalogoFile == NULL) return 0;
+
+    char linha[2 * MAX_DIR_SIZE];
+    int encontrado = 0;
+
+    while (fgets(linha, sizeof(linha), catalogoFile)) {
+        int idx, campos = 0;
+        unsigned long long hash;
+        char status[16];
+
+        if (linha[0] == '#') continue;
+        if (sscanf(linha, "%d %llx %*d %*d %*d %*d %15s %n", &idx, &hash, status, &campos) < 3 || idx != indice) continue;
+
+        linha[strcspn(linha, "\n")] = '\0';
+        if (strcmp(status, "ok") == 0 && strlen(linha + campos) < MAX_DIR_SIZE) {
+            strcpy(dir, linha + campos);
+            // Um mapa editado depois da validacao pode nao ser mais valido
+            encontrado = hashMapa(dir) == hash ? 1 : -1;
+        }
+        break;
+    }
+
+    fclose(catalogoFile);
+
+    return encontrado;
+}
+
+
+////////////////////////////////// FUNCOES DA CAMPANHA ///////////////////////////////
+int jogaCampanha(char* lista, tOpcoes opcoes) {
+    static tCampanha campanha;
+
+    campanha.qtd_niveis = leLista(lista, &campanha.dirs, "niveis");
+
+    campanha.cache = malloc(TAM_CACHE_NIVEIS * sizeof(tNivelPreparado));
+
+    if (campanha.cache == NULL) {
+        printf("ERRO: Memoria insuficiente para o cache de niveis\n");
+        exit(1);
+    }
+
+    pthread_mutex_init(&campanha.trava, NULL);
+    pthread_cond_init(&campanha.mudou, NULL);
+
+    if (pthread_create(&campanha.thread, NULL, preparaNiveis, &campanha) != 0) {
+        printf("ERRO: Nao foi possivel iniciar a thread de preparacao dos niveis\n");
+        exit(1);
+    }
+
+    int nivel = 0;
+    int vidas = VIDAS_CAMPANHA;
+    int pontos = 0;
+    int invalido = 0;
+
+    while (nivel < campanha.qtd_niveis && vidas > 0) {
+        char* dir = campanha.dirs[nivel];
+
+        printf("Nivel %d de %d (%s), vidas: %d\n\n", nivel + 1, campanha.qtd_niveis, dir, vidas);
+
+        criaPastaSaida(dir);
+        limpaResumo(dir);
+
+        tJogo jogo;
+        if (!obtemNivel(&campanha, nivel, &jogo)) {
+            invalido = 1;
+            break;
+        }
+        jogo.opcoes = opcoes;
+        jogo.pacman.pontos = pontos;
+
+        jogo = jogaPartida(jogo);
+
+        // Vencendo, a pontuacao eh acumulada; perdendo, o nivel eh repetido do cache. A
+        // ultima comida no ultimo movimento conta como derrota, como na tela
+        if (resultadoJogo(&jogo) == 1) {
+            pontos = jogo.pacman.pontos;
+            nivel++;
+        } else {
+            vidas--;
+        }
+    }
+
+    pthread_mutex_lock(&campanha.trava);
+    campanha.encerrar = 1;
+    pthread_cond_broadcast(&campanha.mudou);
+    pthread_mutex_unlock(&campanha.trava);
+    pthread_join(campanha.thread, NULL);
+
+    free(campanha.cache);
+    free(campanha.dirs);
+
+    if (invalido) return 1;
+
+    if (nivel == campanha.qtd_niveis) {
+        printf("Campanha concluida! Pontuacao total: %d\n", pontos);
+        return 0;
+    }
+
+    printf("Fim da campanha no nivel %d. Pontuacao total: %d\n", nivel + 1, pontos);
+    return 1;
+}
+
+void* preparaNiveis(void* arg) {
+    tCampanha* campanha = arg;
+    tJogo* jogo = malloc(sizeof(tJogo));
+
+    if (jogo == NULL) {
+        printf("ERRO: Memoria insuficiente para preparar os niveis\n");
+        exit(1);
+    }
+
+    pthread_mutex_lock(&campanha->trava);
+
+    while (!campanha->encerrar) {
+        int nivel, proximo = -1;
+
+        // O nivel atual tem prioridade, depois os seguintes, em ordem
+        for (nivel = campanha->nivel_atual; nivel <= campanha->nivel_atual + NIVEIS_ANTECIPADOS && nivel < campanha->qtd_niveis; nivel++) {
+            if (buscaNivelNoCache(campanha, nivel) == NULL) {
+                proximo = nivel;
+                break;
+            }
+        }
+
+        if (proximo < 0) {
+            pthread_cond_wait(&campanha->mudou, &campanha->trava);
+            continue;
+        }
+
+        // Um mapa invalido nao pode encerrar o programa enquanto outro nivel eh jogado
+        char erro[MAX_DIR_SIZE + 64];
+
+        pthread_mutex_unlock(&campanha->trava);
+        int valido = leJogo(campanha->dirs[proximo], jogo, erro);
+        pthread_mutex_lock(&campanha->trava);
+
+        // Com o cache cheio, o nivel usado ha mais tempo da lugar ao novo
+        int slot = campanha->qtd_cache;
+        if (slot == TAM_CACHE_NIVEIS) {
+            int i;
+
+            slot = 0;
+            for (i = 1; i < TAM_CACHE_NIVEIS; i++) {
+                if (campanha->cache[i].uso < campanha->cache[slot].uso) slot = i;
+            }
+        } else {
+            campanha->qtd_cache++;
+        }
+
+        campanha->cache[slot].nivel = proximo;
+        campanha->cache[slot].uso = ++campanha->relogio;
+        campanha->cache[slot].valido = valido;
+        if (valido) {
+            campanha->cache[slot].jogo = *jogo;
+        } else {
+            strcpy(campanha->cache[slot].erro, erro);
+        }
+
+        pthread_cond_broadcast(&campanha->mudou);
+    }
+
+    pthread_mutex_unlock(&campanha->trava);
+    free(jogo);
+
+    return NULL;
+}
+
+tNivelPreparado* buscaNivelNoCache(tCampanha* campanha, int nivel) {
+    int i;
+
+    for (i = 0; i < campanha->qtd_cache; i++) {
+        if (campanha->cache[i].nivel == nivel) {
+            return &campanha->cache[i];
+        }
+    }
+
+    return NULL;
+}
+
+int obtemNivel(tCampanha* campanha, int nivel, tJogo* jogo) {
+    tNivelPreparado* preparado;
+
+    pthread_mutex_lock(&campanha->trava);
+
+    campanha->nivel_atual = nivel;
+    pthread_cond_broadcast(&campanha->mudou);
+
+    while ((preparado = buscaNivelNoCache(campanha, nivel)) == NULL) {
+        pthread_cond_wait(&campanha->mudou, &campanha->trava);
+    }
+
+    preparado->uso = ++campanha->relogio;
+
+    int valido = preparado->valido;
+    if (valido) {
+        *jogo = preparado->jogo;
+    } else {
+        printf("ERRO: %s\n", preparado->erro);
+    }
+
+    pthread_mutex_unlock(&campanha->trava);
+
+    return valido;
+}
+
+
+///////////////////////////////// FUNCOES DO MAPA DE CALOR ////////////////////////////
+tMapaDeCalor* carregaMapaDeCalor(char* dir, int linhas, int colunas) {
+    tMapaDeCalor* calor = malloc(sizeof(tMapaDeCalor));
+
+    if (calor == NULL) {
+        printf("ERRO: Memoria insuficiente para o mapa de calor\n");
+        exit(1);
+    }
+
+    int i, j;
+
+    calor->linhas = linhas;
+    calor->colunas = colunas;
+    atomic_init(&calor->partidas, 0);
+    for (i = 0; i < MAX_LINHAS; i++) {
+        for (j = 0; j < MAX_COLUNAS; j++) {
+            atomic_init(&calor->visitas[i][j], 0);
+            atomic_init(&calor->mortes[i][j], 0);
+        }
+    }
+
+    char calor_dir[MAX_DIR_SIZE + 18];
+    sprintf(calor_dir, "%s/saida/calor.bin", dir);
+
+    // A partida anterior no mesmo mapa pode ter deixado o arquivo na fila de escrita
+    aguardaEscritor();
+
+    FILE* calorFile = fopen(calor_dir, "rb");
+    if (calorFile == NULL) return calor;
+
+    // Cabecalho: "PMCL", versao, linhas, colunas e partidas; depois as passagens e as
+    // mortes de cada celula, linha a linha, como inteiros de 32 bits
+    char assinatura[4];
+    uint32_t cabecalho[3];
+    uint64_t partidas;
+
+    if (fread(assinatura, 1, 4, calorFile) != 4 || memcmp(assinatura, "PMCL", 4) != 0 ||
+        fread(cabecalho, sizeof(uint32_t), 3, calorFile) != 3 || cabecalho[0] != 1 ||
+        (int)cabecalho[1] != linhas || (int)cabecalho[2] != colunas ||
+        fread(&partidas, sizeof(uint64_t), 1, calorFile) != 1) {
+        fclose(calorFile);
+        return calor;
+    }
+
+    uint32_t linha[MAX_COLUNAS];
+    int camada, completo = 1;
+
+    for (camada = 0; camada < 2 && completo; camada++) {
+        for (i = 0; i < linhas && completo; i++) {
+            completo = fread(linha, sizeof(uint32_t), colunas, calorFile) == (size_t)colunas;
+
+            for (j = 0; j < colunas && completo; j++) {
+                atomic_store(camada == 0 ? &calor->visitas[i][j] : &calor->mortes[i][j], linha[j]);
+            }
+        }
+    }
+
+    fclose(calorFile);
+
+    // Arquivo truncado: descarta o que foi lido em vez de misturar camadas
+    if (!completo) {
+        for (i = 0; i < linhas; i++) {
+            for (j = 0; j < colunas; j++) {
+                atomic_store(&calor->visitas[i][j], 0);
+                atomic_store(&calor->mortes[i][j], 0);
+            }
+        }
+        return calor;
+    }
+
+    atomic_store(&calor->partidas, partidas);
+
+    return calor;
+}
+
+void registraNoMapaDeCalor(tMapaDeCalor* calor, const tJogo* jogo) {
+    int x = jogo->pacman.x;
+    int y = jogo->pacman.y;
+
+    if (x < 0 || x >= calor->colunas || y < 0 || y >= calor->linhas) return;
+
+    atomic_fetch_add_explicit(&calor->visitas[y][x], 1, memory_order_relaxed);
+
+    if (jogo->pacman.colidiu_com_fantasma) {
+        atomic_fetch_add_explicit(&calor->mortes[y][x], 1, memory_order_relaxed);
+    }
+}
+
+void salvaMapaDeCalor(tMapaDeCalor* calor, tMapa mapa, char* dir) {
+    int i, j;
+    unsigned int max_visitas = 0, max_mortes = 0;
+
+    for (i = 0; i < calor->linhas; i++) {
+        for (j = 0; j < calor->colunas; j++) {
+            unsigned int visitas = atomic_load(&calor->visitas[i][j]);
+            unsigned int mortes = atomic_load(&calor->mortes[i][j]);
+
+            if (visitas > max_visitas) max_visitas = visitas;
+            if (mortes > max_mortes) max_mortes = mortes;
+        }
+    }
+
+    char* dados;
+    size_t tamanho;
+    char caminho[MAX_DIR_SIZE + 18];
+    FILE* arquivo;
+
+    // Binario com os contadores
+    arquivo = open_memstream(&dados, &tamanho);
+
+    uint32_t cabecalho[3] = { 1, calor->linhas, calor->colunas };
+    uint64_t partidas = atomic_load(&calor->partidas);
+    int camada;
+
+    fwrite("PMCL", 1, 4, arquivo);
+    fwrite(cabecalho, sizeof(uint32_t), 3, arquivo);
+    fwrite(&partidas, sizeof(uint64_t), 1, arquivo);
+    for (camada = 0; camada < 2; camada++) {
+        for (i = 0; i < calor->linhas; i++) {
+            for (j = 0; j < calor->colunas; j++) {
+                uint32_t valor = atomic_load(camada == 0 ? &calor->visitas[i][j] : &calor->mortes[i][j]);
+                fwrite(&valor, sizeof(uint32_t), 1, arquivo);
+            }
+        }
+    }
+
+    fclose(arquivo);
+    sprintf(caminho, "%s/saida/calor.bin", dir);
+    enviaEscrita(caminho, "w", dados, tamanho, "calor.bin", dir, 0);
+
+    // PGM das passagens: quanto mais claro, mais passagens
+    arquivo = open_memstream(&dados, &tamanho);
+
+    fprintf(arquivo, "P5\n%d %d\n255\n", calor->colunas, calor->linhas);
+    for (i = 0; i < calor->linhas; i++) {
+        for (j = 0; j < calor->colunas; j++) {
+            unsigned int visitas = atomic_load(&calor->visitas[i][j]);
+            fputc(max_visitas ? (int)(255ULL * visitas / max_visitas) : 0, arquivo);
+        }
+    }
+
+    fclose(arquivo);
+    sprintf(caminho, "%s/saida/calor.pgm", dir);
+    enviaEscrita(caminho, "w", dados, tamanho, "calor.pgm", dir, 0);
+
+    // PPM com passagens em verde, mortes em vermelho e paredes em azul
+    arquivo = open_memstream(&dados, &tamanho);
+
+    fprintf(arquivo, "P6\n%d %d\n255\n", calor->colunas, calor->linhas);
+    for (i = 0; i < calor->linhas; i++) {
+        for (j = 0; j < calor->colunas; j++) {
+            unsigned int visitas = atomic_load(&calor->visitas[i][j]);
+            unsigned int mortes = atomic_load(&calor->mortes[i][j]);
+
+            fputc(max_mortes ? (int)(255ULL * mortes / max_mortes) : 0, arquivo);
+            fputc(max_visitas ? (int)(255ULL * visitas / max_visitas) : 0, arquivo);
+            fputc(mapa.mapa[i][j] == '#' ? 96 : 0, arquivo);
+        }
+    }
+
+    fclose(arquivo);
+    sprintf(caminho, "%s/saida/calor.ppm", dir);
+    enviaEscrita(caminho, "w", dados, tamanho, "calor.ppm", dir, 0);
+}
+
+
+///////////////////////////////// FUNCOES DO HISTORICO ////////////////////////////////
+// Layout de um registro, em bytes:
+//   0-1   tamanho total do registro
+//   2, 3  direcao antes e depois da jogada
+//   4, 5  colisoes antes e depois (bits: parede, fantasma, comida, portal, troca)
+//   6-9   x e y do Pacman antes e depois
+//   10    quantidade de celulas da trilha sobrescritas
+//   11-12 indice da comida pega, ou 0xFFFF
+//   13-14 quantidade de fantasmas que mudaram de direcao
+//   celulas da trilha: x, y e valor anterior (4 bytes)
+//   fantasmas que mudaram de direcao: indice (2 bytes) e direcao antes * 9 + depois,
+//   com cada direcao codificada como (dx + 1) * 3 + (dy + 1)
+//   tamanho total do registro, repetido
+#define REGISTRO_CABECALHO 15
+#define REGISTRO_SEM_COMIDA 0xFFFF
+
+tHistorico* criaHistorico(void) {
+    tHistorico* historico = calloc(1, sizeof(tHistorico));
+
+    if (historico == NULL || (historico->dados = malloc(TAM_HISTORICO)) == NULL) {
+        printf("ERRO: Memoria insuficiente para o historico de jogadas\n");
+        exit(1);
+    }
+
+    return historico;
+}
+
+void preparaRegistroHistorico(tHistorico* historico, const tJogo* jogo) {
+    int i, j;
+    int x = jogo->pacman.x;
+    int y = jogo->pacman.y;
+    int celulas[CELULAS_TRILHA_CANDIDATAS][2] = {
+        { x, y }, { x, y - 1 }, { x - 1, y }, { x, y + 1 }, { x + 1, y },
+        { jogo->portais[0].x, jogo->portais[0].y }, { jogo->portais[1].x, jogo->portais[1].y }
+    };
+
+    historico->pacman = jogo->pacman;
+    historico->trocaram_posicao = jogo->trocaram_posicao;
+
+    memcpy(historico->dx, jogo->fantasmas.dx, jogo->fantasmas.qtd * sizeof(int));
+    memcpy(historico->dy, jogo->fantasmas.dy, jogo->fantasmas.qtd * sizeof(int));
+
+    historico->qtd_candidatas = 0;
+    for (i = 0; i < CELULAS_TRILHA_CANDIDATAS; i++) {
+        int cx = celulas[i][0];
+        int cy = celulas[i][1];
+        int repetida = 0;
+
+        if (cx < 0 || cx >= jogo->mapa.colunas || cy < 0 || cy >= jogo->mapa.linhas) continue;
+
+        for (j = 0; j < historico->qtd_candidatas; j++) {
+            if (historico->candidatas[j][0] == cx && historico->candidatas[j][1] == cy) repetida = 1;
+        }
+        if (repetida) continue;
+
+        historico->candidatas[historico->qtd_candidatas][0] = cx;
+        historico->candidatas[historico->qtd_candidatas][1] = cy;
+        historico->candidatas[historico->qtd_candidatas][2] = jogo->mapa.trilha[cy][cx];
+        historico->candidatas[historico->qtd_candidatas][3] = jogo->indice_comidas[cy][cx];
+        historico->qtd_candidatas++;
+    }
+}
+
+void registraNoHistorico(tHistorico* historico, const tJogo* jogo) {
+    int i;
+    unsigned char* registro = historico->registro;
+    tPacman antes = historico->pacman;
+    tPacman depois = jogo->pacman;
+    size_t tamanho = REGISTRO_CABECALHO;
+    int qtd_trilha = 0;
+    int qtd_mudancas = 0;
+    uint16_t comida = REGISTRO_SEM_COMIDA;
+
+    registro[2] = antes.direcao;
+    registro[3] = depois.direcao;
+    registro[4] = antes.colidiu_com_parede | antes.colidiu_com_fantasma << 1 | antes.colidiu_com_comida << 2 |
+                  antes.colidiu_com_portal << 3 | historico->trocaram_posicao << 4;
+    registro[5] = depois.colidiu_com_parede | depois.colidiu_com_fantasma << 1 | depois.colidiu_com_comida << 2 |
+                  depois.colidiu_com_portal << 3 | jogo->trocaram_posicao << 4;
+    registro[6] = antes.x;
+    registro[7] = antes.y;
+    registro[8] = depois.x;
+    registro[9] = depois.y;
+
+    // A comida pega fica na posicao final do Pacman, ja que comer e teleportar sao
+    // exclusivos, e essa posicao eh uma das celulas candidatas
+    for (i = 0; i < historico->qtd_candidatas && depois.colidiu_com_comida; i++) {
+        if (historico->candidatas[i][0] == depois.x && historico->candidatas[i][1] == depois.y) {
+            comida = historico->candidatas[i][3];
+        }
+    }
+    memcpy(&registro[11], &comida, 2);
+
+    for (i = 0; i < historico->qtd_candidatas; i++) {
+        int cx = historico->candidatas[i][0];
+        int cy = historico->candidatas[i][1];
+        int32_t anterior = historico->candidatas[i][2];
+
+        if (jogo->mapa.trilha[cy][cx] == anterior) continue;
+
+        registro[tamanho] = cx;
+        registro[tamanho + 1] = cy;
+        memcpy(&registro[tamanho + 2], &anterior, 4);
+        tamanho += 6;
+        qtd_trilha++;
+    }
+    registro[10] = qtd_trilha;
+
+    for (i = 0; i < jogo->fantasmas.qtd; i++) {
+        if (jogo->fantasmas.dx[i] != historico->dx[i] || jogo->fantasmas.dy[i] != historico->dy[i]) {
+            uint16_t indice = i;
+            int antes = (historico->dx[i] + 1) * 3 + historico->dy[i] + 1;
+            int depois = (jogo->fantasmas.dx[i] + 1) * 3 + jogo->fantasmas.dy[i] + 1;
+
+            memcpy(&registro[tamanho], &indice, 2);
+            registro[tamanho + 2] = antes * 9 + depois;
+            tamanho += 3;
+            qtd_mudancas++;
+        }
+    }
+    memcpy(&registro[13], &(uint16_t){ qtd_mudancas }, 2);
+
+    tamanho += 2;
+    memcpy(&registro[0], &(uint16_t){ tamanho }, 2);
+    memcpy(&registro[tamanho - 2], &(uint16_t){ tamanho }, 2);
+
+    // Descarta as jogadas desfeitas e, se faltar espaco, as mais antigas
+    historico->topo = historico->atual;
+    while (historico->topo + tamanho - historico->inicio > TAM_HISTORICO) {
+        uint16_t tamanho_antigo;
+
+        copiaHistorico(historico, historico->inicio, (unsigned char*)&tamanho_antigo, 2, 0);
+        historico->inicio += tamanho_antigo;
+    }
+
+    copiaHistorico(historico, historico->atual, registro, tamanho, 1);
+    historico->atual += tamanho;
+    historico->topo = historico->atual;
+}
+
+void desfazJogadas(tJogo* jogo, tHistorico* historico, int qtd) {
+    int i;
+
+    for (i = 0; i < qtd && historico->atual > historico->inicio; i++) {
+        uint16_t tamanho;
+
+        copiaHistorico(historico, historico->atual - 2, (unsigned char*)&tamanho, 2, 0);
+        historico->atual -= tamanho;
+        copiaHistorico(historico, historico->atual, historico->registro, tamanho, 0);
+
+        aplicaRegistro(jogo, historico->registro, -1);
+    }
+
+    atualizaMapa(jogo);
+    verificaJogoImpossivel(jogo);
+}
+
+void refazJogadas(tJogo* jogo, tHistorico* historico, int qtd) {
+    int i;
+
+    for (i = 0; i < qtd && historico->atual < historico->topo; i++) {
+        uint16_t tamanho;
+
+        copiaHistorico(historico, historico->atual, (unsigned char*)&tamanho, 2, 0);
+        copiaHistorico(historico, historico->atual, historico->registro, tamanho, 0);
+        historico->atual += tamanho;
+
+        aplicaRegistro(jogo, historico->registro, 1);
+    }
+
+    atualizaMapa(jogo);
+    verificaJogoImpossivel(jogo);
+}
+
+void aplicaRegistro(tJogo* jogo, const unsigned char* registro, int sentido) {
+    int i;
+    uint16_t comida, qtd_mudancas;
+    tPacman pacman = jogo->pacman;
+    tFantasmas* fantasmas = &jogo->fantasmas;
+    int refazer = sentido == 1;
+    int colisoes = registro[refazer ? 5 : 4];
+    int colisoes_jogada = registro[5];
+    const unsigned char* trilha = &registro[REGISTRO_CABECALHO];
+    const unsigned char* mudancas = &trilha[6 * registro[10]];
+
+    memcpy(&comida, &registro[11], 2);
+    memcpy(&qtd_mudancas, &registro[13], 2);
+
+    // Fantasmas: na jogada, primeiro mudam de direcao e depois todos andam
+    if (refazer) {
+        for (i = 0; i < qtd_mudancas; i++) {
+            uint16_t f;
+            memcpy(&f, &mudancas[3 * i], 2);
+            fantasmas->dx[f] = mudancas[3 * i + 2] % 9 / 3 - 1;
+            fantasmas->dy[f] = mudancas[3 * i + 2] % 3 - 1;
+        }
+    }
+    for (i = 0; i < fantasmas->qtd; i++) {
+        fantasmas->x[i] += sentido * fantasmas->dx[i];
+        fantasmas->y[i] += sentido * fantasmas->dy[i];
+    }
+    if (!refazer) {
+        for (i = 0; i < qtd_mudancas; i++) {
+            uint16_t f;
+            memcpy(&f, &mudancas[3 * i], 2);
+            fantasmas->dx[f] = mudancas[3 * i + 2] / 9 / 3 - 1;
+            fantasmas->dy[f] = mudancas[3 * i + 2] / 9 % 3 - 1;
+        }
+    }
+
+    // Comida pega na posicao final do Pacman
+    if (comida != REGISTRO_SEM_COMIDA) {
+        int x = registro[8];
+        int y = registro[9];
+
+        if (refazer) {
+            comeComida(x, y, jogo);
+        } else {
+            jogo->comidas[comida].x = x;
+            jogo->comidas[comida].y = y;
+            jogo->comidas[comida].foi_comida = 0;
+            jogo->comidas_restantes++;
+            jogo->indice_comidas[y][x] = comida;
+        }
+        pacman.pontos += sentido;
+    }
+
+    for (i = 0; i < registro[10]; i++) {
+        int32_t anterior;
+
+        memcpy(&anterior, &trilha[6 * i + 2], 4);
+        jogo->mapa.trilha[trilha[6 * i + 1]][trilha[6 * i]] = refazer ? pacman.mov_atual + 1 : anterior;
+    }
+
+    // Estatisticas da direcao jogada, contadas com as colisoes apos a jogada
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        tEstatisticaMovimento* movimento = &jogo->estatistica_movs[i];
+
+        if (movimento->direcao != registro[3]) continue;
+
+        movimento->colisoes_parede += sentido * (colisoes_jogada & 1);
+        movimento->comidas_pegas += sentido * ((colisoes_jogada >> 2) & 1);
+        movimento->colisoes_apenas_parede += sentido * ((colisoes_jogada & 1) && !((colisoes_jogada >> 3) & 1));
+        movimento->qtd_realizado += sentido;
+    }
+
+    pacman.x = registro[refazer ? 8 : 6];
+    pacman.y = registro[refazer ? 9 : 7];
+    pacman.direcao = registro[refazer ? 3 : 2];
+    pacman.colidiu_com_parede = colisoes & 1;
+    pacman.colidiu_com_fantasma = (colisoes >> 1) & 1;
+    pacman.colidiu_com_comida = (colisoes >> 2) & 1;
+    pacman.colidiu_com_portal = (colisoes >> 3) & 1;
+    pacman.mov_atual += sentido;
+    pacman.movs_restantes -= sentido;
+
+    jogo->pacman = pacman;
+    jogo->trocaram_posicao = (colisoes >> 4) & 1;
+}
+
+void copiaHistorico(tHistorico* historico, size_t posicao, unsigned char* buffer, size_t tamanho, int escrever) {
+    size_t i;
+
+    for (i = 0; i < tamanho; i++) {
+        unsigned char* byte = &historico->dados[(posicao + i) % TAM_HISTORICO];
+
+        if (escrever) {
+            *byte = buffer[i];
+        } else {
+            buffer[i] = *byte;
+        }
+    }
+}
+
+
+///////////////////////////////// FUNCOES DA GRAVACAO /////////////////////////////////
+tGravacao* iniciaGravacao(const tJogo* jogo) {
+    tGravacao* gravacao = calloc(1, sizeof(tGravacao));
+
+    if (gravacao == NULL) {
+        printf("ERRO: Memoria insuficiente para a gravacao\n");
+        exit(1);
+    }
+
+    sprintf(gravacao->caminho, "%s/saida/gravacao.bin", jogo->dir);
+
+    char* dados;
+    size_t tamanho;
+    FILE* arquivo = open_memstream(&dados, &tamanho);
+    uint32_t cabecalho[10] = { 2, INTERVALO_QUADROS_CHAVE, jogo->mapa.linhas, jogo->mapa.colunas, jogo->mapa.lim_movs,
+                               jogo->opcoes.encerra_impossivel, jogo->opcoes.perseguicao, jogo->opcoes.janela_linhas,
+                               jogo->opcoes.janela_colunas, jogo->opcoes.minimapa };
+    int i;
+
+    fwrite("PMGR", 1, 4, arquivo);
+    fwrite(cabecalho, sizeof(uint32_t), 10, arquivo);
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        fwrite(jogo->mapa.mapa[i], 1, jogo->mapa.colunas, arquivo);
+    }
+    fclose(arquivo);
+
+    gravacao->tamanho = tamanho;
+    enviaEscrita(gravacao->caminho, "w", dados, tamanho, "gravacao.bin", jogo->dir, 0);
+
+    enviaQuadroChave(gravacao, jogo);
+
+    return gravacao;
+}
+
+void gravaJogada(tGravacao* gravacao, const tJogo* jogo) {
+    char* dados = malloc(2);
+
+    if (dados == NULL) {
+        printf("ERRO: Memoria insuficiente para a gravacao\n");
+        exit(1);
+    }
+
+    dados[0] = 'M';
+    dados[1] = jogo->pacman.direcao;
+    gravacao->tamanho += 2;
+    enviaEscrita(gravacao->caminho, "a", dados, 2, "gravacao.bin", jogo->dir, 0);
+
+    if (jogo->pacman.mov_atual % INTERVALO_QUADROS_CHAVE == 0) {
+        enviaQuadroChave(gravacao, jogo);
+    }
+}
+
+void encerraGravacao(tGravacao* gravacao, const tJogo* jogo) {
+    char* dados;
+    size_t tamanho;
+    FILE* arquivo = open_memstream(&dados, &tamanho);
+    uint32_t qtd = gravacao->qtd_quadros;
+    uint64_t posicao_indice = gravacao->tamanho;
+    int i;
+
+    fputc('I', arquivo);
+    fwrite(&qtd, sizeof(uint32_t), 1, arquivo);
+    for (i = 0; i < gravacao->qtd_quadros; i++) {
+        fwrite(&gravacao->quadros[i].movimento, sizeof(uint32_t), 1, arquivo);
+        fwrite(&gravacao->quadros[i].posicao, sizeof(uint64_t), 1, arquivo);
+    }
+    fwrite(&posicao_indice, sizeof(uint64_t), 1, arquivo);
+    fwrite("PMIX", 1, 4, arquivo);
+    fclose(arquivo);
+
+    enviaEscrita(gravacao->caminho, "a", dados, tamanho, "gravacao.bin", jogo->dir, 0);
+
+    free(gravacao->quadros);
+    free(gravacao);
+}
+
+void enviaQuadroChave(tGravacao* gravacao, const tJogo* jogo) {
+    if (gravacao->qtd_quadros == gravacao->capacidade) {
+        gravacao->capacidade = gravacao->capacidade ? 2 * gravacao->capacidade : 64;
+        gravacao->quadros = realloc(gravacao->quadros, gravacao->capacidade * sizeof(tQuadroChave));
+
+        if (gravacao->quadros == NULL) {
+            printf("ERRO: Memoria insuficiente para a gravacao\n");
+            exit(1);
+        }
+    }
+
+    gravacao->quadros[gravacao->qtd_quadros].movimento = jogo->pacman.mov_atual;
+    gravacao->quadros[gravacao->qtd_quadros].posicao = gravacao->tamanho;
+    gravacao->qtd_quadros++;
+
+    char* estado;
+    size_t tamanho_estado;
+    FILE* estadoFile = open_memstream(&estado, &tamanho_estado);
+    fprintQuadroChave(jogo, estadoFile);
+    fclose(estadoFile);
+
+    char* dados;
+    size_t tamanho;
+    FILE* arquivo = open_memstream(&dados, &tamanho);
+    uint32_t cabecalho[2] = { jogo->pacman.mov_atual, tamanho_estado };
+
+    fputc('K', arquivo);
+    fwrite(cabecalho, sizeof(uint32_t), 2, arquivo);
+    fwrite(estado, 1, tamanho_estado, arquivo);
+    fclose(arquivo);
+    free(estado);
+
+    gravacao->tamanho += 1 + sizeof(cabecalho) + tamanho_estado;
+    enviaEscrita(gravacao->caminho, "a", dados, tamanho, "gravacao.bin", jogo->dir, 0);
+}
+
+void fprintQuadroChave(const tJogo* jogo, FILE* arquivo) {
+    int i, j;
+    int linhas = jogo->mapa.linhas;
+    int colunas = jogo->mapa.colunas;
+    tPacman pacman = jogo->pacman;
+
+    for (i = 0; i < linhas; i++) {
+        fwrite(jogo->mapa.mapa[i], 1, colunas, arquivo);
+    }
+
+    int32_t valores[10 + 4 + 4 * QTD_MOVIMENTOS] = {
+        pacman.x, pacman.y, pacman.pontos, pacman.movs_restantes, pacman.mov_atual, pacman.direcao,
+        pacman.colidiu_com_parede, pacman.colidiu_com_fantasma, pacman.colidiu_com_comida, pacman.colidiu_com_portal,
+        jogo->trocaram_posicao, jogo->comidas_inalcancaveis, jogo->impossivel, jogo->movs_necessarios
+    };
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        valores[14 + 4 * i] = jogo->estatistica_movs[i].comidas_pegas;
+        valores[15 + 4 * i] = jogo->estatistica_movs[i].colisoes_parede;
+        valores[16 + 4 * i] = jogo->estatistica_movs[i].colisoes_apenas_parede;
+        valores[17 + 4 * i] = jogo->estatistica_movs[i].qtd_realizado;
+    }
+    fwrite(valores, sizeof(int32_t), 10 + 4 + 4 * QTD_MOVIMENTOS, arquivo);
+
+    // Fantasmas: posicao em 16 bits, deslocamento em 8 bits e o tipo
+    uint32_t qtd = jogo->fantasmas.qtd;
+    fwrite(&qtd, sizeof(uint32_t), 1, arquivo);
+    for (i = 0; i < jogo->fantasmas.qtd; i++) {
+        int16_t posicao[2] = { jogo->fantasmas.x[i], jogo->fantasmas.y[i] };
+        int8_t deslocamento[2] = { jogo->fantasmas.dx[i], jogo->fantasmas.dy[i] };
+
+        fwrite(posicao, sizeof(int16_t), 2, arquivo);
+        fwrite(deslocamento, sizeof(int8_t), 2, arquivo);
+        fputc(jogo->fantasmas.tipo[i], arquivo);
+    }
+
+    // Um bit por celula, ligado se ainda ha comida nela
+    uint8_t comidas[(MAX_LINHAS * MAX_COLUNAS + 7) / 8] = { 0 };
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            int celula = i * colunas + j;
+            if (temComidaNaPosicao(j, i, jogo)) comidas[celula / 8] |= 1 << (celula % 8);
+        }
+    }
+    fwrite(comidas, 1, (linhas * colunas + 7) / 8, arquivo);
+
+    // Trilha: so as celulas ja visitadas, como pares celula/movimento
+    uint32_t qtd_trilha = 0;
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            qtd_trilha += jogo->mapa.trilha[i][j] >= 0;
+        }
+    }
+    fwrite(&qtd_trilha, sizeof(uint32_t), 1, arquivo);
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            if (jogo->mapa.trilha[i][j] < 0) continue;
+
+            int32_t par[2] = { i * colunas + j, jogo->mapa.trilha[i][j] };
+            fwrite(par, sizeof(int32_t), 2, arquivo);
+        }
+    }
+}
+
+int leQuadroChave(tJogo* jogo, FILE* arquivo) {
+    int i, j;
+    int linhas = jogo->mapa.linhas;
+    int colunas = jogo->mapa.colunas;
+
+    for (i = 0; i < linhas; i++) {
+        if (fread(jogo->mapa.mapa[i], 1, colunas, arquivo) != (size_t)colunas) return 0;
+    }
+
+    int32_t valores[10 + 4 + 4 * QTD_MOVIMENTOS];
+    if (fread(valores, sizeof(int32_t), 10 + 4 + 4 * QTD_MOVIMENTOS, arquivo) != 10 + 4 + 4 * QTD_MOVIMENTOS) return 0;
+
+    jogo->pacman.x = valores[0];
+    jogo->pacman.y = valores[1];
+    jogo->pacman.pontos = valores[2];
+    jogo->pacman.movs_restantes = valores[3];
+    jogo->pacman.mov_atual = valores[4];
+    jogo->pacman.direcao = valores[5];
+    jogo->pacman.colidiu_com_parede = valores[6];
+    jogo->pacman.colidiu_com_fantasma = valores[7];
+    jogo->pacman.colidiu_com_comida = valores[8];
+    jogo->pacman.colidiu_com_portal = valores[9];
+    jogo->trocaram_posicao = valores[10];
+    jogo->comidas_inalcancaveis = valores[11];
+    jogo->impossivel = valores[12];
+    jogo->movs_necessarios = valores[13];
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        jogo->estatistica_movs[i].comidas_pegas = valores[14 + 4 * i];
+        jogo->estatistica_movs[i].colisoes_parede = valores[15 + 4 * i];
+        jogo->estatistica_movs[i].colisoes_apenas_parede = valores[16 + 4 * i];
+        jogo->estatistica_movs[i].qtd_realizado = valores[17 + 4 * i];
+    }
+
+    uint32_t qtd;
+    if (fread(&qtd, sizeof(uint32_t), 1, arquivo) != 1 || qtd > QTD_FANTASMAS) return 0;
+
+    jogo->fantasmas.qtd = qtd;
+    jogo->fantasmas.campo_valido = 0;
+    for (i = 0; i < jogo->fantasmas.qtd; i++) {
+        int16_t posicao[2];
+        int8_t deslocamento[2];
+        int tipo;
+
+        if (fread(posicao, sizeof(int16_t), 2, arquivo) != 2 || fread(deslocamento, sizeof(int8_t), 2, arquivo) != 2 ||
+            (tipo = fgetc(arquivo)) == EOF) return 0;
+
+        jogo->fantasmas.x[i] = posicao[0];
+        jogo->fantasmas.y[i] = posicao[1];
+        jogo->fantasmas.dx[i] = deslocamento[0];
+        jogo->fantasmas.dy[i] = deslocamento[1];
+        jogo->fantasmas.tipo[i] = tipo;
+    }
+
+    // As comidas do mapa inicial sem o bit ligado ja foram comidas
+    uint8_t comidas[(MAX_LINHAS * MAX_COLUNAS + 7) / 8];
+    if (fread(comidas, 1, (linhas * colunas + 7) / 8, arquivo) != (size_t)(linhas * colunas + 7) / 8) return 0;
+
+    jogo->comidas_restantes = 0;
+    for (i = 0; i < jogo->qtd_inicial_comidas; i++) {
+        tComida* comida = &jogo->comidas[i];
+        int celula = comida->y * colunas + comida->x;
+
+        if ((comidas[celula / 8] >> (celula % 8)) & 1) {
+            jogo->comidas_restantes++;
+        } else {
+            jogo->indice_comidas[comida->y][comida->x] = -1;
+            comida->x = -1;
+            comida->y = -1;
+            comida->foi_comida = 1;
+        }
+    }
+
+    uint32_t qtd_trilha;
+    if (fread(&qtd_trilha, sizeof(uint32_t), 1, arquivo) != 1) return 0;
+
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            jogo->mapa.trilha[i][j] = -1;
+        }
+    }
+    for (i = 0; i < (int)qtd_trilha; i++) {
+        int32_t par[2];
+
+        if (fread(par, sizeof(int32_t), 2, arquivo) != 2 || par[0] < 0 || par[0] >= linhas * colunas) return 0;
+        jogo->mapa.trilha[par[0] / colunas][par[0] % colunas] = par[1];
+    }
+
+    return 1;
+}
+
+int reproduzGravacao(char* arquivo, int movimento) {
+    FILE* gravacaoFile = fopen(arquivo, "rb");
+
+    if (gravacaoFile == NULL) {
+        printf("ERRO: Nao foi possivel abrir a gravacao '%s'\n", arquivo);
+        return 0;
+    }
+
+    char assinatura[4];
+    uint32_t cabecalho[10];
+    tJogo* jogo = calloc(1, sizeof(tJogo));
+    int i;
+
+    if (jogo == NULL) {
+        printf("ERRO: Memoria insuficiente para reproduzir '%s'\n", arquivo);
+        fclose(gravacaoFile);
+        return 0;
+    }
+
+    if (fread(assinatura, 1, 4, gravacaoFile) != 4 || memcmp(assinatura, "PMGR", 4) != 0 ||
+        fread(cabecalho, sizeof(uint32_t), 10, gravacaoFile) != 10 || cabecalho[0] != 2 ||
+        cabecalho[2] < 1 || cabecalho[2] > MAX_LINHAS || cabecalho[3] < 1 || cabecalho[3] > MAX_COLUNAS) {
+        printf("ERRO: '%s' nao eh uma gravacao valida\n", arquivo);
+        free(jogo);
+        fclose(gravacaoFile);
+        return 0;
+    }
+
+    // O jogo eh refeito a partir do mapa inicial; o quadro-chave so traz o que muda
+    jogo->mapa.linhas = cabecalho[2];
+    jogo->mapa.colunas = cabecalho[3];
+    jogo->mapa.lim_movs = cabecalho[4];
+    jogo->opcoes.encerra_impossivel = cabecalho[5];
+    jogo->opcoes.perseguicao = cabecalho[6];
+    jogo->opcoes.janela_linhas = cabecalho[7];
+    jogo->opcoes.janela_colunas = cabecalho[8];
+    jogo->opcoes.minimapa = cabecalho[9];
+
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        if (fread(jogo->mapa.mapa[i], 1, jogo->mapa.colunas, gravacaoFile) != (size_t)jogo->mapa.colunas) break;
+    }
+    if (i < jogo->mapa.linhas) {
+        printf("ERRO: '%s' nao eh uma gravacao valida\n", arquivo);
+        free(jogo);
+        fclose(gravacaoFile);
+        return 0;
+    }
+
+    criaObjetos(jogo);
+    preparaJogo(jogo);
+
+    long inicio_blocos = ftell(gravacaoFile);
+    long posicao = -1;
+    uint64_t posicao_indice;
+    tQuadroChave quadro;
+
+    // Com indice, basta le-lo; sem ele (gravacao interrompida), percorre os blocos
+    if (fseek(gravacaoFile, -12, SEEK_END) == 0 && fread(&posicao_indice, sizeof(uint64_t), 1, gravacaoFile) == 1 &&
+        fread(assinatura, 1, 4, gravacaoFile) == 4 && memcmp(assinatura, "PMIX", 4) == 0) {
+        uint32_t qtd;
+
+        fseek(gravacaoFile, posicao_indice + 1, SEEK_SET);
+        if (fread(&qtd, sizeof(uint32_t), 1, gravacaoFile) != 1) qtd = 0;
+
+        for (i = 0; i < (int)qtd; i++) {
+            if (fread(&quadro.movimento, sizeof(uint32_t), 1, gravacaoFile) != 1 ||
+                fread(&quadro.posicao, sizeof(uint64_t), 1, gravacaoFile) != 1) break;
+
+            if ((int)quadro.movimento > movimento) break;
+            posicao = quadro.posicao;
+        }
+    } else {
+        int tipo;
+
+        fseek(gravacaoFile, inicio_blocos, SEEK_SET);
+        while ((tipo = fgetc(gravacaoFile)) != EOF) {
+            if (tipo == 'M') {
+                fgetc(gravacaoFile);
+            } else if (tipo == 'K') {
+                long posicao_quadro = ftell(gravacaoFile) - 1;
+
+                if (fread(cabecalho, sizeof(uint32_t), 2, gravacaoFile) != 2) break;
+                if ((int)cabecalho[0] > movimento) break;
+
+                posicao = posicao_quadro;
+                fseek(gravacaoFile, cabecalho[1], SEEK_CUR);
+            } else {
+                break;
+            }
+        }
+    }
+
+    if (posicao < 0 || fseek(gravacaoFile, posicao + 1, SEEK_SET) != 0 ||
+        fread(cabecalho, sizeof(uint32_t), 2, gravacaoFile) != 2 || !leQuadroChave(jogo, gravacaoFile)) {
+        printf("ERRO: Nenhum quadro-chave utilizavel ate o movimento %d em '%s'\n", movimento, arquivo);
+        free(jogo);
+        fclose(gravacaoFile);
+        return 0;
+    }
+
+    // Refaz as jogadas entre o quadro-chave e o movimento desejado
+    while (jogo->pacman.mov_atual < movimento) {
+        int tipo = fgetc(gravacaoFile);
+
+        if (tipo == 'M') {
+            int direcao = fgetc(gravacaoFile);
+            if (direcao == EOF) break;
+
+            executaJogada(jogo, direcao);
+        } else if (tipo == 'K' && fread(cabecalho, sizeof(uint32_t), 2, gravacaoFile) == 2) {
+            fseek(gravacaoFile, cabecalho[1], SEEK_CUR);
+        } else {
+            break;
+        }
+    }
+
+    fclose(gravacaoFile);
+
+    if (jogo->pacman.mov_atual < movimento) {
+        printf("ERRO: A gravacao termina no movimento %d\n", jogo->pacman.mov_atual);
+        free(jogo);
+        return 0;
+    }
+
+    printEstadoJogo(jogo);
+    free(jogo);
+
+    return 1;
+}
+
+
+/////////////////////////////////// FUNCOES DOS BOTS //////////////////////////////////
+int carregaBot(char* caminho, tBotCarregado* destino) {
+    // Sem barra, o dlopen procuraria nos diretorios do sistema, e nao no atual
+    char caminho_completo[MAX_DIR_SIZE + 2];
+    sprintf(caminho_completo, "%s%s", strchr(caminho, '/') ? "" : "./", caminho);
+
+    void* biblioteca = dlopen(caminho_completo, RTLD_NOW | RTLD_LOCAL);
+
+    if (biblioteca == NULL) {
+        printf("ERRO: Nao foi possivel carregar o bot '%s': %s\n", caminho, dlerror());
+        return 0;
+    }
+
+    const tPacmanBot* (*funcao)(void);
+    *(void**)&funcao = dlsym(biblioteca, "pacman_bot");
+    const tPacmanBot* bot = funcao != NULL ? funcao() : NULL;
+
+    if (bot == NULL || bot->versao != PACMAN_BOT_VERSAO || bot->decide == NULL) {
+        printf("ERRO: '%s' nao eh um bot valido para a versao %d da interface\n", caminho, PACMAN_BOT_VERSAO);
+        dlclose(biblioteca);
+        return 0;
+    }
+
+    destino->biblioteca = biblioteca;
+    destino->bot = bot;
+
+    return 1;
+}
+
+tVisaoBot criaVisaoBot(const tJogo* jogo, unsigned int semente) {
+    tVisaoBot visao;
+
+    visao.linhas = jogo->mapa.linhas;
+    visao.colunas = jogo->mapa.colunas;
+    visao.largura = MAX_COLUNAS;
+    visao.mapa = &jogo->mapa.mapa[0][0];
+    visao.trilha = &jogo->mapa.trilha[0][0];
+    visao.indice_comidas = &jogo->indice_comidas[0][0];
+
+    visao.pacman_x = jogo->pacman.x;
+    visao.pacman_y = jogo->pacman.y;
+    visao.pontos = jogo->pacman.pontos;
+    visao.movs_restantes = jogo->pacman.movs_restantes;
+    visao.mov_atual = jogo->pacman.mov_atual;
+    visao.direcao = jogo->pacman.direcao;
+
+    visao.qtd_fantasmas = jogo->fantasmas.qtd;
+    visao.fantasmas_x = jogo->fantasmas.x;
+    visao.fantasmas_y = jogo->fantasmas.y;
+    visao.fantasmas_dx = jogo->fantasmas.dx;
+    visao.fantasmas_dy = jogo->fantasmas.dy;
+    visao.fantasmas_tipo = jogo->fantasmas.tipo;
+
+    visao.portais = &jogo->portais[0].x;
+    visao.comidas_restantes = jogo->comidas_restantes;
+    visao.semente = semente;
+
+    return visao;
+}
+
+long long jogaComBot(tJogo* jogo, const tPacmanBot* bot, unsigned int semente, double* tempo_bot, tMapaDeCalor* calor) {
+    long long decisoes = 0;
+    struct timespec antes, depois;
+
+    tVisaoBot visao = criaVisaoBot(jogo, semente);
+    void* estado = bot->inicia != NULL ? bot->inicia(&visao) : NULL;
+
+    if (calor != NULL) registraNoMapaDeCalor(calor, jogo);
+
+    while (resultadoJogo(jogo) == 0) {
+        visao = criaVisaoBot(jogo, semente);
+
+        if (tempo_bot != NULL) clock_gettime(CLOCK_MONOTONIC, &antes);
+        char direcao = bot->decide(estado, &visao);
+        if (tempo_bot != NULL) {
+            clock_gettime(CLOCK_MONOTONIC, &depois);
+            *tempo_bot += (depois.tv_sec - antes.tv_sec) + (depois.tv_nsec - antes.tv_nsec) / 1e9;
+        }
+        decisoes++;
+
+        executaJogada(jogo, direcao);
+
+        if (calor != NULL) registraNoMapaDeCalor(calor, jogo);
+    }
+
+    if (bot->encerra != NULL) bot->encerra(estado);
+
+    return decisoes;
+}
+
+void medeBot(char* dir, int partidas) {
+    const tPacmanBot* bot = bot_carregado.bot;
+    tJogo* inicial = malloc(sizeof(tJogo));
+    tJogo* jogo = malloc(sizeof(tJogo));
+
+    if (inicial == NULL || jogo == NULL) {
+        printf("ERRO: Memoria insuficiente para medir o bot\n");
+        exit(1);
+    }
+
+    *inicial = carregaJogo(dir);
+
+    long long decisoes = 0;
+    int vitorias = 0;
+    double tempo_bot = 0;
+    struct timespec inicio, fim;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
+
+    for (i = 0; i < partidas; i++) {
+        *jogo = *inicial;
+
+        decisoes += jogaComBot(jogo, bot, 0, &tempo_bot, NULL);
+        vitorias += resultadoJogo(jogo) == 1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+    double tempo_total = (fim.tv_sec - inicio.tv_sec) + (fim.tv_nsec - inicio.tv_nsec) / 1e9;
+
+    printf("Bot '%s': %d partida(s), %d vitoria(s), %lld decisoes\n", bot->nome ? bot->nome : "?", partidas, vitorias, decisoes);
+    printf("Decisoes por segundo (apenas o bot): %.0f\n", tempo_bot > 0 ? decisoes / tempo_bot : 0);
+    printf("Jogadas por segundo (bot e jogo): %.0f\n", tempo_total > 0 ? decisoes / tempo_total : 0);
+
+    free(inicial);
+    free(jogo);
+}
+
+
+////////////////////////////////// FUNCOES DO TORNEIO ////////////////////////////////
+int jogaTorneio(char* lista_bots, char* lista_mapas, char* resultados, char* ranking, tOpcoes opcoes) {
+    static tTorneio torneio;
+    char (*bots)[MAX_DIR_SIZE];
+    int i, j, k;
+
+    torneio.opcoes = opcoes;
+    torneio.qtd_bots = leLista(lista_bots, &bots, "bots");
+    torneio.qtd_mapas = leLista(lista_mapas, &torneio.dirs, "mapas");
+
+    torneio.bots = malloc(torneio.qtd_bots * sizeof(tBotCarregado));
+    torneio.totais = calloc(torneio.qtd_bots, sizeof(tResultadoBot));
+    torneio.mapas = malloc(torneio.qtd_mapas * sizeof(tJogo*));
+    torneio.calor = calloc(torneio.qtd_mapas, sizeof(tMapaDeCalor*));
+
+    if (torneio.bots == NULL || torneio.totais == NULL || torneio.mapas == NULL || torneio.calor == NULL) {
+        printf("ERRO: Memoria insuficiente para o torneio\n");
+        exit(1);
+    }
+
+    for (i = 0; i < torneio.qtd_bots; i++) {
+        if (!carregaBot(bots[i], &torneio.bots[i])) return 1;
+
+        const char* nome = torneio.bots[i].bot->nome;
+        strcpy(torneio.totais[i].nome, nome != NULL ? nome : bots[i]);
+    }
+
+    for (i = 0; i < torneio.qtd_mapas; i++) {
+        torneio.mapas[i] = malloc(sizeof(tJogo));
+
+        if (torneio.mapas[i] == NULL) {
+            printf("ERRO: Memoria insuficiente para o torneio\n");
+            exit(1);
+        }
+
+        *torneio.mapas[i] = carregaJogo(torneio.dirs[i]);
+        torneio.mapas[i]->opcoes = opcoes;
+
+        if (opcoes.mapa_de_calor) {
+            criaPastaSaida(torneio.dirs[i]);
+            torneio.calor[i] = carregaMapaDeCalor(torneio.dirs[i], torneio.mapas[i]->mapa.linhas, torneio.mapas[i]->mapa.colunas);
+        }
+    }
+
+    torneio.resultados = fopen(resultados, "w");
+
+    if (torneio.resultados == NULL) {
+        printf("ERRO: Nao foi possivel criar o arquivo de resultados '%s'\n", resultados);
+        exit(1);
+    }
+
+    fprintf(torneio.resultados, "bot,mapa,semente,resultado,comidas,colisoes_parede,movimentos\n");
+    fflush(torneio.resultados);
+
+    // As tarefas comecam distribuidas em rodizio; o roubo equilibra o resto
+    torneio.qtd_trabalhadores = opcoes.threads > 0 ? opcoes.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (torneio.qtd_trabalhadores < 1) torneio.qtd_trabalhadores = 1;
+
+    int qtd_tarefas = torneio.qtd_bots * torneio.qtd_mapas * SEMENTES_TORNEIO;
+    int por_fila = qtd_tarefas / torneio.qtd_trabalhadores + 1;
+    int proxima = 0;
+
+    torneio.filas = calloc(torneio.qtd_trabalhadores, sizeof(tFilaTorneio));
+    tTrabalhadorTorneio* trabalhadores = malloc(torneio.qtd_trabalhadores * sizeof(tTrabalhadorTorneio));
+
+    if (torneio.filas == NULL || trabalhadores == NULL) {
+        printf("ERRO: Memoria insuficiente para o torneio\n");
+        exit(1);
+    }
+
+    for (i = 0; i < torneio.qtd_trabalhadores; i++) {
+        torneio.filas[i].itens = malloc(por_fila * sizeof(tTarefaTorneio));
+
+        if (torneio.filas[i].itens == NULL) {
+            printf("ERRO: Memoria insuficiente para o torneio\n");
+            exit(1);
+        }
+
+        pthread_mutex_init(&torneio.filas[i].trava, NULL);
+    }
+
+    for (i = 0; i < torneio.qtd_mapas; i++) {
+        for (j = 0; j < torneio.qtd_bots; j++) {
+            for (k = 0; k < SEMENTES_TORNEIO; k++) {
+                tFilaTorneio* fila = &torneio.filas[proxima++ % torneio.qtd_trabalhadores];
+                tTarefaTorneio tarefa = { j, i, k + 1 };
+
+                fila->itens[fila->fim++] = tarefa;
+            }
+        }
+    }
+
+    pthread_mutex_init(&torneio.trava, NULL);
+
+    for (i = 0; i < torneio.qtd_trabalhadores; i++) {
+        trabalhadores[i].torneio = &torneio;
+        trabalhadores[i].indice = i;
+
+        if (pthread_create(&trabalhadores[i].thread, NULL, executaTorneio, &trabalhadores[i]) != 0) {
+            printf("ERRO: Nao foi possivel iniciar os trabalhadores do torneio\n");
+            exit(1);
+        }
+    }
+
+    for (i = 0; i < torneio.qtd_trabalhadores; i++) {
+        pthread_join(trabalhadores[i].thread, NULL);
+    }
+
+    fclose(torneio.resultados);
+    geraRankingTorneio(&torneio, ranking);
+
+    for (i = 0; i < torneio.qtd_mapas; i++) {
+        if (torneio.calor[i] != NULL) {
+            salvaMapaDeCalor(torneio.calor[i], torneio.mapas[i]->mapa, torneio.dirs[i]);
+            free(torneio.calor[i]);
+        }
+        free(torneio.mapas[i]);
+    }
+
+    for (i = 0; i < torneio.qtd_trabalhadores; i++) {
+        pthread_mutex_destroy(&torneio.filas[i].trava);
+        free(torneio.filas[i].itens);
+    }
+
+    free(trabalhadores);
+    free(torneio.filas);
+    free(torneio.calor);
+    free(torneio.mapas);
+    free(torneio.totais);
+    free(torneio.bots);
+    free(torneio.dirs);
+    free(bots);
+
+    return 0;
+}
+
+void* executaTorneio(void* arg) {
+    tTrabalhadorTorneio* trabalhador = arg;
+    tTorneio* torneio = trabalhador->torneio;
+    tTarefaTorneio tarefa;
+    tJogo* jogo = malloc(sizeof(tJogo));
+
+    if (jogo == NULL) {
+        printf("ERRO: Memoria insuficiente para o torneio\n");
+        exit(1);
+    }
+
+    while (pegaTarefa(torneio, trabalhador->indice, &tarefa)) {
+        tMapaDeCalor* calor = torneio->calor[tarefa.mapa];
+        int i;
+
+        *jogo = *torneio->mapas[tarefa.mapa];
+        jogaComBot(jogo, torneio->bots[tarefa.bot].bot, tarefa.semente, NULL, calor);
+
+        if (calor != NULL) atomic_fetch_add(&calor->partidas, 1);
+
+        int resultado = resultadoJogo(jogo);
+        int colisoes = 0;
+
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            colisoes += jogo->estatistica_movs[i].colisoes_apenas_parede;
+        }
+
+        pthread_mutex_lock(&torneio->trava);
+
+        tResultadoBot* total = &torneio->totais[tarefa.bot];
+
+        total->partidas++;
+        total->vitorias += resultado == 1;
+        total->comidas_pegas += jogo->pacman.pontos;
+        total->colisoes_apenas_parede += colisoes;
+        total->qtd_realizado += jogo->pacman.mov_atual;
+
+        fprintf(torneio->resultados, "%s,%s,%d,%s,%d,%d,%d\n", total->nome, torneio->dirs[tarefa.mapa], tarefa.semente,
+                resultado == 1 ? "vitoria" : "derrota", jogo->pacman.pontos, colisoes, jogo->pacman.mov_atual);
+        fflush(torneio->resultados);
+
+        pthread_mutex_unlock(&torneio->trava);
+    }
+
+    free(jogo);
+
+    return NULL;
+}
+
+int pegaTarefa(tTorneio* torneio, int indice, tTarefaTorneio* tarefa) {
+    int i;
+
+    for (i = 0; i < torneio->qtd_trabalhadores; i++) {
+        int vitima = (indice + i) % torneio->qtd_trabalhadores;
+        tFilaTorneio* fila = &torneio->filas[vitima];
+        int achou = 0;
+
+        pthread_mutex_lock(&fila->trava);
+
+        if (fila->inicio < fila->fim) {
+            // A propria fila eh consumida pelo fim; a dos outros, pelo inicio
+            if (vitima == indice) {
+                *tarefa = fila->itens[--fila->fim];
+            } else {
+                *tarefa = fila->itens[fila->inicio++];
+            }
+            achou = 1;
+        }
+
+        pthread_mutex_unlock(&fila->trava);
+
+        if (achou) return 1;
+    }
+
+    return 0;
+}
+
+void geraRankingTorneio(tTorneio* torneio, char* ranking) {
+    int i;
+
+    // Ordena os bots com os mesmos criterios do ranking de movimentos
+    ordenaRanking(torneio->totais, torneio->qtd_bots, sizeof(tResultadoBot), comparaBotsRanking);
+
+    FILE* rankingFile = fopen(ranking, "w");
+
+    if (rankingFile == NULL) {
+        printf("ERRO: Nao foi possivel criar o ranking '%s'\n", ranking);
+        exit(1);
+    }
+
+    for (i = 0; i < torneio->qtd_bots; i++) {
+        tResultadoBot bot = torneio->totais[i];
+
+        fprintf(rankingFile, "%s,%lld,%lld,%lld\n", bot.nome, bot.comidas_pegas, bot.colisoes_apenas_parede, bot.qtd_realizado);
+        printf("%d. %s: %lld comida(s), %lld colisao(oes) com parede, %lld movimento(s), %d vitoria(s) em %d partida(s)\n",
+               i + 1, bot.nome, bot.comidas_pegas, bot.colisoes_apenas_parede, bot.qtd_realizado, bot.vitorias, bot.partidas);
+    }
+
+    fclose(rankingFile);
+}
+
+int comparaBotsRanking(const void* a, const void* b) {
+    const tResultadoBot* bot1 = a;
+    const tResultadoBot* bot2 = b;
+    int criterios = comparaCriteriosRanking(bot1->comidas_pegas, bot1->colisoes_apenas_parede, bot1->qtd_realizado,
+                                            bot2->comidas_pegas, bot2->colisoes_apenas_parede, bot2->qtd_realizado);
+
+    // Quarto criterio: ordem alfabetica
+    return criterios != 0 ? criterios : strcmp(bot1->nome, bot2->nome);
+}
+
+int leLista(char* lista, char (**itens)[MAX_DIR_SIZE], char* descricao) {
+    FILE* listaFile = fopen(lista, "r");
+
+    if (listaFile == NULL) {
+        printf("ERRO: Nao foi possivel abrir a lista de %s '%s'\n", descricao, lista);
+        exit(1);
+    }
+
+    char linha[MAX_DIR_SIZE + 2];
+    int qtd = 0;
+    int capacidade = 0;
+
+    *itens = NULL;
+
+    while (fgets(linha, sizeof(linha), listaFile)) {
+        linha[strcspn(linha, "\r\n")] = '\0';
+        if (linha[0] == '\0' || linha[0] == '#') continue;
+
+        if (qtd == capacidade) {
+            capacidade = capacidade ? 2 * capacidade : 16;
+            *itens = realloc(*itens, capacidade * sizeof(**itens));
+
+            if (*itens == NULL) {
+                printf("ERRO: Memoria insuficiente para a lista de %s\n", descricao);
+                exit(1);
+            }
+        }
+
+        strcpy((*itens)[qtd], linha);
+        qtd++;
+    }
+
+    fclose(listaFile);
+
+    if (qtd == 0) {
+        printf("ERRO: A lista de %s '%s' esta vazia\n", descricao, lista);
+        exit(1);
+    }
+
+    return qtd;
+}
+
+
+///////////////////////////////// FUNCOES DAS METRICAS ////////////////////////////////
+static tMetricas* metricas;
+static char nome_metricas[MAX_DIR_SIZE];
+
+int iniciaMetricas(char* nome) {
+    // Um segmento com o mesmo nome pode pertencer a outra partida em andamento
+    int fd = shm_open(nome, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0 && errno == EEXIST) {
+        printf("ERRO: O segmento de metricas '%s' ja esta em uso\n", nome);
+        return 0;
+    }
+
+    if (fd < 0 || ftruncate(fd, sizeof(tMetricas)) != 0) {
+        printf("ERRO: Nao foi possivel criar o segmento de metricas '%s'\n", nome);
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(nome);
+        }
+        return 0;
+    }
+
+    metricas = mmap(NULL, sizeof(tMetricas), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (metricas == MAP_FAILED) {
+        printf("ERRO: Nao foi possivel mapear o segmento de metricas '%s'\n", nome);
+        metricas = NULL;
+        shm_unlink(nome);
+        return 0;
+    }
+
+    // O segmento acabou de ser criado, entao o ftruncate ja o zerou
+    metricas->versao = VERSAO_METRICAS;
+    strncpy(nome_metricas, nome, MAX_DIR_SIZE - 1);
+    atexit(encerraMetricas);
+
+    return 1;
+}
+
+void encerraMetricas(void) {
+    if (metricas == NULL) return;
+
+    munmap(metricas, sizeof(tMetricas));
+    shm_unlink(nome_metricas);
+    metricas = NULL;
+}
+
+void publicaMetricas(const tJogo* jogo, uint64_t latencia_ns, int encerrado) {
+    if (metricas == NULL) return;
+
+    int i;
+
+    // So o jogo escreve, entao a sequencia pode ser lida e incrementada sem disputa
+    unsigned int sequencia = atomic_load_explicit(&metricas->sequencia, memory_order_relaxed);
+    atomic_store_explicit(&metricas->sequencia, sequencia + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    tValoresMetricas* valores = &metricas->valores;
+
+    valores->movimento = jogo->pacman.mov_atual;
+    valores->pontos = jogo->pacman.pontos;
+    valores->comidas_restantes = jogo->comidas_restantes;
+    valores->movs_restantes = jogo->pacman.movs_restantes;
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        valores->direcoes[i] = jogo->estatistica_movs[i].direcao;
+        valores->comidas_pegas[i] = jogo->estatistica_movs[i].comidas_pegas;
+        valores->colisoes_parede[i] = jogo->estatistica_movs[i].colisoes_parede;
+        valores->colisoes_apenas_parede[i] = jogo->estatistica_movs[i].colisoes_apenas_parede;
+        valores->qtd_realizado[i] = jogo->estatistica_movs[i].qtd_realizado;
+    }
+    valores->latencia_ns = latencia_ns;
+    valores->tempo_jogadas_ns += latencia_ns;
+    // A vazao conta so o tempo das jogadas, sem a espera pela entrada do jogador
+    valores->movimentos_por_segundo = valores->tempo_jogadas_ns > 0 ? jogo->pacman.mov_atual / (valores->tempo_jogadas_ns / 1e9) : 0;
+    valores->encerrado = encerrado;
+
+    atomic_store_explicit(&metricas->sequencia, sequencia + 2, memory_order_release);
+}
+
+int leMetricas(char* nome, int intervalo_ms, int amostras) {
+    int fd = shm_open(nome, O_RDONLY, 0);
+
+    if (fd < 0) {
+        printf("ERRO: Segmento de metricas '%s' nao encontrado\n", nome);
+        return 0;
+    }
+
+    tMetricas* segmento = mmap(NULL, sizeof(tMetricas), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (segmento == MAP_FAILED || segmento->versao != VERSAO_METRICAS) {
+        printf("ERRO: Segmento de metricas '%s' invalido\n", nome);
+        if (segmento != MAP_FAILED) munmap(segmento, sizeof(tMetricas));
+        return 0;
+    }
+
+    struct timespec espera = { intervalo_ms / 1000, (intervalo_ms % 1000) * 1000000L };
+    int i, lidas = 0;
+
+    while (amostras == 0 || lidas < amostras) {
+        tValoresMetricas valores;
+        unsigned int antes, depois;
+
+        // Copia ate pegar uma versao que o jogo nao estava escrevendo
+        do {
+            antes = atomic_load_explicit(&segmento->sequencia, memory_order_acquire);
+            memcpy(&valores, (const void*)&segmento->valores, sizeof(valores));
+            atomic_thread_fence(memory_order_acquire);
+            depois = atomic_load_explicit(&segmento->sequencia, memory_order_relaxed);
+        } while ((antes & 1) || antes != depois);
+
+        printf("Movimento %llu: %lld ponto(s), %lld comida(s) e %lld movimento(s) restantes, %.1f mov/s, ultima jogada em %llu ns\n",
+               (unsigned long long)valores.movimento, (long long)valores.pontos, (long long)valores.comidas_restantes,
+               (long long)valores.movs_restantes, valores.movimentos_por_segundo, (unsigned long long)valores.latencia_ns);
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            printf("  %c: %lld comida(s), %lld colisao(oes) com parede, %lld vez(es)\n", valores.direcoes[i] ? valores.direcoes[i] : '?',
+                   (long long)valores.comidas_pegas[i], (long long)valores.colisoes_parede[i], (long long)valores.qtd_realizado[i]);
+        }
+        fflush(stdout);
+        lidas++;
+
+        if (valores.encerrado) break;
+        nanosleep(&espera, NULL);
+    }
+
+    munmap(segmento, sizeof(tMetricas));
+
+    return 1;
+}
+
+
+/////////////////////////////// FUNCOES DA TRANSMISSAO ///////////////////////////////
+static tTransmissao* transmissao;
+static char nome_transmissao[MAX_DIR_SIZE];
+
+int iniciaTransmissao(char* nome) {
+    // Um segmento com o mesmo nome pode pertencer a outra partida em andamento
+    int fd = shm_open(nome, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+    if (fd < 0 && errno == EEXIST) {
+        printf("ERRO: O segmento de transmissao '%s' ja esta em uso\n", nome);
+        return 0;
+    }
+
+    if (fd < 0 || ftruncate(fd, sizeof(tTransmissao)) != 0) {
+        printf("ERRO: Nao foi possivel criar o segmento de transmissao '%s'\n", nome);
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(nome);
+        }
+        return 0;
+    }
+
+    transmissao = mmap(NULL, sizeof(tTransmissao), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (transmissao == MAP_FAILED) {
+        printf("ERRO: Nao foi possivel mapear o segmento de transmissao '%s'\n", nome);
+        transmissao = NULL;
+        shm_unlink(nome);
+        return 0;
+    }
+
+    // O segmento acabou de ser criado, entao o ftruncate ja o zerou
+    transmissao->versao = VERSAO_TRANSMISSAO;
+    strncpy(nome_transmissao, nome, MAX_DIR_SIZE - 1);
+    atexit(encerraTransmissao);
+
+    return 1;
+}
+
+void encerraTransmissao(void) {
+    if (transmissao == NULL) return;
+
+    atomic_store_explicit(&transmissao->encerrado, 1, memory_order_release);
+    munmap(transmissao, sizeof(tTransmissao));
+    shm_unlink(nome_transmissao);
+    transmissao = NULL;
+}
+
+void transmiteQuadro(const tJogo* jogo) {
+    static tMapa anterior;
+
+    if (transmissao == NULL) return;
+
+    int i, j;
+    unsigned long long n = atomic_load_explicit(&transmissao->publicados, memory_order_relaxed);
+    tQuadroTransmissao* quadro = &transmissao->quadros[n % QTD_QUADROS_TRANSMISSAO];
+    const tMapa* mapa = &jogo->mapa;
+    int chave = n % INTERVALO_CHAVE_TRANSMISSAO == 0 || mapa->linhas != anterior.linhas || mapa->colunas != anterior.colunas;
+    int qtd_celulas = 0;
+
+    atomic_store_explicit(&quadro->sequencia, 2 * n + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    // Quando ha tantas mudancas que os trios ocupariam mais que o mapa, vai o mapa inteiro
+    for (i = 0; i < mapa->linhas && !chave; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == anterior.mapa[i][j]) continue;
+
+            if (3 * (qtd_celulas + 1) > (int)sizeof(quadro->dados)) {
+                chave = 1;
+                break;
+            }
+
+            quadro->dados[3 * qtd_celulas] = j;
+            quadro->dados[3 * qtd_celulas + 1] = i;
+            quadro->dados[3 * qtd_celulas + 2] = mapa->mapa[i][j];
+            qtd_celulas++;
+        }
+    }
+
+    if (chave) {
+        for (i = 0; i < mapa->linhas; i++) {
+            memcpy(&quadro->dados[i * mapa->colunas], mapa->mapa[i], mapa->colunas);
+        }
+        qtd_celulas = 0;
+    }
+
+    quadro->chave = chave;
+    quadro->linhas = mapa->linhas;
+    quadro->colunas = mapa->colunas;
+    quadro->pontos = jogo->pacman.pontos;
+    quadro->direcao = jogo->pacman.direcao;
+    quadro->qtd_celulas = qtd_celulas;
+
+    atomic_store_explicit(&quadro->sequencia, 2 * n + 2, memory_order_release);
+    if (chave) atomic_store_explicit(&transmissao->ultima_chave, n, memory_order_release);
+    atomic_store_explicit(&transmissao->publicados, n + 1, memory_order_release);
+
+    anterior.linhas = mapa->linhas;
+    anterior.colunas = mapa->colunas;
+    for (i = 0; i < mapa->linhas; i++) {
+        memcpy(anterior.mapa[i], mapa->mapa[i], mapa->colunas);
+    }
+}
 
-/**
- * @brief Gera o arquivo 'trilha.txt' com a trilha percorrida pelo Pacman.
- *
- * @param jogo Struct do jogo
- */
-void geraTrilhaTxt(tJogo jogo);
+int copiaQuadro(const tTransmissao* transmissao, unsigned long long n, tQuadroTransmissao* quadro) {
+    const tQuadroTransmissao* origem = &transmissao->quadros[n % QTD_QUADROS_TRANSMISSAO];
+    unsigned long long antes = atomic_load_explicit(&origem->sequencia, memory_order_acquire);
 
+    if (antes != 2 * n + 2) return 0;
 
-/****************************************** MAIN ********************************************/
-int main(int argc, char* argv[])
-{
-    if (argc <= 1) {
-        printf("ERRO: O diretorio de arquivos de configuracao nao foi informado\n");
-        return 1;
+    memcpy(quadro, (const void*)origem, sizeof(tQuadroTransmissao));
+    atomic_thread_fence(memory_order_acquire);
+
+    return atomic_load_explicit(&origem->sequencia, memory_order_relaxed) == antes;
+}
+
+int assisteTransmissao(char* nome) {
+    int fd = shm_open(nome, O_RDONLY, 0);
+
+    if (fd < 0) {
+        printf("ERRO: Transmissao '%s' nao encontrada\n", nome);
+        return 0;
     }
 
-    char dir[MAX_DIR_SIZE];
-    strcpy(dir, argv[1]);
+    tTransmissao* segmento = mmap(NULL, sizeof(tTransmissao), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
 
-    tJogo jogo = inicializaJogo(dir);
-    geraInicializacaoTxt(jogo);
+    if (segmento == MAP_FAILED || segmento->versao != VERSAO_TRANSMISSAO) {
+        printf("ERRO: Transmissao '%s' invalida\n", nome);
+        if (segmento != MAP_FAILED) munmap(segmento, sizeof(tTransmissao));
+        return 0;
+    }
+
+    static tMapa mapa;
+    static tQuadroTransmissao quadro;
+    struct timespec espera = { 0, 2000000 };
+    unsigned long long proximo = 0;
+    int sincronizado = 0;
+    int i;
 
     while (1) {
-        jogo = realizaJogo(jogo);
+        unsigned long long publicados = atomic_load_explicit(&segmento->publicados, memory_order_acquire);
 
-        printEstadoJogo(jogo);
+        if (proximo >= publicados) {
+            if (atomic_load_explicit(&segmento->encerrado, memory_order_acquire)) break;
 
-        jogo = atualizaEstatisticasMovimentos(jogo);
-        atualizaResumo(jogo);
+            nanosleep(&espera, NULL);
+            continue;
+        }
 
-        if (verificaFimDeJogo(jogo))
-            break;
+        // Sem um quadro-chave aplicado, ou se o quadro esperado ja foi sobrescrito, volta
+        // ao ultimo quadro-chave
+        if (!sincronizado || !copiaQuadro(segmento, proximo, &quadro)) {
+            proximo = atomic_load_explicit(&segmento->ultima_chave, memory_order_acquire);
+            if (!copiaQuadro(segmento, proximo, &quadro) || !quadro.chave) continue;
+        }
+
+        if (quadro.chave) {
+            mapa.linhas = quadro.linhas;
+            mapa.colunas = quadro.colunas;
+            for (i = 0; i < mapa.linhas; i++) {
+                memcpy(mapa.mapa[i], &quadro.dados[i * mapa.colunas], mapa.colunas);
+            }
+        } else {
+            for (i = 0; i < quadro.qtd_celulas; i++) {
+                mapa.mapa[quadro.dados[3 * i + 1]][quadro.dados[3 * i]] = quadro.dados[3 * i + 2];
+            }
+        }
+        sincronizado = 1;
+        proximo++;
+
+        printf("Estado do jogo apos o movimento '%c':\n", quadro.direcao);
+        printMapa(mapa);
+        printf("Pontuacao: %d\n\n", quadro.pontos);
+        fflush(stdout);
     }
 
-    geraEstatisticasTxt(jogo);
-    geraRankingTxt(jogo);
-    geraTrilhaTxt(jogo);
+    munmap(segmento, sizeof(tTransmissao));
 
-    return 0;
+    return 1;
 }
 
 
-////////////////////////////////// FUNCOES DO MAPA ///////////////////////////////////
-tMapa criaMapa(char* dir) {
-    FILE* mapaFile;
-    char mapa_dir[MAX_DIR_SIZE + 9];
-    sprintf(mapa_dir, "%s/mapa.txt", dir);
+/////////////////////////////// FUNCOES DO REGISTRO DA SESSAO /////////////////////////
+static tSessao sessao;
 
-    mapaFile = fopen(mapa_dir, "r");
+void iniciaRegistroSessao(const tJogo* jogo) {
+    int i;
 
-    if (mapaFile == NULL) {
-        printf("ERRO: arquivo 'mapa.txt' nao encontrado em %s\n", dir);
-        exit(1);
+    sessao.ativo = 1;
+    sprintf(sessao.caminho, "%s/saida/sessao.log", jogo->dir);
+    strcpy(sessao.dir, jogo->dir);
+    sessao.anterior = jogo->mapa;
+    sessao.pontos = 0;
+
+    char* dados;
+    size_t tamanho;
+    FILE* arquivo = open_memstream(&dados, &tamanho);
+    uint32_t cabecalho[3] = { 1, jogo->mapa.linhas, jogo->mapa.colunas };
+
+    fwrite("PMSL", 1, 4, arquivo);
+    fwrite(cabecalho, sizeof(uint32_t), 3, arquivo);
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        fwrite(jogo->mapa.mapa[i], 1, jogo->mapa.colunas, arquivo);
     }
+    fclose(arquivo);
+
+    enviaEscrita(sessao.caminho, "w", dados, tamanho, "sessao.log", sessao.dir, 0);
+
+    sessao.lote = open_memstream(&sessao.dados, &sessao.tamanho);
+}
 
-    tMapa mapa = { 0 };
-    fscanf(mapaFile, "%d %d %d\n", &mapa.linhas, &mapa.colunas, &mapa.lim_movs);
+void registraQuadroSessao(const tJogo* jogo) {
+    if (!sessao.ativo) return;
 
     int i, j;
-    for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            fscanf(mapaFile, "%c", &mapa.mapa[i][j]);
+    int qtd = 0;
+    FILE* arquivo = sessao.lote;
+    const tMapa* mapa = &jogo->mapa;
+
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            qtd += mapa->mapa[i][j] != sessao.anterior.mapa[i][j];
         }
-        fscanf(mapaFile, "\n");
     }
 
-    fclose(mapaFile);
+    // Variacao da pontuacao em zigzag, para que valores negativos tambem sejam curtos
+    int variacao = jogo->pacman.pontos - sessao.pontos;
+
+    fputc('F', arquivo);
+    fputc(jogo->pacman.direcao, arquivo);
+    escreveVarint(arquivo, variacao >= 0 ? 2ULL * variacao : 2ULL * -variacao - 1);
+    escreveVarint(arquivo, qtd);
+
+    int ultima = -1;
+    for (i = 0; i < mapa->linhas; i++) {
+        for (j = 0; j < mapa->colunas; j++) {
+            if (mapa->mapa[i][j] == sessao.anterior.mapa[i][j]) continue;
+
+            int posicao = i * mapa->colunas + j;
+
+            escreveVarint(arquivo, posicao - ultima - 1);
+            fputc(mapa->mapa[i][j], arquivo);
+            ultima = posicao;
 
-    return mapa;
+            sessao.anterior.mapa[i][j] = mapa->mapa[i][j];
+        }
+    }
+
+    sessao.pontos = jogo->pacman.pontos;
+
+    if (ftell(arquivo) >= TAM_LOTE_SESSAO) enviaLoteSessao(1);
 }
 
-tMapa atualizaMapa(tJogo jogo) {
-    int i, j;
-    tMapa mapa = jogo.mapa;
+void registraFimSessao(int venceu, int pontos) {
+    if (!sessao.ativo) return;
+
+    fputc('E', sessao.lote);
+    fputc(venceu == 1 ? 1 : 2, sessao.lote);
+    escreveVarint(sessao.lote, pontos);
+
+    enviaLoteSessao(0);
+    sessao.ativo = 0;
+}
+
+void enviaLoteSessao(int continua) {
+    fclose(sessao.lote);
+    enviaEscrita(sessao.caminho, "a", sessao.dados, sessao.tamanho, "sessao.log", sessao.dir, 0);
+
+    sessao.lote = continua ? open_memstream(&sessao.dados, &sessao.tamanho) : NULL;
+}
+
+void escreveVarint(FILE* arquivo, unsigned long long valor) {
+    while (valor >= 0x80) {
+        fputc((valor & 0x7F) | 0x80, arquivo);
+        valor >>= 7;
+    }
+    fputc(valor, arquivo);
+}
+
+int leVarint(FILE* arquivo, unsigned long long* valor) {
+    int byte, deslocamento = 0;
+
+    *valor = 0;
+    while ((byte = fgetc(arquivo)) != EOF) {
+        *valor |= (unsigned long long)(byte & 0x7F) << deslocamento;
+        if (!(byte & 0x80)) return 1;
 
+        deslocamento += 7;
+        if (deslocamento > 63) return 0;
+    }
+
+    return 0;
+}
+
+int decodificaSessao(char* arquivo, int quadro) {
+    FILE* sessaoFile = fopen(arquivo, "rb");
+
+    if (sessaoFile == NULL) {
+        printf("ERRO: Nao foi possivel abrir o registro de sessao '%s'\n", arquivo);
+        return 0;
+    }
+
+    static tMapa mapa;
+    char assinatura[4];
+    uint32_t cabecalho[3];
+    int i;
+
+    if (fread(assinatura, 1, 4, sessaoFile) != 4 || memcmp(assinatura, "PMSL", 4) != 0 ||
+        fread(cabecalho, sizeof(uint32_t), 3, sessaoFile) != 3 || cabecalho[0] != 1 ||
+        cabecalho[1] > MAX_LINHAS || cabecalho[2] > MAX_COLUNAS) {
+        printf("ERRO: '%s' nao eh um registro de sessao valido\n", arquivo);
+        fclose(sessaoFile);
+        return 0;
+    }
+
+    mapa.linhas = cabecalho[1];
+    mapa.colunas = cabecalho[2];
     for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            if (mapa.mapa[i][j] == '#') continue;
+        if (fread(mapa.mapa[i], 1, mapa.colunas, sessaoFile) != (size_t)mapa.colunas) {
+            printf("ERRO: Registro de sessao '%s' incompleto\n", arquivo);
+            fclose(sessaoFile);
+            return 0;
+        }
+    }
+
+    int tipo, atual = 0, pontos = 0, encontrado = quadro < 0, valido = 1;
+
+    while (valido && (tipo = fgetc(sessaoFile)) != EOF) {
+        unsigned long long valor, qtd, intervalo;
 
-            mapa.mapa[i][j] = ' ';
+        if (tipo == 'F') {
+            int direcao = fgetc(sessaoFile);
+            if (direcao == EOF || !leVarint(sessaoFile, &valor) || !leVarint(sessaoFile, &qtd)) {
+                valido = 0;
+                break;
+            }
+
+            pontos += valor % 2 ? -(int)((valor + 1) / 2) : (int)(valor / 2);
+
+            // Uma celula invalida desalinharia todos os blocos seguintes
+            long long posicao = -1;
+            unsigned long long k;
+            for (k = 0; k < qtd && valido; k++) {
+                int celula = EOF;
+
+                if (leVarint(sessaoFile, &intervalo)) {
+                    posicao += intervalo + 1;
+                    celula = fgetc(sessaoFile);
+                }
+
+                if (celula == EOF || posicao >= mapa.linhas * mapa.colunas) {
+                    valido = 0;
+                } else {
+                    mapa.mapa[posicao / mapa.colunas][posicao % mapa.colunas] = celula;
+                }
+            }
+            if (!valido) break;
 
-            if (temComidaNaPosicao(j, i, jogo.qtd_inicial_comidas, jogo.comidas)) {
-                mapa.mapa[i][j] = '*';
-            } else if (temPortalNaPosicao(j, i, jogo.portais)) {
-                mapa.mapa[i][j] = '@';
+            if (quadro < 0 || quadro == atual) {
+                printf("Estado do jogo apos o movimento '%c':\n", direcao);
+                printMapa(mapa);
+                printf("Pontuacao: %d\n\n", pontos);
+                encontrado = 1;
             }
 
-            if (jogo.pacman.x == j && jogo.pacman.y == i && !temFantasmaNaPosicao(j, i, jogo.fantasmas)) {
-                mapa.mapa[i][j] = '>';
-                mapa.trilha[i][j] = jogo.pacman.mov_atual;
+            if (quadro == atual) break;
+            atual++;
+        } else if (tipo == 'E') {
+            int resultado = fgetc(sessaoFile);
+            if (resultado == EOF || !leVarint(sessaoFile, &valor)) {
+                valido = 0;
+                break;
             }
 
-            if (temFantasmaNaPosicao(j, i, jogo.fantasmas)) {
-                mapa.mapa[i][j] = temFantasmaNaPosicao(j, i, jogo.fantasmas);
+            if (quadro < 0) {
+                printf("%s\n", resultado == 1 ? "Voce venceu!" : "Game over!");
+                printf("Pontuacao final: %llu\n", valor);
             }
+        } else {
+            valido = 0;
         }
     }
 
-    return mapa;
+    fclose(sessaoFile);
+
+    if (!valido) {
+        printf("ERRO: Registro de sessao '%s' corrompido no estado %d\n", arquivo, atual);
+        return 0;
+    }
+
+    if (!encontrado) {
+        printf("ERRO: O registro tem apenas %d estado(s)\n", atual);
+        return 0;
+    }
+
+    return 1;
 }
 
-tJogo criaTrilha(tJogo jogo) {
-    int i, j;
-    tMapa mapa = jogo.mapa;
 
-    for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            if (mapa.mapa[i][j] == '>') {
-                mapa.trilha[i][j] = 0;
-            } else {
-                mapa.trilha[i][j] = -1;
+///////////////////////////////////// FUNCOES DA JANELA //////////////////////////////
+void fprintJanela(const tJogo* jogo, FILE* saidaFile) {
+    const tMapa* mapa = &jogo->mapa;
+    int linhas = jogo->opcoes.janela_linhas < mapa->linhas ? jogo->opcoes.janela_linhas : mapa->linhas;
+    int colunas = jogo->opcoes.janela_colunas < mapa->colunas ? jogo->opcoes.janela_colunas : mapa->colunas;
+
+    // Centraliza no Pacman e encosta na borda quando ele esta perto dela
+    int topo = jogo->pacman.y - linhas / 2;
+    int esquerda = jogo->pacman.x - colunas / 2;
+
+    if (topo > mapa->linhas - linhas) topo = mapa->linhas - linhas;
+    if (topo < 0) topo = 0;
+    if (esquerda > mapa->colunas - colunas) esquerda = mapa->colunas - colunas;
+    if (esquerda < 0) esquerda = 0;
+
+    if (linhas < mapa->linhas || colunas < mapa->colunas) {
+        fprintf(saidaFile, "Linhas %d a %d e colunas %d a %d de %dx%d:\n", topo + 1, topo + linhas,
+                esquerda + 1, esquerda + colunas, mapa->linhas, mapa->colunas);
+    }
+
+    int i;
+    for (i = topo; i < topo + linhas; i++) {
+        fwrite(&mapa->mapa[i][esquerda], 1, colunas, saidaFile);
+        fputc('\n', saidaFile);
+    }
+}
+
+void fprintMinimapa(const tJogo* jogo, FILE* saidaFile) {
+    const tMapa* mapa = &jogo->mapa;
+    int fator = jogo->opcoes.minimapa;
+    int linhas = (mapa->linhas + fator - 1) / fator;
+    int colunas = (mapa->colunas + fator - 1) / fator;
+    char linha[MAX_COLUNAS + 1];
+    int prioridades[MAX_COLUNAS];
+    int i, j, k;
+
+    fprintf(saidaFile, "Minimapa (1:%d):\n", fator);
+
+    for (i = 0; i < linhas; i++) {
+        memset(linha, '#', colunas);
+        for (j = 0; j < colunas; j++) prioridades[j] = 0;
+
+        // A prioridade do caractere escolhido fica guardada, para calcular uma por celula
+        for (k = i * fator; k < (i + 1) * fator && k < mapa->linhas; k++) {
+            for (j = 0; j < mapa->colunas; j++) {
+                char c = mapa->mapa[k][j];
+                int prioridade = prioridadeMinimapa(c);
+
+                if (prioridade > prioridades[j / fator]) {
+                    linha[j / fator] = c;
+                    prioridades[j / fator] = prioridade;
+                }
             }
         }
+
+        linha[colunas] = '\n';
+        fwrite(linha, 1, colunas + 1, saidaFile);
     }
+}
 
-    jogo.mapa = mapa;
+int prioridadeMinimapa(char c) {
+    if (c == '#') return 0;
+    if (c == ' ') return 1;
+    if (c == '*') return 2;
+    if (c == '@') return 3;
+    if (c == '>') return 5;
 
-    return jogo;
+    // Qualquer outra letra eh um fantasma
+    return 4;
 }
 
-void fprintMapa(tMapa mapa, FILE* saidaFile) {
-    int i, j;
 
-    for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            fprintf(saidaFile, "%c", mapa.mapa[i][j]);
-        }
-        fprintf(saidaFile, "\n");
+//////////////////////////////// FUNCOES DA ANTECIPACAO ///////////////////////////////
+tAntecipacao* criaAntecipacao() {
+    tAntecipacao* antecipacao = calloc(1, sizeof(tAntecipacao));
+
+    if (antecipacao == NULL) {
+        printf("ERRO: Memoria insuficiente para antecipar as jogadas\n");
+        exit(1);
+    }
+
+    int i;
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        antecipacao->sucessores[i] = &antecipacao->estados[i];
+    }
+
+    pthread_mutex_init(&antecipacao->trava, NULL);
+    pthread_cond_init(&antecipacao->mudou, NULL);
+
+    if (pthread_create(&antecipacao->thread, NULL, executaAntecipacao, antecipacao) != 0) {
+        printf("ERRO: Nao foi possivel iniciar a thread de antecipacao\n");
+        exit(1);
     }
+
+    return antecipacao;
 }
 
-void printMapa(tMapa mapa) {
-    int i, j;
+void antecipaJogadas(tAntecipacao* antecipacao, const tJogo* jogo) {
+    pthread_mutex_lock(&antecipacao->trava);
 
-    for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            printf("%c", mapa.mapa[i][j]);
-        }
-        printf("\n");
+    // A base so pode ser trocada com a thread parada
+    while (antecipacao->atendidos != antecipacao->pedidos) {
+        pthread_cond_wait(&antecipacao->mudou, &antecipacao->trava);
     }
+
+    antecipacao->base = *jogo;
+    antecipacao->prontos = 0;
+    antecipacao->pedidos++;
+
+    pthread_cond_broadcast(&antecipacao->mudou);
+    pthread_mutex_unlock(&antecipacao->trava);
 }
 
+int obtemJogadaAntecipada(tAntecipacao* antecipacao, char comando, tJogo** jogo) {
+    const char* direcoes = "wasd";
+    const char* direcao = comando != '\0' ? strchr(direcoes, comando) : NULL;
 
-////////////////////////////////// FUNCOES DO PACMAN /////////////////////////////////
-tPacman criaPacman(tJogo jogo) {
-    int i, j;
+    if (direcao == NULL) return -1;
 
-    for (i = 0; i < jogo.mapa.linhas; i++) {
-        for (j = 0; j < jogo.mapa.colunas; j++) {
-            char posicao = jogo.mapa.mapa[i][j];
+    int indice = direcao - direcoes;
 
-            if (posicao == '>') {
-                tPacman pacman = { 0 };
+    pthread_mutex_lock(&antecipacao->trava);
+    while (antecipacao->prontos <= indice) {
+        pthread_cond_wait(&antecipacao->mudou, &antecipacao->trava);
+    }
+    pthread_mutex_unlock(&antecipacao->trava);
 
-                pacman.y = i;
-                pacman.x = j;
-                pacman.pontos = 0;
-                pacman.movs_restantes = jogo.mapa.lim_movs;
-                pacman.mov_atual = 0;
-                pacman.colidiu_com_parede = 0;
-                pacman.colidiu_com_fantasma = 0;
-                pacman.colidiu_com_comida = 0;
-                pacman.colidiu_com_portal = 0;
+    // A thread nao volta a este sucessor ate o proximo pedido, entao o buffer do estado
+    // anterior pode ocupar o lugar dele
+    tJogo* anterior = *jogo;
+    *jogo = antecipacao->sucessores[indice];
+    antecipacao->sucessores[indice] = anterior;
 
-                return pacman;
+    return indice;
+}
+
+void printJogadaAntecipada(tAntecipacao* antecipacao, int direcao, const tJogo* jogo) {
+    fwrite(antecipacao->textos[direcao], 1, antecipacao->tamanhos[direcao], stdout);
+
+    registraQuadroSessao(jogo);
+}
+
+void* executaAntecipacao(void* arg) {
+    tAntecipacao* antecipacao = arg;
+    const char direcoes[QTD_MOVIMENTOS] = { 'w', 'a', 's', 'd' };
+
+    pthread_mutex_lock(&antecipacao->trava);
+
+    while (1) {
+        while (!antecipacao->encerrar && antecipacao->atendidos == antecipacao->pedidos) {
+            pthread_cond_wait(&antecipacao->mudou, &antecipacao->trava);
+        }
+
+        if (antecipacao->encerrar) break;
+
+        pthread_mutex_unlock(&antecipacao->trava);
+
+        int i;
+        for (i = 0; i < QTD_MOVIMENTOS; i++) {
+            *antecipacao->sucessores[i] = antecipacao->base;
+            executaJogada(antecipacao->sucessores[i], direcoes[i]);
+
+            free(antecipacao->textos[i]);
+            FILE* textoFile = open_memstream(&antecipacao->textos[i], &antecipacao->tamanhos[i]);
+
+            if (textoFile == NULL) {
+                printf("ERRO: Memoria insuficiente para antecipar as jogadas\n");
+                exit(1);
             }
+
+            fprintEstadoJogo(antecipacao->sucessores[i], textoFile);
+            fclose(textoFile);
+
+            pthread_mutex_lock(&antecipacao->trava);
+            antecipacao->prontos = i + 1;
+            pthread_cond_broadcast(&antecipacao->mudou);
+            pthread_mutex_unlock(&antecipacao->trava);
         }
+
+        pthread_mutex_lock(&antecipacao->trava);
+        antecipacao->atendidos = antecipacao->pedidos;
+        pthread_cond_broadcast(&antecipacao->mudou);
     }
+
+    pthread_mutex_unlock(&antecipacao->trava);
+
+    return NULL;
 }
 
-tPacman movePacman(tJogo jogo) {
-    tPacman pacman = jogo.pacman;
+void encerraAntecipacao(tAntecipacao* antecipacao, const tJogo* atual, tJogo* jogo) {
+    int i;
 
-    pacman.mov_atual++;
-    pacman.movs_restantes--;
+    pthread_mutex_lock(&antecipacao->trava);
+    antecipacao->encerrar = 1;
+    pthread_cond_broadcast(&antecipacao->mudou);
+    pthread_mutex_unlock(&antecipacao->trava);
+    pthread_join(antecipacao->thread, NULL);
 
-    int new_x = pacman.x;
-    int new_y = pacman.y;
+    // Uma unica copia no fim da partida, com a thread ja parada: o buffer de 'jogo'
+    // pode ter sido usado como sucessor
+    if (atual != jogo) *jogo = *atual;
 
-    if (pacman.direcao == 'w') {
-        new_y--;
-    } else if (pacman.direcao == 'a') {
-        new_x--;
-    } else if (pacman.direcao == 's') {
-        new_y++;
-    } else if (pacman.direcao == 'd') {
-        new_x++;
+    for (i = 0; i < QTD_MOVIMENTOS; i++) {
+        free(antecipacao->textos[i]);
     }
 
-    if (jogo.mapa.mapa[new_y][new_x] != '#') {
-        if (!jogo.trocaram_posicao) {
-            pacman.x = new_x;
-            pacman.y = new_y;
+    pthread_mutex_destroy(&antecipacao->trava);
+    pthread_cond_destroy(&antecipacao->mudou);
+    free(antecipacao);
+}
+
+
+////////////////////////////////////// FUNCOES DO LOTE ///////////////////////////////
+int coordenaLote(char* manifesto, char* saida, int qtd_trabalhadores, int tam_fatia, char* caminho_socket) {
+    static tLote lote;
+    char (*linhas)[MAX_DIR_SIZE];
+    int i;
+
+    lote.qtd_tarefas = leLista(manifesto, &linhas, "partidas");
+    lote.tam_fatia = tam_fatia > 0 ? tam_fatia : TAM_FATIA_LOTE;
+    lote.qtd_fatias = (lote.qtd_tarefas + lote.tam_fatia - 1) / lote.tam_fatia;
+
+    lote.tarefas = calloc(lote.qtd_tarefas, sizeof(tTarefaLote));
+    lote.resultados = calloc(lote.qtd_tarefas, sizeof(tResultadoLote));
+    lote.recebido = calloc(lote.qtd_tarefas, sizeof(int));
+    lote.tentativas = calloc(lote.qtd_tarefas, sizeof(int));
+    lote.fila = malloc(lote.qtd_fatias * sizeof(int));
+
+    if (lote.tarefas == NULL || lote.resultados == NULL || lote.recebido == NULL || lote.tentativas == NULL || lote.fila == NULL) {
+        printf("ERRO: Memoria insuficiente para o lote\n");
+        exit(1);
+    }
+
+    for (i = 0; i < lote.qtd_tarefas; i++) {
+        lote.tarefas[i].indice = i;
+
+        if (sscanf(linhas[i], "%1000s %1000s", lote.tarefas[i].dir, lote.tarefas[i].jogadas) != 2) {
+            printf("ERRO: A linha '%s' do manifesto deve ter o diretorio do mapa e o arquivo de jogadas\n", linhas[i]);
+            exit(1);
         }
-        pacman.colidiu_com_parede = 0;
-    } else {
-        pacman.colidiu_com_parede = 1;
     }
+    free(linhas);
 
-    return pacman;
+    for (i = 0; i < lote.qtd_fatias; i++) {
+        lote.fila[i] = i;
+    }
+    lote.qtd_fila = lote.qtd_fatias;
+
+    struct sockaddr_un endereco = { 0 };
+    endereco.sun_family = AF_UNIX;
+    snprintf(endereco.sun_path, sizeof(endereco.sun_path), "%s", caminho_socket);
+
+    int escuta = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(caminho_socket);
+
+    if (escuta < 0 || bind(escuta, (struct sockaddr*)&endereco, sizeof(endereco)) < 0 || listen(escuta, MAX_CONEXOES_LOTE) < 0) {
+        printf("ERRO: Nao foi possivel abrir o socket '%s'\n", caminho_socket);
+        exit(1);
+    }
+
+    // Um trabalhador que cai no meio de uma escrita nao pode derrubar o coordenador
+    signal(SIGPIPE, SIG_IGN);
+
+    int vivos = 0, reinicios = 0;
+    int limite_reinicios = qtd_trabalhadores + MAX_TENTATIVAS_LOTE * lote.qtd_tarefas;
+
+    for (i = 0; i < qtd_trabalhadores; i++) {
+        if (iniciaTrabalhadorLote(caminho_socket) > 0) vivos++;
+    }
+
+    if (qtd_trabalhadores == 0) {
+        printf("Aguardando trabalhadores em '%s'\n", caminho_socket);
+        fflush(stdout);
+    }
+
+    while (lote.concluidas < lote.qtd_tarefas) {
+        struct pollfd eventos[MAX_CONEXOES_LOTE + 1];
+        int qtd_eventos = 0;
+
+        eventos[qtd_eventos].fd = escuta;
+        eventos[qtd_eventos++].events = POLLIN;
+        for (i = 0; i < lote.qtd_conexoes; i++) {
+            eventos[qtd_eventos].fd = lote.conexoes[i].fd;
+            eventos[qtd_eventos++].events = POLLIN;
+        }
+
+        // O tempo limite serve para recolher os trabalhadores que terminaram
+        poll(eventos, qtd_eventos, 100);
+
+        // As conexoes sao percorridas de tras para frente porque derrubar uma move a ultima
+        for (i = lote.qtd_conexoes - 1; i >= 0; i--) {
+            if (eventos[i + 1].revents == 0) continue;
+
+            if (!trataMensagemLote(&lote, &lote.conexoes[i])) {
+                derrubaConexaoLote(&lote, i);
+            }
+        }
+
+        if ((eventos[0].revents & POLLIN) && lote.qtd_conexoes < MAX_CONEXOES_LOTE) {
+            int fd = accept(escuta, NULL, NULL);
+
+            if (fd >= 0) {
+                tConexaoLote conexao = { fd, -1, 0 };
+                lote.conexoes[lote.qtd_conexoes++] = conexao;
+            }
+        }
+
+        distribuiFatias(&lote);
+
+        // Cada trabalhador iniciado aqui que termina antes do fim do lote eh substituido
+        int status;
+        while (waitpid(-1, &status, WNOHANG) > 0) {
+            vivos--;
+
+            if (lote.concluidas < lote.qtd_tarefas && reinicios < limite_reinicios) {
+                if (iniciaTrabalhadorLote(caminho_socket) > 0) vivos++;
+                reinicios++;
+            }
+        }
+
+        if (qtd_trabalhadores > 0 && vivos == 0 && lote.qtd_conexoes == 0 && lote.concluidas < lote.qtd_tarefas) {
+            printf("ERRO: Todos os trabalhadores cairam e o limite de reinicios foi atingido\n");
+            break;
+        }
+    }
+
+    distribuiFatias(&lote);
+
+    for (i = 0; i < lote.qtd_conexoes; i++) {
+        close(lote.conexoes[i].fd);
+    }
+    lote.qtd_conexoes = 0;
+
+    close(escuta);
+    unlink(caminho_socket);
+
+    while (vivos > 0 && wait(NULL) > 0) {
+        vivos--;
+    }
+
+    geraSaidasLote(&lote, saida);
+
+    int falhas = lote.qtd_tarefas;
+    for (i = 0; i < lote.qtd_tarefas; i++) {
+        if (lote.recebido[i] && lote.resultados[i].situacao) falhas--;
+    }
+
+    printf("Lote: %d partidas, %d falhas, %d trabalhadores reiniciados\n", lote.qtd_tarefas, falhas, reinicios);
+
+    free(lote.tarefas);
+    free(lote.resultados);
+    free(lote.recebido);
+    free(lote.tentativas);
+    free(lote.fila);
+
+    return falhas > 0;
 }
 
-tPacman verificaColisaoPacman(tJogo jogo) {
-    tPacman pacman = jogo.pacman;
+int trabalhaLote(char* caminho_socket) {
+    struct sockaddr_un endereco = { 0 };
+    endereco.sun_family = AF_UNIX;
+    snprintf(endereco.sun_path, sizeof(endereco.sun_path), "%s", caminho_socket);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (fd < 0 || connect(fd, (struct sockaddr*)&endereco, sizeof(endereco)) < 0) {
+        printf("ERRO: Nao foi possivel conectar ao coordenador em '%s'\n", caminho_socket);
+        return 1;
+    }
+
+    tTarefaLote* tarefas = malloc(TAM_FATIA_LOTE * sizeof(tTarefaLote));
+    int capacidade = TAM_FATIA_LOTE;
+
+    if (tarefas == NULL) {
+        printf("ERRO: Memoria insuficiente para o trabalhador\n");
+        exit(1);
+    }
+
+    while (1) {
+        tMensagemLote mensagem = { LOTE_PEDIDO, 0 };
+        int i;
+
+        if (!escreveTudo(fd, &mensagem, sizeof(mensagem)) || !leTudo(fd, &mensagem, sizeof(mensagem))) break;
+        if (mensagem.tipo != LOTE_FATIA) break;
+
+        if (mensagem.qtd > capacidade) {
+            capacidade = mensagem.qtd;
+            tarefas = realloc(tarefas, capacidade * sizeof(tTarefaLote));
+
+            if (tarefas == NULL) {
+                printf("ERRO: Memoria insuficiente para o trabalhador\n");
+                exit(1);
+            }
+        }
+
+        if (!leTudo(fd, tarefas, mensagem.qtd * sizeof(tTarefaLote))) break;
 
-    pacman.colidiu_com_fantasma = 0;
-    pacman.colidiu_com_comida = 0;
-    pacman.colidiu_com_portal = 0;
+        // Cada resultado vai assim que a partida acaba, para que uma queda perca pouco
+        for (i = 0; i < mensagem.qtd; i++) {
+            tResultadoLote resultado;
+            tMensagemLote aviso = { LOTE_RESULTADO, 1 };
 
-    if (temFantasmaNaPosicao(pacman.x, pacman.y, jogo.fantasmas) || jogo.trocaram_posicao) {
-        pacman.colidiu_com_fantasma = 1;
-    } else if (temComidaNaPosicao(pacman.x, pacman.y, jogo.qtd_inicial_comidas, jogo.comidas)) {
-        pacman.colidiu_com_comida = 1;
-    }
+            jogaTarefaLote(&tarefas[i], &resultado);
 
-    if (temPortalNaPosicao(pacman.x, pacman.y, jogo.portais)) {
-        pacman.colidiu_com_portal = 1;
+            if (!escreveTudo(fd, &aviso, sizeof(aviso)) || !escreveTudo(fd, &resultado, sizeof(resultado))) break;
+        }
     }
 
-    return pacman;
-}
+    free(tarefas);
+    close(fd);
 
-int temPacmanNaPosicao(int x, int y, tPacman pacman) {
-    return (x == pacman.x && y == pacman.y);
+    return 0;
 }
 
+void jogaTarefaLote(const tTarefaLote* tarefa, tResultadoLote* resultado) {
+    static tJogo jogo;
+    char erro[MAX_DIR_SIZE + 64];
+    char dir[MAX_DIR_SIZE];
 
-//////////////////////////////// FUNCOES DOS FANTASMAS ///////////////////////////////
-tJogo criaFantasmas(tJogo jogo) {
-    int i, j, idx = 0;
+    memset(resultado, 0, sizeof(tResultadoLote));
+    resultado->indice = tarefa->indice;
 
-    for (i = 0; i < jogo.mapa.linhas; i++) {
-        for (j = 0; j < jogo.mapa.colunas; j++) {
-            char posicao = jogo.mapa.mapa[i][j];
+    // O mapa eh conferido antes porque carregaJogo encerra o programa em caso de erro
+    strcpy(dir, tarefa->dir);
+    if (!leMapa(dir, &jogo.mapa, erro)) return;
 
-            if (posicao == 'B' || posicao == 'P' || posicao == 'I' || posicao == 'C') {
-                tFantasma fantasma = { 0 };
+    FILE* jogadasFile = fopen(tarefa->jogadas, "r");
+    if (jogadasFile == NULL) return;
 
-                fantasma.x = j;
-                fantasma.y = i;
-                fantasma.existe = 1;
-                fantasma.tipo = posicao;
-                fantasma.colidiu_com_parede = 0;
-                fantasma.colidiu_com_portal = 0;
+    jogo = carregaJogo(dir);
+    verificaJogoImpossivel(&jogo);
 
-                if (fantasma.tipo == 'B') fantasma.direcao = 'a';
-                else if (fantasma.tipo == 'P') fantasma.direcao = 'w';
-                else if (fantasma.tipo == 'I') fantasma.direcao = 's';
-                else if (fantasma.tipo == 'C') fantasma.direcao = 'd';
+    while (resultadoJogo(&jogo) == 0) {
+        char direcao = jogo.pacman.direcao;
 
-                jogo.fantasmas[idx] = fantasma;
+        if (fscanf(jogadasFile, " %c", &direcao) != 1) direcao = jogo.pacman.direcao;
 
-                idx++;
-            }
-        }
+        executaJogada(&jogo, direcao);
     }
 
-    return jogo;
+    fclose(jogadasFile);
+
+    resultado->situacao = 1;
+    resultado->resultado = resultadoJogo(&jogo);
+    resultado->pontos = jogo.pacman.pontos;
+    memcpy(resultado->estatisticas, jogo.estatistica_movs, sizeof(resultado->estatisticas));
 }
 
-tJogo moveFantasmas(tJogo jogo) {
-    int i;
+pid_t iniciaTrabalhadorLote(char* caminho_socket) {
+    fflush(stdout);
 
-    for (i = 0; i < QTD_FANTASMAS; i++) {
-        if (!jogo.fantasmas[i].existe) continue;
+    pid_t pid = fork();
 
-        tFantasma fantasma = jogo.fantasmas[i];
+    if (pid == 0) {
+        execl("/proc/self/exe", "pacman", "--trabalhador-lote", caminho_socket, (char*)NULL);
+        _exit(127);
+    }
 
-        int new_x = fantasma.x;
-        int new_y = fantasma.y;
+    if (pid < 0) {
+        printf("ERRO: Nao foi possivel iniciar um trabalhador\n");
+    }
 
-        fantasma.colidiu_com_parede = 0;
-        fantasma.colidiu_com_portal = 0;
+    return pid;
+}
 
-        if (fantasma.direcao == 'w') {
-            new_y--;
-        } else if (fantasma.direcao == 'a') {
-            new_x--;
-        } else if (fantasma.direcao == 's') {
-            new_y++;
-        } else if (fantasma.direcao == 'd') {
-            new_x++;
-        }
+int trataMensagemLote(tLote* lote, tConexaoLote* conexao) {
+    tMensagemLote mensagem;
 
-        char prox_celula = jogo.mapa.mapa[new_y][new_x];
+    if (!leTudo(conexao->fd, &mensagem, sizeof(mensagem))) return 0;
 
-        if (prox_celula != '#' && prox_celula != '@') {
-            fantasma.x = new_x;
-            fantasma.y = new_y;
-        } else if (prox_celula == '#') {
-            fantasma.colidiu_com_parede = 1;
-        } else if (prox_celula == '@') {
-            fantasma.colidiu_com_portal = 1;
-        }
+    if (mensagem.tipo == LOTE_PEDIDO) {
+        conexao->fatia = -1;
+        conexao->esperando = 1;
+        return 1;
+    }
 
-        if (fantasma.colidiu_com_parede || fantasma.colidiu_com_portal) {
+    if (mensagem.tipo != LOTE_RESULTADO) return 0;
 
-            if (fantasma.direcao == 'w') {
-                fantasma.direcao = 's';
-                fantasma.y++;
-            } else if (fantasma.direcao == 's') {
-                fantasma.direcao = 'w';
-                fantasma.y--;
-            } else if (fantasma.direcao == 'a') {
-                fantasma.direcao = 'd';
-                fantasma.x++;
-            } else if (fantasma.direcao == 'd') {
-                fantasma.direcao = 'a';
-                fantasma.x--;
-            }
-        }
+    tResultadoLote resultado;
+
+    if (!leTudo(conexao->fd, &resultado, sizeof(resultado))) return 0;
+    if (resultado.indice < 0 || resultado.indice >= lote->qtd_tarefas) return 0;
 
-        jogo.fantasmas[i] = fantasma;
+    // Uma fatia refeita pode devolver de novo uma partida que ja tinha chegado
+    if (!lote->recebido[resultado.indice]) {
+        lote->resultados[resultado.indice] = resultado;
+        lote->recebido[resultado.indice] = 1;
+        lote->concluidas++;
     }
 
-    return jogo;
+    return 1;
 }
 
-char temFantasmaNaPosicao(int x, int y, tFantasma fantasmas[QTD_FANTASMAS]) {
-    int i;
+void distribuiFatias(tLote* lote) {
+    int i, j;
 
-    for (i = 0; i < QTD_FANTASMAS; i++) {
-        if (!fantasmas[i].existe) continue;
+    for (i = 0; i < lote->qtd_conexoes; i++) {
+        tConexaoLote* conexao = &lote->conexoes[i];
 
-        if (fantasmas[i].x == x && fantasmas[i].y == y) {
-            return fantasmas[i].tipo;
-        }
-    }
+        if (!conexao->esperando) continue;
 
-    return '\0';
-}
+        if (lote->concluidas == lote->qtd_tarefas) {
+            tMensagemLote fim = { LOTE_FIM, 0 };
 
+            escreveTudo(conexao->fd, &fim, sizeof(fim));
+            conexao->esperando = 0;
+            continue;
+        }
 
-///////////////////////////////// FUNCOES DAS COMIDAS ////////////////////////////////
-tJogo criaComidas(tJogo jogo) {
-    int i, j;
+        if (lote->qtd_fila == 0) continue;
 
-    jogo.qtd_inicial_comidas = 0;
-    jogo.comidas_restantes = 0;
+        int fatia = lote->fila[lote->inicio_fila];
+        lote->inicio_fila = (lote->inicio_fila + 1) % lote->qtd_fatias;
+        lote->qtd_fila--;
 
-    for (i = 0; i < jogo.mapa.linhas; i++) {
-        for (j = 0; j < jogo.mapa.colunas; j++) {
-            char posicao = jogo.mapa.mapa[i][j];
+        // Apenas as partidas da fatia que ainda nao voltaram sao mandadas
+        tTarefaLote tarefas[TAM_FATIA_LOTE];
+        tTarefaLote* pendentes = lote->tam_fatia > TAM_FATIA_LOTE ? malloc(lote->tam_fatia * sizeof(tTarefaLote)) : tarefas;
+        tMensagemLote mensagem = { LOTE_FATIA, 0 };
 
-            if (posicao == '*') {
-                tComida comida = { 0 };
+        if (pendentes == NULL) {
+            printf("ERRO: Memoria insuficiente para o lote\n");
+            exit(1);
+        }
 
-                comida.x = j;
-                comida.y = i;
-                comida.foi_comida = 0;
+        for (j = fatia * lote->tam_fatia; j < (fatia + 1) * lote->tam_fatia && j < lote->qtd_tarefas; j++) {
+            if (!lote->recebido[j]) pendentes[mensagem.qtd++] = lote->tarefas[j];
+        }
 
-                jogo.comidas[jogo.qtd_inicial_comidas] = comida;
-                jogo.qtd_inicial_comidas++;
-                jogo.comidas_restantes++;
-            }
+        conexao->fatia = fatia;
+        conexao->esperando = 0;
+
+        // Se o envio falhar, a queda eh tratada quando a conexao for lida
+        if (escreveTudo(conexao->fd, &mensagem, sizeof(mensagem))) {
+            escreveTudo(conexao->fd, pendentes, mensagem.qtd * sizeof(tTarefaLote));
         }
-    }
 
-    return jogo;
+        if (pendentes != tarefas) free(pendentes);
+    }
 }
 
-tJogo comeComida(int x, int y, tJogo jogo) {
-    int i;
+void derrubaConexaoLote(tLote* lote, int indice) {
+    tConexaoLote* conexao = &lote->conexoes[indice];
+    int fatia = conexao->fatia;
 
-    for (i = 0; i < jogo.qtd_inicial_comidas; i++) {
-        tComida comida = jogo.comidas[i];
+    close(conexao->fd);
+    lote->conexoes[indice] = lote->conexoes[--lote->qtd_conexoes];
+
+    if (fatia < 0) return;
+
+    int j, pendentes = 0;
+    int inicio = fatia * lote->tam_fatia;
+    int fim = inicio + lote->tam_fatia < lote->qtd_tarefas ? inicio + lote->tam_fatia : lote->qtd_tarefas;
 
-        if (comida.x == x && comida.y == y) {
-            comida.x = -1;
-            comida.y = -1;
-            comida.foi_comida = 1;
+    // O trabalhador joga a fatia em ordem, entao caiu na primeira partida pendente
+    for (j = inicio; j < fim; j++) {
+        if (lote->recebido[j]) continue;
 
-            jogo.comidas[i] = comida;
-            jogo.comidas_restantes--;
+        if (pendentes == 0 && ++lote->tentativas[j] >= MAX_TENTATIVAS_LOTE) {
+            printf("ERRO: A partida %d ('%s') derrubou o trabalhador %d vezes e foi descartada\n", j, lote->tarefas[j].dir, MAX_TENTATIVAS_LOTE);
 
-            return jogo;
+            lote->resultados[j].indice = j;
+            lote->recebido[j] = 1;
+            lote->concluidas++;
+            continue;
         }
+
+        pendentes++;
     }
 
-    return jogo;
+    if (pendentes > 0) {
+        lote->fila[(lote->inicio_fila + lote->qtd_fila) % lote->qtd_fatias] = fatia;
+        lote->qtd_fila++;
+    }
 }
 
-int temComidaNaPosicao(int x, int y, int qtd_inicial_comidas, tComida comidas[qtd_inicial_comidas]) {
-    int i;
+void geraSaidasLote(tLote* lote, char* saida) {
+    static tJogo total;
+    char caminho[MAX_DIR_SIZE + 20];
+    char* dados;
+    size_t tamanho;
+    int i, j;
 
-    for (i = 0; i < qtd_inicial_comidas; i++) {
-        if (comidas[i].x == x && comidas[i].y == y) {
-            if (!comidas[i].foi_comida) {
-                return 1;
-            }
+    memset(&total, 0, sizeof(tJogo));
+    strcpy(total.dir, saida);
+    criaEstatisticasMovimentos(&total);
+    criaPastaSaida(saida);
+
+    FILE* csvFile = open_memstream(&dados, &tamanho);
+    fprintf(csvFile, "partida,mapa,jogadas,situacao,resultado,pontos,movimentos\n");
+
+    for (i = 0; i < lote->qtd_tarefas; i++) {
+        tResultadoLote* resultado = &lote->resultados[i];
+        int movimentos = 0;
+
+        for (j = 0; j < QTD_MOVIMENTOS && resultado->situacao; j++) {
+            total.estatistica_movs[j].comidas_pegas += resultado->estatisticas[j].comidas_pegas;
+            total.estatistica_movs[j].colisoes_parede += resultado->estatisticas[j].colisoes_parede;
+            total.estatistica_movs[j].colisoes_apenas_parede += resultado->estatisticas[j].colisoes_apenas_parede;
+            total.estatistica_movs[j].qtd_realizado += resultado->estatisticas[j].qtd_realizado;
+            movimentos += resultado->estatisticas[j].qtd_realizado;
         }
+
+        fprintf(csvFile, "%d,%s,%s,%s,%s,%d,%d\n", i, lote->tarefas[i].dir, lote->tarefas[i].jogadas,
+                resultado->situacao ? "jogada" : "falhou",
+                !resultado->situacao ? "-" : resultado->resultado == 1 ? "vitoria" : "derrota",
+                resultado->pontos, movimentos);
     }
 
-    return 0;
-}
+    fclose(csvFile);
+    sprintf(caminho, "%s/saida/lote.csv", saida);
+    enviaEscrita(caminho, "w", dados, tamanho, "lote.csv", saida, 0);
 
+    geraEstatisticasTxt(&total);
+    geraRankingTxt(&total);
+}
 
-///////////////////////////////// FUNCOES DOS PORTAIS ////////////////////////////////
-tJogo criaPortais(tJogo jogo) {
-    int i, j, idx = 0;
+int leTudo(int fd, void* dados, size_t tamanho) {
+    char* destino = dados;
 
-    for (i = 0; i < jogo.mapa.linhas; i++) {
-        for (j = 0; j < jogo.mapa.colunas; j++) {
-            char posicao = jogo.mapa.mapa[i][j];
+    while (tamanho > 0) {
+        ssize_t lido = read(fd, destino, tamanho);
 
-            if (posicao == '@') {
-                jogo.portais[idx].x = j;
-                jogo.portais[idx].y = i;
+        if (lido <= 0) return 0;
 
-                idx++;
-            }
-        }
+        destino += lido;
+        tamanho -= lido;
     }
 
-    return jogo;
+    return 1;
 }
 
-tPacman teleportaPacman(tPacman pacman, tJogo jogo) {
-    int i;
+int escreveTudo(int fd, const void* dados, size_t tamanho) {
+    const char* origem = dados;
 
-    for (i = 0; i < QTD_PORTAIS; i++) {
-        tPortal portal = jogo.portais[i];
+    while (tamanho > 0) {
+        ssize_t escrito = write(fd, origem, tamanho);
 
-        if (pacman.x == portal.x && pacman.y == portal.y) {
-            if (i == 0) {
-                pacman.x = jogo.portais[1].x;
-                pacman.y = jogo.portais[1].y;
-            } else {
-                pacman.x = jogo.portais[0].x;
-                pacman.y = jogo.portais[0].y;
-            }
+        if (escrito <= 0) return 0;
 
-            return pacman;
-        }
+        origem += escrito;
+        tamanho -= escrito;
     }
 
-    return pacman;
+    return 1;
 }
 
-int temPortalNaPosicao(int x, int y, tPortal portais[QTD_PORTAIS]) {
+
+////////////////////////////////// FUNCOES DO MULTIJOGADOR ////////////////////////////
+int jogaPartidaMulti(char* dir, tOpcoes opcoes) {
+    tPartidaMulti* partida = calloc(1, sizeof(tPartidaMulti));
+    char direcoes[MAX_JOGADORES];
     int i;
 
-    for (i = 0; i < QTD_PORTAIS; i++) {
-        if (portais[i].x == x && portais[i].y == y) {
-            return 1;
-        }
+    if (partida == NULL) {
+        printf("ERRO: Memoria insuficiente para a partida\n");
+        exit(1);
     }
 
-    return 0;
-}
+    // Sem limpaResumo: cada jogador tem o seu resumo, e 'resumo.txt' nao eh criado
+    criaPastaSaida(dir);
+    partida->jogo = carregaJogo(dir);
+    partida->jogo.opcoes = opcoes;
+    partida->cooperativo = (opcoes.multijogador == 1);
 
+    criaJogadoresMulti(partida);
 
-/////////////////////////////////// FUNCOES DO JOGO //////////////////////////////////
-tJogo inicializaJogo(char* dir) {
-    tJogo jogo = { 0 };
+    if (partida->qtd_jogadores == 0) {
+        printf("ERRO: O mapa nao tem nenhum Pac-Man\n");
+        free(partida);
+        return 1;
+    }
 
-    strcpy(jogo.dir, dir);
-    criaPastaSaida(jogo.dir);
-    limpaResumo(jogo.dir);
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        char resumo_nome[40];
+        char resumo_dir[MAX_DIR_SIZE + 48];
+        sprintf(resumo_nome, "resumo_jogador%d.txt", i + 1);
+        sprintf(resumo_dir, "%s/saida/%s", dir, resumo_nome);
+        enviaEscrita(resumo_dir, "w", NULL, 0, resumo_nome, dir, 1);
 
-    jogo.mapa = criaMapa(dir);
-    jogo.pacman = criaPacman(jogo);
-    jogo = criaFantasmas(jogo);
-    jogo = criaComidas(jogo);
-    jogo = criaPortais(jogo);
-    jogo = criaEstatisticasMovimentos(jogo);
-    jogo = criaTrilha(jogo);
+        partida->resumos[i] = open_memstream(&partida->dados_resumos[i], &partida->tamanhos_resumos[i]);
+    }
 
-    return jogo;
-}
+    desenhaJogadoresMulti(partida);
+    printEstadoMulti(partida);
 
-tJogo realizaJogo(tJogo jogo) {
-    printEstadoJogo(jogo);
-    scanf(" %c", &jogo.pacman.direcao);
+    while (!verificaFimMulti(partida)) {
+        leComandosMulti(partida, direcoes);
+        realizaRodadaMulti(partida, direcoes);
+        printEstadoMulti(partida);
+    }
 
-    jogo = moveFantasmas(jogo);
-    jogo.trocaram_posicao = verificaTrocaDePosicao(jogo.pacman, jogo.fantasmas);
-    jogo.pacman = movePacman(jogo);
+    geraTrilhaTxt(&partida->jogo);
 
-    jogo.pacman = verificaColisaoPacman(jogo);
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        enviaResumoMulti(partida, i, 0);
 
-    jogo = atualizaObjetos(jogo);
-    jogo.mapa = atualizaMapa(jogo);
+        partida->jogo.pacman = partida->pacmen[i];
+        memcpy(partida->jogo.estatistica_movs, partida->estatisticas[i], sizeof(partida->estatisticas[i]));
+        snprintf(partida->jogo.sufixo_saida, sizeof(partida->jogo.sufixo_saida), "_jogador%d", i + 1);
 
-    return jogo;
+        geraEstatisticasTxt(&partida->jogo);
+        geraRankingTxt(&partida->jogo);
+    }
+
+    free(partida);
+
+    return 0;
 }
 
-tJogo atualizaObjetos(tJogo jogo) {
-    tPacman pacman = jogo.pacman;
+void criaJogadoresMulti(tPartidaMulti* partida) {
+    tJogo* jogo = &partida->jogo;
+    int i, j;
 
-    if (pacman.colidiu_com_comida) {
-        pacman.pontos++;
-        jogo = comeComida(pacman.x, pacman.y, jogo);
-    } else if (pacman.colidiu_com_portal) {
-        jogo.mapa.trilha[pacman.y][pacman.x] = pacman.mov_atual;
-        pacman = teleportaPacman(pacman, jogo);
-    }
+    for (i = 0; i < jogo->mapa.linhas; i++) {
+        for (j = 0; j < jogo->mapa.colunas && partida->qtd_jogadores < MAX_JOGADORES; j++) {
+            if (jogo->mapa.mapa[i][j] != '>') continue;
 
-    jogo.pacman = pacman;
+            int n = partida->qtd_jogadores++;
 
-    return jogo;
+            // O primeiro jogador eh o Pacman criado com o jogo; os demais sao copias dele
+            partida->pacmen[n] = jogo->pacman;
+            partida->pacmen[n].x = j;
+            partida->pacmen[n].y = i;
+            memcpy(partida->estatisticas[n], jogo->estatistica_movs, sizeof(partida->estatisticas[n]));
+            partida->ativo[n] = 1;
+        }
+    }
 }
 
-void printEstadoJogo(tJogo jogo) {
-    printf("Estado do jogo apos o movimento '%c':\n", jogo.pacman.direcao);
-    printMapa(jogo.mapa);
-    printf("Pontuacao: %d\n\n", jogo.pacman.pontos);
-}
+void leComandosMulti(tPartidaMulti* partida, char* direcoes) {
+    static char* linha = NULL;
+    static size_t capacidade = 0;
+    int i, n = 0;
 
-int verificaFimDeJogo(tJogo jogo) {
-    int venceu = 0;
-    tPacman pacman = jogo.pacman;
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        direcoes[i] = partida->pacmen[i].direcao;
+    }
 
-    if (jogo.comidas_restantes == 0) venceu = 1;
-    if (pacman.movs_restantes == 0) venceu = -1;
-    if (pacman.colidiu_com_fantasma) venceu = -1;
+    if (getline(&linha, &capacidade, stdin) < 0) return;
 
-    if (venceu == 1) {
-        printf("Voce venceu!\n");
-        printf("Pontuacao final: %d\n", pacman.pontos);
-    } else if (venceu == -1) {
-        printf("Game over!\n");
-        printf("Pontuacao final: %d\n", pacman.pontos);
-    }
+    for (i = 0; linha[i] != '\0' && n < partida->qtd_jogadores; i++) {
+        if (linha[i] == ' ' || linha[i] == '\t' || linha[i] == '\r' || linha[i] == '\n') continue;
 
-    return venceu;
+        direcoes[n++] = linha[i];
+    }
 }
 
-int verificaTrocaDePosicao(tPacman pacman, tFantasma fantasmas[QTD_FANTASMAS]) {
-    int i;
-    char direcao_oposta;
+void realizaRodadaMulti(tPartidaMulti* partida, const char* direcoes) {
+    tJogo* jogo = &partida->jogo;
+    int i, k;
 
-    direcao_oposta = pacman.direcao == 'w' ? 's' : direcao_oposta;
-    direcao_oposta = pacman.direcao == 'a' ? 'd' : direcao_oposta;
-    direcao_oposta = pacman.direcao == 's' ? 'w' : direcao_oposta;
-    direcao_oposta = pacman.direcao == 'd' ? 'a' : direcao_oposta;
+    // Os fantasmas andam uma vez por rodada; na perseguicao, atras do primeiro ativo
+    for (i = 0; i < partida->qtd_jogadores && !partida->ativo[i]; i++);
+    jogo->pacman = partida->pacmen[i < partida->qtd_jogadores ? i : 0];
+    moveFantasmas(jogo);
 
-    for (i = 0; i < QTD_FANTASMAS; i++) {
-        if (!fantasmas[i].existe) continue;
+    // Todos se movem e colidem contra o mesmo estado, antes de qualquer comida sumir
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        if (!partida->ativo[i]) continue;
 
-        if (temPacmanNaPosicao(fantasmas[i].x, fantasmas[i].y, pacman)) {
-            if (fantasmas[i].direcao == direcao_oposta) {
-                return 1;
-            }
-        }
+        jogo->pacman = partida->pacmen[i];
+        jogo->pacman.direcao = direcoes[i];
+        jogo->trocaram_posicao = verificaTrocaDePosicao(jogo->pacman, &jogo->fantasmas);
+        jogo->pacman = movePacman(jogo);
+        jogo->pacman = verificaColisaoPacman(jogo);
+
+        partida->pacmen[i] = jogo->pacman;
     }
 
-    return 0;
-}
+    // Comidas e portais na ordem da rodada, que gira para nao favorecer ninguem
+    for (k = 0; k < partida->qtd_jogadores; k++) {
+        i = (partida->rodada + k) % partida->qtd_jogadores;
 
+        if (!partida->ativo[i]) continue;
 
-//////////////////////////////// FUNCOES DE ESTATISTICAS //////////////////////////////
-void criaPastaSaida(char* dir) {
-    char pasta_saida_dir[MAX_DIR_SIZE + 7];
-    sprintf(pasta_saida_dir, "%s/saida", dir);
+        jogo->pacman = partida->pacmen[i];
+        memcpy(jogo->estatistica_movs, partida->estatisticas[i], sizeof(jogo->estatistica_movs));
 
-    mkdir(pasta_saida_dir, 0777);
-}
+        if (jogo->pacman.colidiu_com_comida && !temComidaNaPosicao(jogo->pacman.x, jogo->pacman.y, jogo)) {
+            jogo->pacman.colidiu_com_comida = 0;
+        }
 
-void geraInicializacaoTxt(tJogo jogo) {
-    FILE* inicializacaoFile;
-    char inicializacao_dir[MAX_DIR_SIZE + 26];
-    sprintf(inicializacao_dir, "%s/saida/inicializacao.txt", jogo.dir);
+        atualizaObjetos(jogo);
+        atualizaEstatisticasMovimentos(jogo);
 
-    inicializacaoFile = fopen(inicializacao_dir, "w");
+        fprintResumo(jogo, partida->resumos[i]);
+        if (ftell(partida->resumos[i]) >= TAM_LOTE_RESUMO) enviaResumoMulti(partida, i, 1);
 
-    if (inicializacaoFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'inicializacao.txt' em %s/saida\n", jogo.dir);
-        exit(1);
+        partida->pacmen[i] = jogo->pacman;
+        memcpy(partida->estatisticas[i], jogo->estatistica_movs, sizeof(jogo->estatistica_movs));
+
+        if (jogo->pacman.colidiu_com_fantasma) partida->ativo[i] = 0;
     }
 
-    fprintMapa(jogo.mapa, inicializacaoFile);
-    fprintf(inicializacaoFile, "Pac-Man comecara o jogo na linha %d e coluna %d\n", jogo.pacman.y + 1, jogo.pacman.x + 1);
+    partida->rodada++;
 
-    fclose(inicializacaoFile);
+    desenhaJogadoresMulti(partida);
 }
 
-void limpaResumo(char* dir) {
-    FILE* resumoFile;
-    char resumo_dir[MAX_DIR_SIZE + 19];
-    sprintf(resumo_dir, "%s/saida/resumo.txt", dir);
+void enviaResumoMulti(tPartidaMulti* partida, int jogador, int continua) {
+    char resumo_nome[40];
+    char resumo_dir[MAX_DIR_SIZE + 48];
+    sprintf(resumo_nome, "resumo_jogador%d.txt", jogador + 1);
+    sprintf(resumo_dir, "%s/saida/%s", partida->jogo.dir, resumo_nome);
 
-    resumoFile = fopen(resumo_dir, "w");
+    fclose(partida->resumos[jogador]);
 
-    if (resumoFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'resumo.txt' em %s/saida\n", dir);
-        exit(1);
+    if (partida->tamanhos_resumos[jogador] > 0) {
+        enviaEscrita(resumo_dir, "a", partida->dados_resumos[jogador], partida->tamanhos_resumos[jogador], resumo_nome, partida->jogo.dir, 1);
+    } else {
+        free(partida->dados_resumos[jogador]);
     }
 
-    fclose(resumoFile);
+    partida->resumos[jogador] = continua ? open_memstream(&partida->dados_resumos[jogador], &partida->tamanhos_resumos[jogador]) : NULL;
 }
 
-void atualizaResumo(tJogo jogo) {
-    FILE* resumoFile;
-    char resumo_dir[MAX_DIR_SIZE + 19];
-    sprintf(resumo_dir, "%s/saida/resumo.txt", jogo.dir);
+void desenhaJogadoresMulti(tPartidaMulti* partida) {
+    tJogo* jogo = &partida->jogo;
+    int i;
 
-    resumoFile = fopen(resumo_dir, "a");
+    // Sem Pacman no mapa, atualizaMapa so desenha comidas, portais e fantasmas
+    jogo->pacman.x = -1;
+    jogo->pacman.y = -1;
+    atualizaMapa(jogo);
 
-    if (resumoFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'resumo.txt' em %s/saida\n", jogo.dir);
-        exit(1);
-    }
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        tPacman* pacman = &partida->pacmen[i];
 
-    int i;
-    tPacman pacman = jogo.pacman;
+        if (!partida->ativo[i]) continue;
 
-    if (pacman.colidiu_com_comida) {
-        fprintf(resumoFile, "Movimento %d (%c) pegou comida\n", pacman.mov_atual, pacman.direcao);
-    }
-    if (pacman.colidiu_com_fantasma) {
-        fprintf(resumoFile, "Movimento %d (%c) fim de jogo por encostar em um fantasma\n", pacman.mov_atual, pacman.direcao);
-    }
-    if (pacman.colidiu_com_parede && !pacman.colidiu_com_portal) {
-        fprintf(resumoFile, "Movimento %d (%c) colidiu na parede\n", pacman.mov_atual, pacman.direcao);
+        jogo->mapa.trilha[pacman->y][pacman->x] = pacman->mov_atual;
+        if (!temFantasmaNaPosicao(pacman->x, pacman->y, &jogo->fantasmas)) {
+            jogo->mapa.mapa[pacman->y][pacman->x] = SIMBOLOS_JOGADORES[i];
+        }
     }
-
-    fclose(resumoFile);
 }
 
-tJogo criaEstatisticasMovimentos(tJogo jogo) {
-    jogo.estatistica_movs[W].direcao = 'w';
-    jogo.estatistica_movs[W].comidas_pegas = 0;
-    jogo.estatistica_movs[W].colisoes_parede = 0;
-    jogo.estatistica_movs[W].colisoes_apenas_parede = 0;
-    jogo.estatistica_movs[W].qtd_realizado = 0;
-
-    jogo.estatistica_movs[S].direcao = 's';
-    jogo.estatistica_movs[S].comidas_pegas = 0;
-    jogo.estatistica_movs[S].colisoes_parede = 0;
-    jogo.estatistica_movs[S].colisoes_apenas_parede = 0;
-    jogo.estatistica_movs[S].qtd_realizado = 0;
+void printEstadoMulti(tPartidaMulti* partida) {
+    int i, total = 0;
 
-    jogo.estatistica_movs[A].direcao = 'a';
-    jogo.estatistica_movs[A].comidas_pegas = 0;
-    jogo.estatistica_movs[A].colisoes_parede = 0;
-    jogo.estatistica_movs[A].colisoes_apenas_parede = 0;
-    jogo.estatistica_movs[A].qtd_realizado = 0;
+    printf("Estado do jogo apos a rodada %d:\n", partida->rodada);
+    printMapa(partida->jogo.mapa);
 
-    jogo.estatistica_movs[D].direcao = 'd';
-    jogo.estatistica_movs[D].comidas_pegas = 0;
-    jogo.estatistica_movs[D].colisoes_parede = 0;
-    jogo.estatistica_movs[D].colisoes_apenas_parede = 0;
-    jogo.estatistica_movs[D].qtd_realizado = 0;
+    printf("Pontuacao:");
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        printf(" %c=%d%s", SIMBOLOS_JOGADORES[i], partida->pacmen[i].pontos, partida->ativo[i] ? "" : "(x)");
+        total += partida->pacmen[i].pontos;
+    }
 
-    return jogo;
+    if (partida->cooperativo) printf(" total=%d", total);
+    printf("\n\n");
 }
 
-tJogo atualizaEstatisticasMovimentos(tJogo jogo) {
-    int i;
-    tPacman pacman = jogo.pacman;
+int verificaFimMulti(tPartidaMulti* partida) {
+    int i, ativos = 0, total = 0, melhor = -1, sem_movimentos = 1;
 
-    for (i = 0; i < QTD_MOVIMENTOS; i++) {
-        tEstatisticaMovimento movimento = jogo.estatistica_movs[i];
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        ativos += partida->ativo[i];
+        if (partida->ativo[i] && partida->pacmen[i].movs_restantes > 0) sem_movimentos = 0;
+        total += partida->pacmen[i].pontos;
+        if (partida->pacmen[i].pontos > melhor) melhor = partida->pacmen[i].pontos;
+    }
 
-        if (jogo.pacman.direcao == movimento.direcao) {
-            movimento.comidas_pegas += (pacman.colidiu_com_comida);
-            movimento.colisoes_parede += (pacman.colidiu_com_parede);
-            movimento.colisoes_apenas_parede += (pacman.colidiu_com_parede && !pacman.colidiu_com_portal);
-            movimento.qtd_realizado++;
-        }
+    if (partida->jogo.comidas_restantes > 0 && ativos > 0 && !sem_movimentos) return 0;
 
-        jogo.estatistica_movs[i] = movimento;
+    if (partida->cooperativo) {
+        printf("%s\n", partida->jogo.comidas_restantes == 0 ? "Voces venceram!" : "Game over!");
+        printf("Pontuacao final: %d\n", total);
+        return 1;
     }
 
-    return jogo;
-}
+    printf("Fim de jogo!\n");
+    printf("Maior pontuacao: %d, de:", melhor);
+    for (i = 0; i < partida->qtd_jogadores; i++) {
+        if (partida->pacmen[i].pontos == melhor) printf(" %c", SIMBOLOS_JOGADORES[i]);
+    }
+    printf("\n");
 
-void geraRankingTxt(tJogo jogo) {
-    int i;
+    return 1;
+}
 
-    // Ordena o ranking de movimentos
-    for (i = 0; i < QTD_MOVIMENTOS; i++) {
-        int j;
-        int selected_idx = i;
-
-        for (j = i + 1; j < QTD_MOVIMENTOS; j++) {
-            tEstatisticaMovimento movimento1 = jogo.estatistica_movs[selected_idx];
-            tEstatisticaMovimento movimento2 = jogo.estatistica_movs[j];
-
-            if (movimento2.comidas_pegas > movimento1.comidas_pegas) {  // Primeiro criterio: mais comidas pegas
-                selected_idx = j;
-            } else if (movimento2.comidas_pegas == movimento1.comidas_pegas) {
-                if (movimento2.colisoes_apenas_parede < movimento1.colisoes_apenas_parede) {  // Segundo criterio: menos colisoes com parede
-                    selected_idx = j;
-                } else if (movimento2.colisoes_apenas_parede == movimento1.colisoes_apenas_parede) {
-                    if (movimento2.qtd_realizado > movimento1.qtd_realizado) {  // Terceiro criterio: mais movimentos realizados
-                        selected_idx = j;
-                    } else if (movimento2.qtd_realizado == movimento1.qtd_realizado) {
-                        if (movimento2.direcao < movimento1.direcao) {  // Quarto criterio: ordem alfabetica
-                            selected_idx = j;
-                        }
-                    }
-                }
-            }
-        }
 
-        if (selected_idx != i) {
-            tEstatisticaMovimento movimento1 = jogo.estatistica_movs[selected_idx];
-            tEstatisticaMovimento movimento2 = jogo.estatistica_movs[i];
+////////////////////////////// FUNCOES DA MEDICAO DOS PASSOS ///////////////////////////
+void medePassos(char* dir, int rodadas) {
+    static int generica[MAX_LINHAS + 2][MAX_COLUNAS + 2];
+    static uint8_t grades[3][(MAX_LINHAS + 2) * LARGURA_GRANDE];
+    const int larguras[3] = { LARGURA_PEQUENA, LARGURA_MEDIA, LARGURA_GRANDE };
+    const char* nomes[3] = { "pequeno", "medio", "grande" };
+    tJogo* jogo = malloc(sizeof(tJogo));
+    int i, j, k;
 
-            jogo.estatistica_movs[selected_idx] = movimento2;
-            jogo.estatistica_movs[i] = movimento1;
-        }
+    if (jogo == NULL) {
+        printf("ERRO: Memoria insuficiente para medir os passos\n");
+        exit(1);
     }
 
-    FILE* rankingFile;
-    char ranking_dir[MAX_DIR_SIZE + 20];
-    sprintf(ranking_dir, "%s/saida/ranking.txt", jogo.dir);
+    *jogo = carregaJogo(dir);
 
-    rankingFile = fopen(ranking_dir, "w");
+    tFantasmas* fantasmas = &jogo->fantasmas;
+    int linhas = jogo->mapa.linhas;
+    int colunas = jogo->mapa.colunas;
+    int* esperado = malloc(4 * (fantasmas->qtd + 1) * sizeof(int));
+    int* estado = malloc(4 * (fantasmas->qtd + 1) * sizeof(int));
 
-    if (rankingFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'ranking.txt' em %s/saida\n", jogo.dir);
+    if (esperado == NULL || estado == NULL) {
+        printf("ERRO: Memoria insuficiente para medir os passos\n");
         exit(1);
     }
 
-    for (i = 0; i < QTD_MOVIMENTOS; i++) {
-        tEstatisticaMovimento movimento = jogo.estatistica_movs[i];
-
-        fprintf(rankingFile, "%c,%d,%d,%d\n", movimento.direcao, movimento.comidas_pegas, movimento.colisoes_apenas_parede, movimento.qtd_realizado);
+    // Todas as grades saem da grade da classe do mapa, ja com paredes e portais
+    memset(grades, 1, sizeof(grades));
+    for (i = 0; i < MAX_LINHAS + 2; i++) {
+        for (j = 0; j < MAX_COLUNAS + 2; j++) {
+            generica[i][j] = 1;
+        }
     }
 
-    fclose(rankingFile);
-}
+    for (i = 0; i < linhas; i++) {
+        for (j = 0; j < colunas; j++) {
+            generica[i + 1][j + 1] = BLOQUEIO(fantasmas, j, i);
 
-void geraEstatisticasTxt(tJogo jogo) {
-    FILE* estatisticasFile;
-    char estatisticas_dir[MAX_DIR_SIZE + 25];
-    sprintf(estatisticas_dir, "%s/saida/estatisticas.txt", jogo.dir);
+            for (k = 0; k < 3; k++) {
+                if (colunas + 2 <= larguras[k]) grades[k][(i + 1) * larguras[k] + j + 1] = BLOQUEIO(fantasmas, j, i);
+            }
+        }
+    }
 
-    estatisticasFile = fopen(estatisticas_dir, "w");
+    printf("Mapa %dx%d, %d fantasma(s), %d rodada(s), classe %s\n", linhas, colunas, fantasmas->qtd, rodadas,
+           fantasmas->classe == CLASSE_PEQUENA ? "pequena" : fantasmas->classe == CLASSE_MEDIA ? "media" : "grande");
 
-    if (estatisticasFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'estatisticas.txt' em %s/saida\n", jogo.dir);
-        return;
-    }
+    double tempo_generico = cronometraPasso(-1, fantasmas, generica, rodadas, esperado);
+    printf("Passo generico (int, %d colunas): %.1f ns por rodada\n", MAX_COLUNAS + 2, tempo_generico);
 
-    int i;
-    int numero_movs = 0;
-    int numero_movs_sem_pontuar = 0;
-    int numero_colisoes_parede = 0;
-    int numero_movs_s = 0;
-    int numero_movs_w = 0;
-    int numero_movs_a = 0;
-    int numero_movs_d = 0;
+    for (k = 0; k < 3; k++) {
+        if (colunas + 2 > larguras[k]) continue;
 
-    for (i = 0; i < QTD_MOVIMENTOS; i++) {
-        tEstatisticaMovimento movimento = jogo.estatistica_movs[i];
+        double tempo = cronometraPasso(k, fantasmas, grades[k], rodadas, estado);
 
-        numero_movs += movimento.qtd_realizado;
-        numero_movs_sem_pontuar += movimento.qtd_realizado - movimento.comidas_pegas;
-        numero_colisoes_parede += movimento.colisoes_parede;
+        if (memcmp(estado, esperado, 4 * fantasmas->qtd * sizeof(int)) != 0) {
+            printf("ERRO: O passo %s terminou diferente do generico\n", nomes[k]);
+            exit(1);
+        }
 
-        if (movimento.direcao == 's')
-            numero_movs_s += movimento.qtd_realizado;
-        else if (movimento.direcao == 'w')
-            numero_movs_w += movimento.qtd_realizado;
-        else if (movimento.direcao == 'a')
-            numero_movs_a += movimento.qtd_realizado;
-        else if (movimento.direcao == 'd')
-            numero_movs_d += movimento.qtd_realizado;
+        printf("Passo %s (uint8, %d colunas): %.1f ns por rodada, %.2fx o generico%s\n", nomes[k], larguras[k], tempo,
+               tempo > 0 ? tempo_generico / tempo : 0, k == fantasmas->classe ? " (usado neste mapa)" : "");
     }
 
-    fprintf(estatisticasFile, "Numero de movimentos: %d\n", numero_movs);
-    fprintf(estatisticasFile, "Numero de movimentos sem pontuar: %d\n", numero_movs_sem_pontuar);
-    fprintf(estatisticasFile, "Numero de colisoes com parede: %d\n", numero_colisoes_parede);
-    fprintf(estatisticasFile, "Numero de movimentos para baixo: %d\n", numero_movs_s);
-    fprintf(estatisticasFile, "Numero de movimentos para cima: %d\n", numero_movs_w);
-    fprintf(estatisticasFile, "Numero de movimentos para esquerda: %d\n", numero_movs_a);
-    fprintf(estatisticasFile, "Numero de movimentos para direita: %d\n", numero_movs_d);
-
-    fclose(estatisticasFile);
+    free(esperado);
+    free(estado);
+    free(jogo);
 }
 
-void geraTrilhaTxt(tJogo jogo) {
-    FILE* trilhaFile;
-    char trilha_dir[MAX_DIR_SIZE + 19];
-    sprintf(trilha_dir, "%s/saida/trilha.txt", jogo.dir);
+double cronometraPasso(int classe, const tFantasmas* fantasmas, const void* grade, int rodadas, int* estado) {
+    int qtd = fantasmas->qtd;
+    int* x = estado;
+    int* y = estado + qtd;
+    int* dx = estado + 2 * qtd;
+    int* dy = estado + 3 * qtd;
+    struct timespec inicio, fim;
+    int i;
 
-    trilhaFile = fopen(trilha_dir, "w");
+    memcpy(x, fantasmas->x, qtd * sizeof(int));
+    memcpy(y, fantasmas->y, qtd * sizeof(int));
+    memcpy(dx, fantasmas->dx, qtd * sizeof(int));
+    memcpy(dy, fantasmas->dy, qtd * sizeof(int));
 
-    if (trilhaFile == NULL) {
-        printf("ERRO: Nao foi possivel abrir 'trilha.txt' em %s/saida\n", jogo.dir);
-        return;
-    }
+    clock_gettime(CLOCK_MONOTONIC, &inicio);
 
-    int i, j;
-    tMapa mapa = jogo.mapa;
-    for (i = 0; i < mapa.linhas; i++) {
-        for (j = 0; j < mapa.colunas; j++) {
-            if (mapa.trilha[i][j] >= 0) {
-                if (j == mapa.colunas - 1)
-                    fprintf(trilhaFile, "%d", mapa.trilha[i][j]);
-                else
-                    fprintf(trilhaFile, "%d ", mapa.trilha[i][j]);
-            } else {
-                if (j == mapa.colunas - 1)
-                    fprintf(trilhaFile, "#");
-                else
-                    fprintf(trilhaFile, "# ");
-            }
+    for (i = 0; i < rodadas; i++) {
+        if (classe < 0) {
+            passoFantasmasGenerico(qtd, x, y, dx, dy, grade);
+        } else {
+            passoFantasmas(classe, qtd, x, y, dx, dy, grade);
         }
-        fprintf(trilhaFile, "\n");
     }
 
-    fclose(trilhaFile);
+    clock_gettime(CLOCK_MONOTONIC, &fim);
+
+    if (rodadas <= 0) return 0;
+
+    return ((fim.tv_sec - inicio.tv_sec) * 1e9 + (fim.tv_nsec - inicio.tv_nsec)) / rodadas;
 }
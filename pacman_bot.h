@@ -0,0 +1,83 @@
+/*************************************************************************************
+ * @file pacman_bot.h
+ *
+ * @brief Interface dos bots do Pac-Man em ASCII. Um bot eh uma biblioteca
+ * compartilhada que exporta a funcao 'pacman_bot', carregada pelo jogo com a opcao
+ * '--bot <biblioteca>'.
+ *
+ * A cada jogada, o bot recebe uma visao somente leitura do estado do jogo. Os ponteiros
+ * da visao apontam diretamente para a memoria do jogo e so valem durante a chamada.
+ * As grades (mapa, trilha e indice de comidas) sao guardadas linha a linha, com
+ * 'largura' elementos por linha, e indexadas com [y * largura + x].
+ *
+ * Em torneios, o mesmo bot joga varias partidas ao mesmo tempo em threads diferentes.
+ * Por isso, o estado de uma partida deve ficar no retorno de 'inicia', e nao em
+ * variaveis globais.
+ *
+*************************************************************************************/
+
+#ifndef PACMAN_BOT_H
+#define PACMAN_BOT_H
+
+// Versao 2: 'semente' na visao e o estado de cada partida no retorno de 'inicia'. Bots
+// da versao 1 tem outra disposicao da visao e sao recusados.
+#define PACMAN_BOT_VERSAO 2
+
+typedef struct
+{
+    int linhas;
+    int colunas;
+    int largura;
+
+    // Mapa como impresso na tela: '#', ' ', '*', '@', '>' e as letras dos fantasmas
+    const char* mapa;
+    // Movimento em que o Pacman passou por cada celula, ou -1
+    const int* trilha;
+    // Indice da comida em cada celula, ou -1 se nao houver comida
+    const int* indice_comidas;
+
+    int pacman_x;
+    int pacman_y;
+    int pontos;
+    int movs_restantes;
+    int mov_atual;
+    char direcao;
+
+    int qtd_fantasmas;
+    const int* fantasmas_x;
+    const int* fantasmas_y;
+    const int* fantasmas_dx;
+    const int* fantasmas_dy;
+    const char* fantasmas_tipo;
+
+    // Pares x, y dos dois portais
+    const int* portais;
+
+    int comidas_restantes;
+
+    // Semente da partida, para bots que sorteiam; 0 fora de torneios
+    unsigned int semente;
+} tVisaoBot;
+
+typedef struct
+{
+    // Deve ser PACMAN_BOT_VERSAO
+    int versao;
+    const char* nome;
+
+    // Chamada no inicio de cada partida; o retorno eh passado as demais. Opcional.
+    void* (*inicia)(const tVisaoBot* visao);
+    // Devolve a direcao da jogada: 'w', 'a', 's' ou 'd'
+    char (*decide)(void* estado, const tVisaoBot* visao);
+    // Chamada no fim de cada partida. Opcional.
+    void (*encerra)(void* estado);
+} tPacmanBot;
+
+/**
+ * @brief Funcao exportada pela biblioteca do bot.
+ *
+ * @return const tPacmanBot* Descricao do bot
+ */
+const tPacmanBot* pacman_bot(void);
+
+#endif